@@ -0,0 +1,133 @@
+#pragma once
+
+//STL
+#include <array>
+#include <list>
+#include <unordered_map>
+
+//Qt
+#include <QString>
+
+namespace TradingCatCommon
+{
+
+/*!
+    Класс запроса. Определяет бюджет запросов клиента и приоритет при перегрузке сервера
+*/
+enum class RequestClass: quint8
+{
+    STATUS = 0,     ///< Статус сервера
+    LIST = 1,       ///< Списки бирж и свечей
+    HISTORY = 2,    ///< История свечей. При перегрузке отклоняется первым
+    DETECT = 3      ///< Доставка данных для детектора (новые свечи, подписка на события). Имеет наивысший приоритет
+};
+
+static constexpr size_t REQUEST_CLASS_COUNT = 4; ///< Количество классов запросов
+
+/*!
+    Ограничения класса запросов
+*/
+struct RequestClassLimit
+{
+    double rate = 0.0;      ///< Скорость пополнения бюджета клиента (запросов в секунду). 0 - без ограничений
+    double burst = 0.0;     ///< Максимальный бюджет клиента (запросов подряд)
+    double shedLoad = 1.0;  ///< Загрузка сервера (доля HTTPServerConfig::maxPendingWriteBytes), начиная с которой запросы класса отклоняются.
+                            ///< 1 и более - запросы класса по загрузке не отклоняются
+};
+
+///////////////////////////////////////////////////////////////////////////////
+///     The AdmissionConfig class - конфигурация допуска запросов
+///
+struct AdmissionConfig
+{
+    bool isEnabled = true;                                      ///< true - допуск запросов контролируется
+    quint32 maxClients = 100000;                                ///< Максимальное количество отслеживаемых клиентов. Остальные клиенты делят общий бюджет
+    TradingCatCommon::RequestClassLimit status{20.0, 40.0, 0.9};    ///< Ограничения запросов статуса
+    TradingCatCommon::RequestClassLimit list{5.0, 20.0, 0.75};      ///< Ограничения запросов списков
+    TradingCatCommon::RequestClassLimit history{2.0, 20.0, 0.5};    ///< Ограничения запросов истории
+    TradingCatCommon::RequestClassLimit detect{10.0, 50.0, 1.0};    ///< Ограничения запросов данных детектора
+};
+
+///////////////////////////////////////////////////////////////////////////////
+///     The AdmissionControl class - допуск запросов к обработке. Каждый клиент (IP адрес или сессия)
+///         имеет отдельный бюджет (token bucket) для каждого класса запросов, поэтому один клиент
+///         не может занять сервер целиком, а частые дешевые запросы не расходуют бюджет тяжелых.
+///         При росте загрузки сервера запросы отклоняются по приоритету классов: сначала история,
+///         затем списки и статус. Данные для детектора продолжают обслуживаться.
+///         Один объект используется всеми реакторами сервера. Потокобезопасен
+///
+class AdmissionControl final
+{
+public:
+    /*!
+        Решение о допуске запроса
+    */
+    struct Decision
+    {
+        quint16 code = 200;     ///< HTTP код. 200 - запрос допущен, 429 - исчерпан бюджет клиента, 503 - сервер перегружен
+        qint64 retryAfter = 0;  ///< Через сколько секунд клиенту стоит повторить запрос
+
+        bool isAdmitted() const noexcept { return code == 200; }
+    };
+
+public:
+    /*!
+        Конструктор
+        @param config - конфигурация допуска запросов
+    */
+    explicit AdmissionControl(const TradingCatCommon::AdmissionConfig& config);
+
+    /*!
+        Деструктор
+    */
+    ~AdmissionControl() = default;
+
+    /*!
+        Принимает решение о допуске запроса и расходует бюджет клиента, если запрос допущен
+        @param client - ИД клиента (IP адрес или сессия)
+        @param requestClass - класс запроса
+        @param load - текущая загрузка сервера (доля HTTPServerConfig::maxPendingWriteBytes)
+        @return решение о допуске
+    */
+    Decision admit(const QString& client, TradingCatCommon::RequestClass requestClass, double load);
+
+private:
+    // Удаляем неиспользуемые конструкторы
+    AdmissionControl() = delete;
+    Q_DISABLE_COPY_MOVE(AdmissionControl);
+
+private:
+    /*!
+        Бюджет клиента для одного класса запросов
+    */
+    struct Bucket
+    {
+        double tokens = -1.0;   ///< Доступное количество запросов. Отрицательное значение - бюджет еще не использовался
+        qint64 updateTime = 0;  ///< Время последнего пополнения (мсек)
+    };
+
+    using ClientBuckets = std::array<Bucket, REQUEST_CLASS_COUNT>;
+
+    /*!
+        Отслеживаемый клиент
+    */
+    struct Client
+    {
+        ClientBuckets buckets;                  ///< Бюджеты по классам запросов
+        qint64 lastTime = 0;                    ///< Время последнего запроса (мсек)
+        std::list<QString>::iterator usage;     ///< Положение клиента в списке использования
+    };
+
+private:
+    const bool _isEnabled = true;                                       ///< Контроль допуска включен
+    const quint32 _maxClients = 0;                                      ///< Максимальное количество отслеживаемых клиентов
+    const std::array<TradingCatCommon::RequestClassLimit, REQUEST_CLASS_COUNT> _limits;   ///< Ограничения классов запросов
+    qint64 _idleTime = 0;                                               ///< Время полного восстановления бюджета любого класса (мсек)
+
+    std::unordered_map<QString, Client> _clients;                       ///< Бюджеты клиентов
+    std::list<QString> _usage;                                          ///< Клиенты от последнего обратившегося к давно не обращавшемуся
+    ClientBuckets _sharedBuckets;                                       ///< Общий бюджет клиентов сверх maxClients
+
+}; //class AdmissionControl
+
+} //namespace TradingCatCommon
@@ -62,12 +62,24 @@ public:
     */
     explicit ServerStatusAnswer(const QJsonValue& json);
 
+    /*!
+        Конструтор используется на стороне клиента
+        @param stream - двоичное представление пакета
+    */
+    explicit ServerStatusAnswer(QDataStream& stream);
+
     /*!
         Преобразует данные ответа в JSON объект
         @return JSON объект
     */
     QJsonObject toJson() const;
 
+    /*!
+        Записывает данные ответа в двоичный поток
+        @param stream - поток
+    */
+    void toBinary(QDataStream& stream) const;
+
     /*!
         Время на сервере
         @return время на сервере
@@ -169,8 +181,10 @@ public:
     LoginAnswer() = default;
     LoginAnswer(qint64 sessionId, const TradingCatCommon::UserConfig& config, const QString& message);
     explicit LoginAnswer(const QJsonValue& json);
+    explicit LoginAnswer(QDataStream& stream);
 
     QJsonObject toJson() const;
+    void toBinary(QDataStream& stream) const;
 
     /*!
         Возвращает ИД сессии пользователя
@@ -250,8 +264,10 @@ public:
     LogoutAnswer() = default;
     LogoutAnswer(const QString& message);
     explicit LogoutAnswer(const QJsonValue& json);
+    explicit LogoutAnswer(QDataStream& stream);
 
     QJsonObject toJson() const;
+    void toBinary(QDataStream& stream) const;
 
     const QString& message() const noexcept;
 
@@ -325,8 +341,10 @@ public:
     ConfigAnswer() = default;
     ConfigAnswer(const QString& message);
     explicit ConfigAnswer(const QJsonValue& json);
+    explicit ConfigAnswer(QDataStream& stream);
 
     QJsonObject toJson() const;
+    void toBinary(QDataStream& stream) const;
 
     const QString& message() const noexcept;
 
@@ -398,8 +416,11 @@ public:
     StockExchangesAnswer() = default;
     explicit StockExchangesAnswer(const TradingCatCommon::StockExchangesIDList& stockExchangeIdList, const QString& message);
     explicit StockExchangesAnswer(const QJsonValue& json);
+    explicit StockExchangesAnswer(QDataStream& stream);
 
     QJsonObject toJson() const;
+    void writeJson(TradingCatCommon::JsonWriter& writer) const;
+    void toBinary(QDataStream& stream) const;
 
     const TradingCatCommon::StockExchangesIDList& stockExchangeIdList() const noexcept;
     const QString& message() const noexcept;
@@ -474,8 +495,12 @@ public:
     DetectAnswer() = default;
     explicit DetectAnswer(const TradingCatCommon::Detector::KLinesDetectedList& klinesDetectedList, const QString& message);
     explicit DetectAnswer(const QJsonValue& json);
+    explicit DetectAnswer(QDataStream& stream);
+    explicit DetectAnswer(TradingCatCommon::JsonReader& reader);
 
     QJsonObject toJson() const;
+    void writeJson(TradingCatCommon::JsonWriter& writer) const;
+    void toBinary(QDataStream& stream) const;
 
     const TradingCatCommon::Detector::KLinesDetectedList& klinesDetectedList() const noexcept;
     const QString& message() const noexcept;
@@ -492,6 +517,14 @@ public:
     */
     const QString& errorString() const noexcept;
 
+private:
+    /*!
+        Потоковое чтение одной сработки детектора
+        @param reader - JSON reader, установленный на начало объекта сработки
+        @return данные сработки
+    */
+    static TradingCatCommon::Detector::PKLineDetectData readDetect(TradingCatCommon::JsonReader& reader);
+
 private:
     QString _errorString;   ///< Описание ошибки парсинга
 
@@ -501,6 +534,68 @@ private:
 
 };
 
+///////////////////////////////////////////////////////////////////////////////
+///     The PushQuery class - подписка на события сервера (сработки детектора и новые
+///         свечи). Запрос переводит соединение в режим WebSocket
+///
+class PushQuery
+    : public Query
+{
+public:
+    PushQuery();
+    explicit PushQuery(const QUrlQuery& query);
+
+    /*!
+        Конструктор
+        @param sessionId - ИД сессии пользователя
+        @param cursor - курсор последнего полученного события. 0 - получать только новые события
+        @param isKLines - true - получать новые свечи
+    */
+    PushQuery(qint64 sessionId, quint64 cursor, bool isKLines);
+
+    ~PushQuery() override = default;
+
+    QUrlQuery query() const override;
+
+    /*!
+        Возвращает ИД сессии пользователя
+        @return ИД сессии пользователя
+    */
+    qint64 sessionId() const noexcept;
+
+    /*!
+        Возвращает курсор последнего полученного клиентом события. Сервер отправит события после него
+        @return курсор события. 0 - только новые события
+    */
+    quint64 cursor() const noexcept;
+
+    /*!
+        Возвращает true если клиент подписывается на новые свечи
+        @return true - клиент получает новые свечи
+    */
+    bool isKLines() const noexcept;
+
+    /*!
+        Возвращает true если запрос распарсился с ошибкой. Текстовое описание ошибки можно получить методом errorString()
+        @return true - есть ошибка, false - все ок
+    */
+    bool isError() const noexcept;
+
+    /*!
+        Возвращает текстовое описание последней ошибки. Если все ок - возвращает пустую строку
+        @return текстовое описание последней ошибки
+    */
+    const QString& errorString() const noexcept;
+
+private:
+    QString _errorString;   ///< Описание ошибки парсинга
+
+    qint64 _sessionId = 0;  ///< ИД сессии пользователя
+    quint64 _cursor = 0;    ///< Курсор последнего полученного события
+    bool _isKLines = false; ///< Подписка на новые свечи
+
+};
+
 ///////////////////////////////////////////////////////////////////////////////
 ///     The KLinesIDList class - запрос списка свичей поддерживаемых биржей
 ///
@@ -552,8 +647,11 @@ public:
     KLinesIDListAnswer() = default;
     explicit KLinesIDListAnswer(const TradingCatCommon::StockExchangeID& stockExchangeId, const TradingCatCommon::PKLinesIDList& klinesIdList, const QString& message);
     explicit KLinesIDListAnswer(const QJsonValue& json);
+    explicit KLinesIDListAnswer(QDataStream& stream);
 
     QJsonObject toJson() const;
+    void writeJson(TradingCatCommon::JsonWriter& writer) const;
+    void toBinary(QDataStream& stream) const;
 
     const TradingCatCommon::StockExchangeID& stockExchangeId() const noexcept;
     const TradingCatCommon::PKLinesIDList& klinesIdList() const noexcept;
@@ -5,6 +5,9 @@
 #include <QHash>
 #include <QString>
 
+//My
+#include "TradingCatCommon/httpcompression.h"
+
 namespace TradingCatCommon
 {
 
@@ -17,11 +20,20 @@ public:
     QByteArray getAnswer();
     void addHeader(const QString& key, const QString& value);
     void addBody(const QByteArray& Body);
+    void addBody(const QByteArray& body, TradingCatCommon::ContentEncoding encoding); //добавляет тело, уже сжатое методом encoding
+
+    /*!
+        Формирует часть тела ответа для передачи с заголовком Transfer-Encoding: chunked
+        @param data - данные части. Пустые данные - завершающая часть
+        @return часть для отправки
+    */
+    static QByteArray chunk(const QByteArray& data);
 
 private:
     QHash<QString, QString> _headers;
     QByteArray _body;
     QString _status;
+    quint16 _code = 200;
 
 };
 
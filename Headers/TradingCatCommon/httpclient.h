@@ -1,14 +1,19 @@
 #pragma once
 
 //STL
+#include <chrono>
+#include <deque>
 #include <unordered_map>
+#include <unordered_set>
 #include <optional>
+#include <vector>
 
 //Qt
 #include <QObject>
 #include <QHostAddress>
 #include <QTimer>
 #include <QDateTime>
+#include <QHash>
 
 //My
 #include <Common/common.h>
@@ -17,6 +22,8 @@
 
 #include <TradingCatCommon/kline.h>
 #include <TradingCatCommon/transmitdata.h>
+#include <TradingCatCommon/httpcompression.h>
+#include <TradingCatCommon/servermetrics.h>
 
 namespace TradingCatCommon
 {
@@ -25,12 +32,74 @@ struct HTTPClientConfig
 {
     QHostAddress address = QHostAddress::LocalHost;
     quint16 port = 80;
+    TradingCatCommon::PackageFormat format = TradingCatCommon::PackageFormat::BINARY; ///< Запрашиваемый формат ответов. Если сервер не поддерживает формат - он ответит в JSON
+    bool compression = true;    ///< true - запрашивать сжатие ответов (gzip/deflate)
+    quint32 maxInFlightRequests = 6;    ///< Максимальное количество одновременно выполняемых запросов. Остальные запросы ждут в очереди клиента
+    qint64 requestTimeout = 30 * 1000;  ///< Таймаут выполнения запроса (мсек). Отсчитывается с момента отправки
+    qint64 retryBaseDelay = 1000;       ///< Минимальная задержка повтора запроса после ошибки (мсек)
+    qint64 retryMaxDelay = 60 * 1000;   ///< Максимальная задержка повтора запроса после ошибки (мсек)
+    quint32 circuitFailureThreshold = 5;    ///< Количество ошибок подряд, после которого запросы этого типа приостанавливаются
+    qint64 circuitOpenTime = 10 * 1000;     ///< Минимальная пауза запросов после срабатывания защиты (мсек)
+    qint64 circuitMaxOpenTime = 120 * 1000; ///< Максимальная пауза запросов после повторных срабатываний защиты (мсек)
+    qint64 pushSessionId = 0;   ///< ИД сессии для получения новых свечей через канал рассылки (PushQuery). 0 - новые свечи запрашиваются только опросом
 
     bool isCheck() const noexcept;
 };
 
 using HTTPClientConfigsList = std::list<HTTPClientConfig>;
 
+/*!
+    Сохраненный ответ сервера. Повторный запрос отправляется с заголовком If-None-Match,
+        и если ответ не изменился - сервер отвечает 304 без тела
+*/
+struct HTTPClientCachedAnswer
+{
+    QString eTag;       ///< ETag ответа
+    QByteArray answer;  ///< Несжатый ответ
+};
+
+using HTTPClientAnswersCache = QHash<QString, HTTPClientCachedAnswer>; ///< Сохраненные ответы. Ключ - путь и параметры запроса
+
+/*!
+    Состояние автомата защиты (circuit breaker) запросов одного типа
+*/
+enum class HTTPClientCircuitState: quint8
+{
+    CLOSED = 0,     ///< Запросы отправляются
+    OPEN = 1,       ///< Сервер не отвечает - запросы ждут в очереди до окончания паузы
+    HALF_OPEN = 2   ///< Пауза закончилась - отправлен один пробный запрос, остальные ждут его результата
+};
+
+/*!
+    Автомат защиты запросов одного типа. После HTTPClientConfig::circuitFailureThreshold ошибок подряд запросы
+        приостанавливаются на случайное время, чтобы после перезапуска сервера клиенты не обращались к нему одновременно
+*/
+struct HTTPClientCircuit
+{
+    HTTPClientCircuitState state = HTTPClientCircuitState::CLOSED;  ///< Состояние
+    quint32 failures = 0;       ///< Количество ошибок подряд
+    qint64 retryDelay = 0;      ///< Последняя задержка повтора запроса (мсек). 0 - после последнего успешного запроса повторов не было
+    qint64 openTime = 0;        ///< Последняя пауза запросов (мсек)
+    qint64 openUntil = 0;       ///< Время окончания паузы запросов (мсек epoch)
+    quint64 opens = 0;          ///< Количество срабатываний защиты
+};
+
+using HTTPClientCircuits = std::unordered_map<TradingCatCommon::PackageType, HTTPClientCircuit>;
+
+/*!
+    Метрики HTTP клиента. Изменяются только в потоке клиента
+*/
+struct HTTPClientMetrics
+{
+    TradingCatCommon::LatencyHistogram queueTime;   ///< Время ожидания запроса в очереди клиента до отправки (мксек)
+    TradingCatCommon::LatencyHistogram serverTime;  ///< Время от отправки запроса до получения ответа (мксек)
+    quint64 requests = 0;       ///< Количество отправленных запросов
+    quint64 errors = 0;         ///< Количество запросов, завершившихся ошибкой
+    quint64 timeouts = 0;       ///< Количество запросов, не получивших ответ за HTTPClientConfig::requestTimeout
+    quint64 maxQueueSize = 0;   ///< Максимальная длина очереди ожидающих отправки запросов
+    HTTPClientCircuits circuits;    ///< Автоматы защиты по типам запросов
+};
+
 class HTTPClient
     : public QObject
 {
@@ -53,6 +122,42 @@ public:
                              const QDateTime& start,
                              const QDateTime& end);
 
+    /*!
+        Возвращает сохраненные ответы на запросы списков бирж и свечей
+        @return сохраненные ответы
+    */
+    const HTTPClientAnswersCache& answersCache() const noexcept;
+
+    /*!
+        Устанавливает сохраненные ответы, например полученные предыдущим экземпляром клиента
+        @param answersCache - сохраненные ответы
+    */
+    void setAnswersCache(const HTTPClientAnswersCache& answersCache);
+
+    /*!
+        Возвращает метрики клиента. Гистограммы можно читать из любого потока, счетчики - только из потока клиента
+        @return метрики
+    */
+    const HTTPClientMetrics& metrics() const noexcept;
+
+    /*!
+        Возвращает задержку перед повтором запроса после ошибки. Задержка растет экспоненциально со случайным
+            разбросом (decorrelated jitter) и сбрасывается после успешного запроса. Если запросы этого типа
+            приостановлены - задержка не меньше оставшейся паузы
+        @param type - тип запроса
+        @return задержка (мсек)
+    */
+    qint64 retryDelay(TradingCatCommon::PackageType type);
+
+    /*!
+        Возвращает случайную задержку в диапазоне [base, previous * 3], но не больше cap (decorrelated jitter)
+        @param base - минимальная задержка (мсек)
+        @param cap - максимальная задержка (мсек)
+        @param previous - предыдущая задержка (мсек)
+        @return задержка (мсек)
+    */
+    static qint64 decorrelatedJitter(qint64 base, qint64 cap, qint64 previous);
+
 signals:
     void sendLogMsg(Common::TDBLoger::MSG_CODE category, const QString& msg);
 
@@ -60,6 +165,14 @@ signals:
     void klineList(const TradingCatCommon::StockExchangeID& stockExchangeId, const TradingCatCommon::KLinesIDList& klineIdList, quint64 id);
     void klineNew(const TradingCatCommon::StockExchangeID& stockExchangeId, const TradingCatCommon::PKLinesList& klinesList, quint64 id);
 
+    /*!
+        Генерируется после обработки ответа на запрос новых свечей, в том числе пустого. Сигналы klineNew(...) этого ответа уже отправлены
+        @param klinesCount - количество полученных свечей
+        @param lastGetId - ИД последней полученной свечи (курсор запросов новых свечей)
+        @param id - ИД запроса вернутый sendKLineNew(...)
+    */
+    void klineNewReceived(qsizetype klinesCount, qint64 lastGetId, quint64 id);
+
     /*!
         Генерируется когда полученны данные с историей Свечей. Гарантируется что klinesList содержит свечи с одинаковым ИД и список не пустой
         @param stockExchangeId - ИД биржи
@@ -75,9 +188,67 @@ private:
     HTTPClient() = delete;
     Q_DISABLE_COPY_MOVE(HTTPClient);
 
+    /*!
+        Ставит запрос в очередь отправки
+        @param query - запрос
+        @return ИД запроса (Query::id())
+    */
     quint64 getPackage(std::unique_ptr<Query>&& query);
+
+    /*!
+        Отправляет запросы из очереди, пока количество выполняемых запросов меньше HTTPClientConfig::maxInFlightRequests
+    */
+    void sendQueued();
+
+    /*!
+        Завершает выполняемый запрос: учитывает время ответа и отправляет следующие запросы из очереди
+        @param id - ИД HTTP запроса
+    */
+    void finishPackage(quint64 id);
+
+    /*!
+        Освобождает место запроса, завершенного по таймауту, после того как HTTPSSLQuery сообщил о его окончании
+        @param id - ИД HTTP запроса
+        @return true - запрос был завершен по таймауту
+    */
+    bool releaseExpired(quint64 id);
+
+    /*!
+        Возвращает true если ответ на запрос сохраняется и проверяется повторно по ETag
+        @param type - тип запроса
+        @return true - ответ сохраняется
+    */
+    static bool isCachedAnswer(TradingCatCommon::PackageType type) noexcept;
+
+    /*!
+        Возвращает ключ сохраненного ответа на запрос
+        @param query - запрос
+        @return ключ
+    */
+    static QString answerCacheKey(const Query& query);
     void retryGetPackage(std::unique_ptr<Query>&& query);
 
+    /*!
+        Возвращает true если запрос можно отправить. Переводит автомат защиты из OPEN в HALF_OPEN по окончании паузы.
+            В состоянии HALF_OPEN разрешается только один пробный запрос
+        @param type - тип запроса
+        @return true - запрос можно отправить
+    */
+    bool isCircuitAllow(TradingCatCommon::PackageType type);
+
+    /*!
+        Учитывает ответ сервера: автомат защиты закрывается, задержка повтора сбрасывается
+        @param type - тип запроса
+    */
+    void circuitSuccess(TradingCatCommon::PackageType type);
+
+    /*!
+        Учитывает отсутствие ответа сервера. После HTTPClientConfig::circuitFailureThreshold ошибок подряд
+            или при ошибке пробного запроса запросы этого типа приостанавливаются
+        @param type - тип запроса
+    */
+    void circuitFailure(TradingCatCommon::PackageType type);
+
     using ParseResult = std::optional<QString>;
 
     ParseResult parseStockExchangeList(const QByteArray& answer, const Query* query);
@@ -87,16 +258,54 @@ private:
     ParseResult parseServerStatus(const QByteArray& answer, const Query* query);
 
 private slots:
-    void getAnswerHTTP(const QByteArray& answer, quint64 id);
+    void getAnswerHTTP(const QByteArray& httpAnswer, quint64 id);
     void errorOccurredHTTP(QNetworkReply::NetworkError code, quint64 serverCode, const QString& msg, quint64 id);
     void sendLogMsgHTTP(Common::TDBLoger::MSG_CODE category, const QString& msg, quint64 id);
 
+    /*!
+        Поворачивает колесо таймаутов и завершает с ошибкой запросы, не получившие ответ за HTTPClientConfig::requestTimeout.
+            Также отправляет запросы, ожидавшие окончания паузы автомата защиты
+    */
+    void timeoutWheel();
+
 private:
     const HTTPClientConfig _config;
 
     Common::HTTPSSLQuery* _http = nullptr;
+    Common::HTTPSSLQuery::Headers _headers;    ///< Общие заголовки запросов
+
+    HTTPClientAnswersCache _answersCache;   ///< Сохраненные ответы
+
+    using Clock = std::chrono::steady_clock;
+
+    /*!
+        Запрос, ожидающий отправки
+    */
+    struct QueuedPackage
+    {
+        std::unique_ptr<TradingCatCommon::Query> query;     ///< Запрос
+        Clock::time_point queueTime;                        ///< Время постановки в очередь
+    };
+
+    /*!
+        Выполняемый запрос
+    */
+    struct SentPackage
+    {
+        std::unique_ptr<TradingCatCommon::Query> query;     ///< Запрос
+        Clock::time_point sendTime;                         ///< Время отправки
+    };
+
+    std::deque<QueuedPackage> _queue;                       ///< Запросы, ожидающие отправки
+    std::unordered_map<quint64, SentPackage> _package;      ///< Выполняемые запросы по ИД HTTP запроса
+    std::unordered_set<quint64> _expired;                   ///< ИД HTTP запросов, завершенных по таймауту, но еще выполняемых HTTPSSLQuery.
+                                                            ///< HTTPSSLQuery не позволяет прервать запрос, поэтому они занимают место выполняемых
+
+    std::vector<std::vector<quint64>> _timeoutWheel;        ///< Колесо таймаутов: ИД HTTP запросов по интервалам времени отправки
+    size_t _timeoutWheelPos = 0;                            ///< Текущий интервал колеса таймаутов
+    QTimer* _timeoutWheelTimer = nullptr;                   ///< Таймер поворота колеса таймаутов
 
-    std::unordered_map<quint64, std::unique_ptr<TradingCatCommon::Query>> _package;
+    HTTPClientMetrics _metrics;                             ///< Метрики клиента
 
     qint64 _lastGetKLineId = 0;
     qint64 _lastGetOrderBookId = 0;
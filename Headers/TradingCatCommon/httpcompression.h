@@ -0,0 +1,121 @@
+#pragma once
+
+//STL
+#include <memory>
+
+//Qt
+#include <QByteArray>
+#include <QString>
+
+struct z_stream_s;
+
+namespace TradingCatCommon
+{
+
+/*!
+    Метод сжатия тела HTTP сообщения (заголовок Content-Encoding)
+*/
+enum class ContentEncoding: quint8
+{
+    IDENTITY = 0,   ///< Без сжатия
+    DEFLATE = 1,    ///< zlib (RFC 1950)
+    GZIP = 2        ///< gzip (RFC 1952)
+};
+
+/*!
+    Режим сжатия ответов сервера
+*/
+enum class CompressionMode: quint8
+{
+    NONE = 0,           ///< Ответы не сжимаются
+    PER_REQUEST = 1,    ///< Ответ сжимается при каждом запросе
+    CACHED = 2          ///< Для кешируемых ответов сжатые варианты хранятся в кеше, остальные сжимаются при каждом запросе
+};
+
+static const qsizetype MAX_DECOMPRESSED_SIZE = 256 * 1024 * 1024; ///< Наибольший размер распакованных данных по умолчанию (байт)
+
+/*!
+    Выбирает метод сжатия по значению заголовка Accept-Encoding. Предпочтение отдается gzip.
+        Методы с весом q=0 не используются
+    @param acceptEncoding - значение заголовка Accept-Encoding
+    @return метод сжатия. ContentEncoding::IDENTITY - если клиент не поддерживает ни один из методов
+*/
+ContentEncoding acceptEncodingToContentEncoding(const QString& acceptEncoding);
+
+/*!
+    Преобразует метод сжатия в значение заголовка Content-Encoding
+    @param encoding - метод сжатия
+    @return значение заголовка. Для ContentEncoding::IDENTITY - пустая строка
+*/
+QString contentEncodingToString(ContentEncoding encoding);
+
+/*!
+    Сжимает данные
+    @param data - данные
+    @param encoding - метод сжатия. Не должен быть равен ContentEncoding::IDENTITY
+    @param level - уровень сжатия zlib (1..9)
+    @return сжатые данные или пустой массив в случае ошибки
+*/
+QByteArray compressData(const QByteArray& data, ContentEncoding encoding, int level);
+
+/*!
+    Возвращает true если данные сжаты gzip или zlib (определяется по сигнатуре)
+    @param data - данные
+    @return true - данные сжаты
+*/
+bool isCompressedData(const QByteArray& data) noexcept;
+
+/*!
+    Распаковывает данные сжатые gzip или zlib. Формат определяется автоматически. Распаковка прерывается,
+        если размер данных превысит maxSize, что защищает от сжатых данных с большим коэффициентом сжатия
+    @param data - сжатые данные
+    @param maxSize - наибольший размер распакованных данных (байт)
+    @return распакованные данные или пустой массив в случае ошибки или превышения maxSize
+*/
+QByteArray decompressData(const QByteArray& data, qsizetype maxSize = MAX_DECOMPRESSED_SIZE);
+
+///////////////////////////////////////////////////////////////////////////////
+///     The StreamCompressor class - сжатие данных, передаваемых частями (chunked transfer).
+///         Все части образуют один поток gzip/zlib, каждая часть сбрасывается (Z_SYNC_FLUSH),
+///         поэтому клиент может распаковывать данные по мере получения
+///
+class StreamCompressor final
+{
+public:
+    /*!
+        Конструктор
+        @param encoding - метод сжатия. Не должен быть равен ContentEncoding::IDENTITY
+        @param level - уровень сжатия zlib (1..9)
+    */
+    StreamCompressor(TradingCatCommon::ContentEncoding encoding, int level);
+
+    /*!
+        Деструктор
+    */
+    ~StreamCompressor();
+
+    /*!
+        Сжимает очередную часть данных
+        @param data - данные
+        @param isFinish - true - последняя часть, поток завершается
+        @return сжатые данные или пустой массив в случае ошибки
+    */
+    QByteArray compress(const QByteArray& data, bool isFinish);
+
+    /*!
+        Возвращает true если произошла ошибка сжатия
+        @return true - ошибка
+    */
+    bool isError() const noexcept;
+
+private:
+    StreamCompressor() = delete;
+    Q_DISABLE_COPY_MOVE(StreamCompressor);
+
+private:
+    std::unique_ptr<z_stream_s> _stream;    ///< Состояние zlib
+    bool _isError = false;                  ///< Ошибка сжатия
+
+};
+
+} // namespace TradingCatCommon
@@ -0,0 +1,135 @@
+#pragma once
+
+//STL
+#include <unordered_map>
+
+//QT
+#include <QtNetwork/QTcpServer>
+
+//My
+#include "Common/tdbloger.h"
+#include "TradingCatCommon/tradingdata.h"
+#include "TradingCatCommon/socketthread.h"
+#include "TradingCatCommon/types.h"
+
+namespace TradingCatCommon
+{
+
+///////////////////////////////////////////////////////////////////////////////
+///     The HTTPReactor class - цикл обработки событий сервера. Каждый реактор работает
+///         в своем потоке, принимает соединения на собственном слушающем сокете (SO_REUSEPORT,
+///         ядро распределяет входящие соединения между реакторами) и обслуживает все
+///         принятые соединения неблокирующим вводом/выводом в цикле событий потока
+///
+class HTTPReactor final
+    : public QTcpServer
+{
+    Q_OBJECT
+
+public:
+    /*!
+        Конструктор
+        @param id - ИД реактора
+        @param serverConfig - конфигурация сервера
+        @param data - данные. Реактор обращается к данным только для чтения
+        @param maxConnections - максимальное количество одновременных соединений реактора
+        @param admissionControl - допуск запросов. nullptr - запросы не ограничиваются
+        @param pushChannel - канал рассылки событий по WebSocket. nullptr - рассылка не поддерживается
+        @param metrics - блок метрик потока реактора. nullptr - метрики не собираются
+        @param parent - указатель на родительский класс
+    */
+    HTTPReactor(quint64 id, const TradingCatCommon::HTTPServerConfig& serverConfig, const TradingCatCommon::TradingData& data,
+                quint64 maxConnections, TradingCatCommon::AdmissionControl* admissionControl = nullptr,
+                TradingCatCommon::PushChannel* pushChannel = nullptr, TradingCatCommon::ServerMetrics::ThreadMetrics* metrics = nullptr,
+                QObject* parent = nullptr);
+
+    /*!
+        Деструктор
+    */
+    ~HTTPReactor();
+
+    /*!
+        Возвращает ИД реактора
+        @return ИД реактора
+    */
+    quint64 id() const noexcept;
+
+public slots:
+    /*!
+        Создает слушающий сокет и начинает прием соединений. Должен вызываться в потоке реактора
+    */
+    void start();
+
+    /*!
+        Прекращает прием соединений и закрывает все открытые соединения
+    */
+    void stop();
+
+signals:
+    /*!
+        Сообщение логеру
+        @param category - категория сообщения
+        @param msg - текст сообщения
+    */
+    void sendLogMsg(Common::MSG_CODE category, const QString& msg);
+
+    /*!
+        Ошибка запуска реактора
+        @param errorCode - код ошибки
+        @param errorString - текстовое описание ошибки
+    */
+    void errorOccurred(Common::EXIT_CODE errorCode, const QString& errorString);
+
+    /*!
+        Реактор запущен и принимает соединения
+        @param id - ИД реактора
+    */
+    void started(quint64 id);
+
+    /*!
+        Реактор остановлен. Все соединения закрыты
+        @param id - ИД реактора
+    */
+    void finished(quint64 id);
+
+private slots:
+    /*!
+        Соединение закрыто
+        @param id - ИД соединения
+    */
+    void finishedSocket(quint64 id);
+
+private:
+    // Удаляем неиспользуемые конструкторы
+    HTTPReactor() = delete;
+    Q_DISABLE_COPY_MOVE(HTTPReactor);
+
+    /*!
+        Нативный обработчик входящего соединения
+        @param handle - дескриптор соединения
+    */
+    void incomingConnection(qintptr handle) override;
+
+    /*!
+        Создает обработчик соединения
+        @return обработчик соединения
+    */
+    TradingCatCommon::SocketThread* makeConnection();
+
+private:
+    const quint64 _id = 0;                                      ///< ИД реактора
+    const HTTPServerConfig& _serverConfig;                      ///< Конфигуация сервера
+    const TradingCatCommon::TradingData& _data;                 ///< Ссылка на объект данных
+    const quint64 _maxConnections = 0;                          ///< Максимальное количество одновременных соединений
+    TradingCatCommon::AdmissionControl* const _admissionControl = nullptr;   ///< Допуск запросов
+    TradingCatCommon::PushChannel* const _pushChannel = nullptr;  ///< Канал рассылки событий
+    TradingCatCommon::ServerMetrics::ThreadMetrics* const _metrics = nullptr;  ///< Блок метрик потока реактора
+
+    std::unordered_map<quint64, TradingCatCommon::SocketThread*> _connections;  ///< Открытые соединения. Владелец - реактор (QObject parent)
+    quint64 _lastConnectionId = 0;                              ///< ИД последнего созданного соединения
+
+    bool _isStarted = false;                                    ///< флаг успешного запуска
+
+}; //class HTTPReactor
+
+} //namespace TradingCatCommon
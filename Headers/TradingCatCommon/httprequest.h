@@ -1,15 +1,25 @@
 #pragma once
 
+//STL
+#include <vector>
+
 //QT
 #include <QByteArray>
 #include <QString>
-#include <QMap>
 #include <QUrlQuery>
 #include <QUrl>
 
+//My
+#include "TradingCatCommon/httpcompression.h"
+
 namespace TradingCatCommon
 {
 
+///////////////////////////////////////////////////////////////////////////////
+///     The HTTPRequest class - входящий HTTP запрос. Разбор выполняется по мере
+///         поступления данных и продолжается с места остановки. Заголовки хранятся как
+///         смещения в буфере приема и декодируются только при обращении к ним
+///
 class HTTPRequest final
 {
 public:
@@ -26,30 +36,71 @@ public:
     void add(const QByteArray& data);
 
     RequestType type() const noexcept;         //возвращает тип запроса
-    QByteArray body() const noexcept;          //возвращает тело запроса
-    QString header(const QString& key) const;  //возвращает заголовок
+    QByteArray body() const;                   //возвращает тело запроса
+    QString header(const QString& key) const;  //возвращает заголовок. Имя заголовка не зависит от регистра
+    QByteArrayView headerView(QLatin1String key) const noexcept; //возвращает заголовок без декодирования. Действителен до следующего вызова add()
     QUrl resurce() const noexcept;             //возввращает запрашиваемый ресурс
     QString protocol() const noexcept;         //название протокола (Обычно HTTP/1.1)
     [[nodiscard]] uint errorCode() const;      //код ошибки
     [[nodiscard]] QString errorMsg() const;    //текстовое сообщение об ошибке
     bool isComplite() const noexcept;          //возвращает истину если пришли все данные
     bool isGetHeader() const noexcept;         //возвращает истину если пришел заголовок и он разобран
+    bool isError() const noexcept;             //возвращает истину если запрос некорректен. Код и описание ошибки - errorCode() и errorMsg()
     qint64 size() const noexcept;              //общий обем пришедших данных
     quint64 expectedSize() const noexcept;
+    TradingCatCommon::ContentEncoding acceptEncoding() const; //метод сжатия ответа, поддерживаемый клиентом (заголовок Accept-Encoding)
+    bool isKeepAlive() const;                  //возвращает истину если клиент не запросил закрытие соединения после ответа
+    QByteArray takeTail();                     //возвращает и удаляет данные, принятые после окончания запроса (начало следующего запроса)
 
 private:
+    /*!
+        Состояние разбора запроса
+    */
+    enum class State: quint8
+    {
+        HEAD,       ///< Ожидается окончание заголовка
+        BODY,       ///< Заголовок разобран, ожидается тело запроса
+        COMPLETE,   ///< Запрос принят полностью
+        ERROR       ///< Запрос некорректен
+    };
+
+    /*!
+        Поле заголовка. Смещения в буфере приема
+    */
+    struct HeaderField
+    {
+        qsizetype nameBegin = 0;
+        qsizetype nameSize = 0;
+        qsizetype valueBegin = 0;
+        qsizetype valueSize = 0;
+    };
+
+private:
+    /*!
+        Ищет окончание заголовка в принятых данных и разбирает его
+    */
+    void parseHead();
+
+    /*!
+        Переводит запрос в состояние ошибки
+        @param code - HTTP код ошибки
+        @param msg - описание ошибки
+    */
+    void setError(uint16_t code, const QString& msg);
+
+private:
+    State _state = State::HEAD;
     RequestType _type  = RequestType::UNDEFINE;
     QUrl _resurce;
     QString _protocol;
-    QByteArray _body;
-    QMap<QString, QString> _header;
+    QByteArray _buffer;                     ///< Буфер приема: заголовок, тело и начало следующего запроса
+    std::vector<HeaderField> _header;
     mutable uint16_t _errorCode = 204;
     mutable QString _errorMsg;
+    qsizetype _scanPos = 0;                 ///< Позиция с которой продолжается поиск окончания заголовка
+    qsizetype _bodyBegin = 0;               ///< Смещение тела запроса в буфере приема
     qint64 _lengthBody = 0;
     qint64 _totalGetSize = 0;
-    qint64 _expectedSize = 0;
-    bool _headerParsed = false;
 };
 
 } //TradingCatCommon
-
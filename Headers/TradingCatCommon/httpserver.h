@@ -2,24 +2,28 @@
 
 //STL
 #include <memory>
-#include <unordered_map>
-#include <queue>
+#include <vector>
 
 //QT
-#include <QtNetwork/QTcpServer>
+#include <QObject>
 #include <QCoreApplication>
 
 //My
 #include "TradingCatCommon/tradingdata.h"
-#include "TradingCatCommon/socketthread.h"
+#include "TradingCatCommon/httpreactor.h"
 #include "TradingCatCommon/thread.h"
 #include "TradingCatCommon/types.h"
 
 namespace TradingCatCommon
 {
 
+///////////////////////////////////////////////////////////////////////////////
+///     The HttpServer class - HTTP сервер. Запускает фиксированный набор реакторов (по
+///         умолчанию по одному на ядро), каждый в своем потоке. Реакторы слушают один и тот же
+///         адрес (SO_REUSEPORT) и обслуживают соединения неблокирующим вводом/выводом
+///
 class HttpServer
-    : public QTcpServer
+    : public QObject
 {
     Q_OBJECT
 
@@ -28,9 +32,12 @@ public:
         Конструктор. Планируется использовать только это тконструтор
         @param serverConfig - конфигурация сервера
         @param data - данные
+        @param pushChannel - канал рассылки сработок детектора и новых свечей по WebSocket (PushQuery).
+            nullptr - рассылка не поддерживается. Канал должен существовать все время работы сервера
         @param parent - указатель на родительский класс
      */
-    HttpServer(const TradingCatCommon::HTTPServerConfig &serverConfig, const TradingCatCommon::TradingData& data, QObject *parent = nullptr);
+    HttpServer(const TradingCatCommon::HTTPServerConfig &serverConfig, const TradingCatCommon::TradingData& data,
+               TradingCatCommon::PushChannel* pushChannel = nullptr, QObject *parent = nullptr);
 
     /*!
         Деструктор
@@ -39,7 +46,7 @@ public:
 
 public slots:
     /*!
-        Старт сервера (листинг и создание потоков соединения).
+        Старт сервера (создание потоков реакторов и листинг).
     */
     void start();
 
@@ -63,6 +70,11 @@ signals:
     */
     void errorOccurred(Common::EXIT_CODE errorCode, const QString& errorString);
 
+    /*!
+        Все реакторы запущены и принимают соединения
+    */
+    void started();
+
     /*!
         Остановка сервера
     */
@@ -73,32 +85,26 @@ signals:
     */
     void finished();
 
-    /*!
-        Пришло новое входящее подключение. Сигнал отправляеться потоку обрабатывающему соединение
-        @param id - ИД потока
-        @param handle - ИД соединения
-     */
-    void startSocket(quint64 id, qintptr handle);
-
 private slots:
     /*!
-        Вызываетяс когда поток соединения успешно запустился и готов принимать соединения
-        @param id - ИД потока
+        Сообщение логеру от реактора
+        @param category - категория сообщения
+        @param msg - текст сообщения
     */
-    void startedConnecton(quint64 id);
+    void sendLogMsgReactor(Common::MSG_CODE category, const QString &msg);
 
     /*!
-        Вызывается когда поток закончил обрботку соединения и готов принимать новое
-        @param id - ИД потока
+        Ошибка реактора
+        @param errorCode - код ошибки
+        @param errorString - текстовое описание ошибки
     */
-    void finishedSocket(quint64 id);
+    void errorOccurredReactor(Common::EXIT_CODE errorCode, const QString& errorString);
 
     /*!
-        Сообщение логеру от обработчика входящих соединений
-        @param category - категория сообщения
-        @param msg - текст сообщения
+        Реактор начал прием соединений
+        @param id - ИД реактора
     */
-    void sendLogMsgSocket(Common::MSG_CODE category, const QString &msg);
+    void startedReactor(quint64 id);
 
 private:
     // Удаляем неиспользуемые конструкторы
@@ -106,34 +112,33 @@ private:
     Q_DISABLE_COPY_MOVE(HttpServer);
 
     /*!
-        Нативные обработчик входящего соединения
-        @param handle - уникальный идентификатор соединения
+        Возвращает количество реакторов
+        @return количество реакторов
     */
-    void incomingConnection(qintptr handle) override;
+    quint32 reactorCount() const;
 
 private:
     /*!
-        Обработчик входящего соединения
+        Реактор
     */
-    struct Connection
+    struct Reactor
     {
-        std::unique_ptr<TradingCatCommon::Thread> thread;       ///< Поток обработки соединения
-        std::unique_ptr<TradingCatCommon::SocketThread> socket; ///< класс обработки данных соединения
+        std::unique_ptr<TradingCatCommon::Thread> thread;           ///< Поток реактора
+        std::unique_ptr<TradingCatCommon::HTTPReactor> reactor;     ///< Реактор
     };
 
-    using PConnection = std::unique_ptr<Connection>;            ///< указатель на соединение
-
 private:
-    std::unordered_map<quint64, PConnection> _poolConnections;  ///< Пулл потоков соединий
-
-    std::queue<Connection*> _freeConnections;                   ///< очередь свободных соединений
-    std::unordered_map<quint64, Connection*> _busyConnections;  ///< очередь соединеий занятых обработкой данных
+    std::vector<Reactor> _reactors;                             ///< Реакторы
+    std::unique_ptr<TradingCatCommon::AdmissionControl> _admissionControl;   ///< Допуск запросов. Общий для всех реакторов
+    std::unique_ptr<TradingCatCommon::ServerMetrics> _metrics;  ///< Метрики сервера. Каждый реактор пишет в свой блок
 
     const HTTPServerConfig& _serverConfig;                      ///< Конфигуация сервера
     const TradingCatCommon::TradingData& _data;                 ///< ССылка на объект данных
+    TradingCatCommon::PushChannel* const _pushChannel = nullptr;  ///< Канал рассылки событий
 
     QDateTime _startDateTime = QDateTime::currentDateTime();    ///< Время запуска сервера
 
+    quint32 _listeningCount = 0;                                ///< Количество реакторов, начавших прием соединений
     bool _isStarted = false;                                    ///< флаг усешного запуска
 
 };
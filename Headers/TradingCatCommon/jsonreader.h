@@ -0,0 +1,143 @@
+#pragma once
+
+//STL
+#include <vector>
+
+//Qt
+#include <QByteArray>
+#include <QByteArrayView>
+#include <QString>
+
+namespace TradingCatCommon
+{
+
+///////////////////////////////////////////////////////////////////////////////
+///     The JsonReader class - потоковый (pull) разбор JSON без построения QJsonDocument.
+///         Значения читаются по порядку непосредственно в целевые структуры.
+///         Путь к текущему элементу хранится в виде стека и преобразуется в строку
+///         только при формировании сообщения об ошибке.
+///         Все ошибки разбора генерируют исключение Common::ParseException
+///
+class JsonReader final
+{
+public:
+    /*!
+        Типы значений JSON
+    */
+    enum class ValueType: quint8
+    {
+        OBJECT = 0,     ///< Объект
+        ARRAY = 1,      ///< Массив
+        STRING = 2,     ///< Строка
+        NUMBER = 3,     ///< Число
+        BOOL = 4,       ///< Логическое значение
+        NULL_VALUE = 5  ///< null
+    };
+
+public:
+    /*!
+        Конструктор
+        @param json - данные в кодировке UTF-8. Данные должны существовать все время жизни объекта
+        @param rootPath - имя корневого элемента в сообщениях об ошибках
+    */
+    explicit JsonReader(QByteArrayView json, const QString& rootPath = QString("Root"));
+
+    /*!
+        Деструктор
+    */
+    ~JsonReader() = default;
+
+    /*!
+        Начало чтения объекта
+    */
+    void beginObject();
+
+    /*!
+        Переходит к следующему ключу объекта. Если объект закончился - завершает его чтение
+        @return true - прочитан очередной ключ (доступен через key()), false - объект закончился
+    */
+    bool nextKey();
+
+    /*!
+        Возвращает последний прочитанный ключ объекта. Значение действительно до следующего вызова nextKey()
+        @return ключ
+    */
+    QByteArrayView key() const noexcept;
+
+    /*!
+        Начало чтения массива
+    */
+    void beginArray();
+
+    /*!
+        Переходит к следующему элементу массива. Если массив закончился - завершает его чтение
+        @return true - есть очередной элемент, false - массив закончился
+    */
+    bool nextElement();
+
+    /*!
+        Возвращает тип следующего значения без его чтения
+        @return тип значения
+    */
+    ValueType nextValueType();
+
+    QString readString();
+    double readDouble();
+    float readFloat();
+    qint64 readInt64();
+    bool readBool();
+
+    /*!
+        Читает значение null, если оно является следующим значением
+        @return true - значение null было прочитано
+    */
+    bool readNull();
+
+    /*!
+        Пропускает очередное значение любого типа
+    */
+    void skipValue();
+
+    /*!
+        Проверяет, что после корневого значения нет данных
+    */
+    void end();
+
+    /*!
+        Генерирует исключение Common::ParseException с указанием пути к текущему элементу
+        @param msg - описание ошибки
+    */
+    [[noreturn]] void error(const QString& msg) const;
+
+private:
+    JsonReader() = delete;
+    Q_DISABLE_COPY_MOVE(JsonReader);
+
+    struct Level
+    {
+        bool isArray = false;       ///< true - массив, false - объект
+        bool isFirst = true;        ///< true - еще не было прочитано ни одного элемента
+        qsizetype index = -1;       ///< Индекс текущего элемента массива
+        QByteArrayView key;         ///< Текущий ключ объекта
+    };
+
+    void skipWhitespace() noexcept;
+    char peek();
+    void expect(char ch);
+    QByteArrayView readNumberView();
+    QByteArrayView readRawString(QByteArray& buffer);
+    QString path() const;
+
+private:
+    const char* _begin = nullptr;   ///< Начало данных
+    const char* _pos = nullptr;     ///< Текущая позиция
+    const char* _end = nullptr;     ///< Конец данных
+
+    const QString _rootPath;        ///< Имя корневого элемента
+
+    std::vector<Level> _levels;     ///< Стек открытых объектов и массивов
+    QByteArray _keyBuffer;          ///< Буфер ключа, содержащего экранированные символы
+
+};
+
+} // namespace TradingCatCommon
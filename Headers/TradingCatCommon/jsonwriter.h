@@ -0,0 +1,129 @@
+#pragma once
+
+//STL
+#include <vector>
+
+//Qt
+#include <QByteArray>
+#include <QByteArrayView>
+#include <QString>
+#include <QFlags>
+
+namespace TradingCatCommon
+{
+
+///////////////////////////////////////////////////////////////////////////////
+///     The JsonWriter class - потоковая запись JSON без построения промежуточного
+///         QJsonDocument. Данные дописываются в конец переданного буфера, поэтому
+///         один буфер можно переиспользовать между ответами.
+///         Результат побайтово совпадает с QJsonDocument::toJson(QJsonDocument::Compact)
+///         при условии, что ключи объектов записываются в алфавитном порядке
+///         (QJsonObject хранит ключи отсортированными). Исключение - числа float,
+///         которые записываются в кратчайшем представлении с точностью float
+///
+class JsonWriter final
+{
+public:
+    /*!
+        Параметры представления данных
+    */
+    enum class Option: quint32
+    {
+        COLUMNAR_KLINES = 0x0001    ///< Списки свечей одной серии записываются в колоночном формате
+    };
+
+    Q_DECLARE_FLAGS(Options, Option);
+
+public:
+    /*!
+        Конструктор
+        @param buffer - буфер в конец которого будут дописываться данные
+        @param options - параметры представления данных
+    */
+    explicit JsonWriter(QByteArray& buffer, Options options = Options());
+
+    /*!
+        Деструктор
+    */
+    ~JsonWriter() = default;
+
+    void beginObject();
+    void endObject();
+    void beginArray();
+    void endArray();
+
+    /*!
+        Записывает ключ объекта. Ключ не экранируется и должен состоять из печатных ASCII символов
+        @param key - ключ
+    */
+    void key(QByteArrayView key);
+
+    void value(const QString& value);
+    void value(double value);
+    void value(float value);
+    void value(qint64 value);
+    void value(int value);
+    void value(bool value);
+    void nullValue();
+    void value(const char* value) = delete; ///< Запрещаем неявное преобразование строки в bool
+
+    /*!
+        Записывает заранее сериализованное значение как есть
+        @param json - корректное JSON представление значения
+    */
+    void rawValue(QByteArrayView json);
+
+    /*!
+        Записывает пару ключ-значение
+        @param key - ключ
+        @param value - значение
+    */
+    template <typename T>
+    void keyValue(QByteArrayView key, T&& value);
+
+    /*!
+        Возвращает буфер с записанными данными
+        @return буфер
+    */
+    QByteArray& buffer() noexcept;
+
+    /*!
+        Возвращает параметры представления данных
+        @return параметры
+    */
+    Options options() const noexcept;
+
+    /*!
+        Экранирует строку по правилам QJsonDocument и дописывает ее в буфер в кодировке UTF-8
+        @param buffer - буфер
+        @param str - строка
+    */
+    static void appendEscapedString(QByteArray& buffer, QStringView str);
+
+private:
+    JsonWriter() = delete;
+    Q_DISABLE_COPY_MOVE(JsonWriter);
+
+    /*!
+        Дописывает разделитель перед очередным значением массива или ключом объекта
+    */
+    void separator();
+
+private:
+    QByteArray& _buffer;            ///< Буфер с результатом
+    const Options _options;         ///< Параметры представления данных
+    std::vector<bool> _isFirst;     ///< Стек признаков "первый элемент" открытых объектов и массивов
+    bool _isAfterKey = false;       ///< true - последним был записан ключ и ожидается значение
+
+};
+
+template <typename T>
+void JsonWriter::keyValue(QByteArrayView key, T&& value)
+{
+    this->key(key);
+    this->value(std::forward<T>(value));
+}
+
+} // namespace TradingCatCommon
+
+Q_DECLARE_OPERATORS_FOR_FLAGS(TradingCatCommon::JsonWriter::Options);
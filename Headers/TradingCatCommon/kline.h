@@ -4,6 +4,8 @@
 #include <list>
 #include <memory>
 #include <unordered_set>
+#include <atomic>
+#include <functional>
 
 //QT
 #include <QDateTime>
@@ -175,11 +177,51 @@ bool operator==(const TradingCatCommon::KLineID& key1, const TradingCatCommon::K
  */
 bool operator!=(const TradingCatCommon::KLineID& key1, const TradingCatCommon::KLineID& key2);
 
+///////////////////////////////////////////////////////////////////////////////
+///     The SerializedCache class - кеш сериализованного представления данных.
+///         Значение формируется при первом обращении и далее не изменяется. Обращение
+///         из нескольких потоков одновременно безопасно. При копировании значение не копируется.
+///         Значение возвращается копией (QByteArray неявно разделяемый), поэтому очистка кеша
+///         не затрагивает данные, уже полученные другими потоками
+///
+class SerializedCache
+{
+public:
+    SerializedCache() = default;
+    SerializedCache(const SerializedCache& cache) noexcept;
+    SerializedCache& operator=(const SerializedCache& cache) noexcept;
+    ~SerializedCache() = default;
+
+    /*!
+        Возвращает закешированное значение. При первом обращении значение формируется функцией make
+        @param make - функция формирования значения
+        @return закешированное значение
+    */
+    QByteArray get(const std::function<QByteArray()>& make) const;
+
+    /*!
+        Очищает кеш
+    */
+    void clear() noexcept;
+
+private:
+    mutable std::atomic<std::shared_ptr<const QByteArray>> _data;
+};
+
 /*!
     Данные свечи
  */
 struct KLine
 {
+    /*!
+        Формат сериализованного представления свечи
+    */
+    enum class SerializedFormat: quint8
+    {
+        JSON = 0,   ///< JSON объект свечи
+        BINARY = 1  ///< Данные свечи без ИД в двоичном формате
+    };
+
     float open = 0.0f;     ///< цена в момент открытия
     float high = 0.0f;     ///< наибольшая свеча
     float low = 0.0f;      ///< наименьшая свеча
@@ -211,11 +253,24 @@ struct KLine
 
     const QString& toString() const;
 
+    /*!
+        Возвращает сериализованное представление свечи. Представление формируется функцией make при первом обращении
+            и далее переиспользуется во всех ответах, в которые входит свеча. После первого обращения данные свечи
+            изменяться не должны
+        @param format - формат представления
+        @param make - функция сериализации свечи
+        @return сериализованное представление свечи
+    */
+    QByteArray serialized(SerializedFormat format, const std::function<QByteArray()>& make) const;
+
 private:
     mutable std::optional<float> _delta;
     mutable std::optional<float> _volume;
 
     mutable std::optional<QString> _data;
+
+    SerializedCache _json;
+    SerializedCache _binary;
 };
 
 /*!
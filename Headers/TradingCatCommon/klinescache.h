@@ -0,0 +1,155 @@
+#pragma once
+
+//STL
+#include <list>
+#include <map>
+#include <optional>
+#include <unordered_map>
+
+//My
+#include "TradingCatCommon/kline.h"
+#include "TradingCatCommon/stockexchange.h"
+
+namespace TradingCatCommon
+{
+
+///////////////////////////////////////////////////////////////////////////////
+///     The KLinesCache class - локальный кеш свечей клиента. Для каждой серии (биржа + ИД свечи)
+///         хранится ограниченное количество последних свечей и непрерывный интервал, в котором
+///         в кеше есть все свечи. По этому интервалу определяется, какую часть истории нужно
+///         запросить у сервера. Количество серий ограничено, при переполнении удаляется
+///         серия, к которой дольше всего не обращались
+///
+class KLinesCache final
+{
+public:
+    /*!
+        Интервал времени закрытия свечей (мсек epoch, включительно)
+    */
+    struct Range
+    {
+        qint64 start = 0;   ///< Начало интервала
+        qint64 end = 0;     ///< Конец интервала
+    };
+
+public:
+    /*!
+        Конструктор
+        @param maxKLines - максимальное количество свечей одной серии
+        @param maxSeries - максимальное количество серий
+    */
+    KLinesCache(qsizetype maxKLines, qsizetype maxSeries);
+
+    /*!
+        Деструктор
+    */
+    ~KLinesCache() = default;
+
+    /*!
+        Добавляет новые свечи. Свечи продлевают интервал полных данных серии, если следуют за ним без пропусков
+        @param stockExchangeId - ИД биржи
+        @param klines - список свечей. Может содержать свечи разных серий
+    */
+    void addKLines(const TradingCatCommon::StockExchangeID& stockExchangeId, const TradingCatCommon::PKLinesList& klines);
+
+    /*!
+        Добавляет историю свечей, полученную от сервера. Сервер возвращает все свечи интервала,
+            поэтому интервал от start до последней полученной свечи становится интервалом полных данных
+        @param stockExchangeId - ИД биржи
+        @param klineId - ИД свечи
+        @param start - начало запрошенного интервала (мсек epoch)
+        @param klines - список свечей
+    */
+    void addHistory(const TradingCatCommon::StockExchangeID& stockExchangeId, const TradingCatCommon::KLineID& klineId,
+                    qint64 start, const TradingCatCommon::PKLinesList& klines);
+
+    /*!
+        Возвращает часть интервала, свечей которой нет в кеше. Свечи, которые к моменту now еще не закрылись, не учитываются
+        @param stockExchangeId - ИД биржи
+        @param klineId - ИД свечи
+        @param start - начало интервала (мсек epoch)
+        @param end - конец интервала (мсек epoch)
+        @param now - текущее время (мсек epoch)
+        @return интервал, который нужно запросить у сервера. std::nullopt - все свечи интервала есть в кеше
+    */
+    std::optional<Range> missingRange(const TradingCatCommon::StockExchangeID& stockExchangeId, const TradingCatCommon::KLineID& klineId,
+                                      qint64 start, qint64 end, qint64 now) const;
+
+    /*!
+        Возвращает свечи серии за интервал
+        @param stockExchangeId - ИД биржи
+        @param klineId - ИД свечи
+        @param start - начало интервала (мсек epoch)
+        @param end - конец интервала (мсек epoch)
+        @return список свечей в порядке убывания времени закрытия. Гарантируется что указатель не равен nullptr
+    */
+    TradingCatCommon::PKLinesList getKLines(const TradingCatCommon::StockExchangeID& stockExchangeId, const TradingCatCommon::KLineID& klineId,
+                                            qint64 start, qint64 end);
+
+    /*!
+        Удаляет все свечи
+    */
+    void clear();
+
+private:
+    KLinesCache() = delete;
+    Q_DISABLE_COPY_MOVE(KLinesCache);
+
+    /*!
+        Ключ серии свечей
+    */
+    struct SeriesKey
+    {
+        TradingCatCommon::StockExchangeID stockExchangeId;  ///< ИД биржи
+        TradingCatCommon::KLineID klineId;                  ///< ИД свечи
+
+        bool operator==(const SeriesKey& key) const = default;
+    };
+
+    struct SeriesKeyHash
+    {
+        size_t operator()(const SeriesKey& key) const noexcept;
+    };
+
+    /*!
+        Свечи серии
+    */
+    struct Series
+    {
+        std::map<qint64, TradingCatCommon::PKLine> klines;  ///< Свечи по времени закрытия
+        std::optional<Range> covered;                       ///< Интервал, в котором в кеше есть все свечи
+        std::list<SeriesKey>::iterator usage;               ///< Положение серии в списке использования
+    };
+
+    /*!
+        Возвращает серию, создавая ее при необходимости, и отмечает ее как последнюю использованную
+        @param key - ключ серии
+        @return серия
+    */
+    Series& series(const SeriesKey& key);
+
+    /*!
+        Объединяет интервал полных данных серии с новым интервалом. Если интервалы не пересекаются
+            и не соприкасаются - остается более новый
+        @param series - серия
+        @param range - новый интервал
+        @param period - длительность свечи (мсек)
+    */
+    static void mergeCovered(Series& series, const Range& range, qint64 period);
+
+    /*!
+        Удаляет самые старые свечи серии сверх maxKLines
+        @param series - серия
+    */
+    void trim(Series& series) const;
+
+private:
+    const qsizetype _maxKLines = 0;     ///< Максимальное количество свечей одной серии
+    const qsizetype _maxSeries = 0;     ///< Максимальное количество серий
+
+    std::unordered_map<SeriesKey, Series, SeriesKeyHash> _series;  ///< Серии свечей
+    std::list<SeriesKey> _usage;        ///< Ключи серий от последней использованной к давно не использованной
+
+};
+
+} // namespace TradingCatCommon
@@ -57,6 +57,23 @@ public:
                                                  const qint64 start,
                                                  const qint64 end) const;
 
+    /*!
+        Возвращает не более maxCount самых новых свечей за заданный период. Используется для
+            передачи больших периодов частями: следующая часть запрашивается с концом периода
+            раньше времени закрытия последней полученной свечи
+        @param stockExchangeID - ИД биржи
+        @param klineID - ИД свечи
+        @param start - время начала периода (мсек epoch)
+        @param end - время конца периода (мсек epoch)
+        @param maxCount - максимальное количество свечей
+        @return список свечей в порядке убывания времени закрытия
+    */
+    TradingCatCommon::PKLinesList getKLinesOnDate(const TradingCatCommon::StockExchangeID& stockExchangeID,
+                                                 const TradingCatCommon::KLineID& klineID,
+                                                 const qint64 start,
+                                                 const qint64 end,
+                                                 const qsizetype maxCount) const;
+
     /*!
         Возвращает список поддерживаемых бирж
         @return список поддерживаемых бирж
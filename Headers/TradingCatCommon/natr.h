@@ -0,0 +1,279 @@
+#pragma once
+
+//STL
+#include <atomic>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <unordered_map>
+#include <future>
+#include <list>
+#include <vector>
+
+//Qt
+#include <QObject>
+#include <QTimer>
+#include <QMutex>
+
+//My
+#include "TradingCatCommon/kline.h"
+#include "TradingCatCommon/stockexchange.h"
+#include "TradingCatCommon/tradingdata.h"
+
+namespace TradingCatCommon
+{
+
+///////////////////////////////////////////////////////////////////////////////
+///     The Natr class - расчетные значения НАТР одной серии свечей.
+///         Значения хранятся в атомарных переменных, поэтому чтение возможно из
+///         любого потока без блокировок. Актуальность значений контролирует NatrsScheduler
+///
+class Natr final
+{
+public:
+    /*!
+        Конструктор. Создает пустой НАТР без привязки к серии свечей
+    */
+    Natr() = default;
+
+    /*!
+        Привязывает НАТР к серии свечей и сбрасывает рассчитанные значения.
+            Метод вызывается только при регистрации серии в Natrs до публикации ее ИД
+        @param stockExchangeId - ИД биржи. Не должен быть пустым
+        @param klineId - ИД свечи. Не должен быть пустым
+    */
+    void reset(const TradingCatCommon::StockExchangeID& stockExchangeId, const TradingCatCommon::KLineID& klineId);
+
+    /*!
+        Расчитывает НАТР по списку свечей. Если свечей недостаточно или значения уже рассчитаны по более новым
+            свечам - значения не изменяются. Одновременные расчеты одной серии выполняются по очереди
+        @param klines - список свечей серии
+        @return true - если значения были пересчитаны
+    */
+    bool calculate(const TradingCatCommon::PKLinesList& klines);
+
+    /*!
+        Отмечает, что для расчета недостаточно свечей. Следующая попытка расчета в фоне
+            будет не раньше чем через интервал пересчета
+        @param currentDateTime - текущее время в мсек Epoch
+    */
+    void setInsufficientData(qint64 currentDateTime) noexcept;
+
+    /*!
+        Сбрасывает рассчитанные значения
+    */
+    void clear() noexcept;
+
+    /*!
+        Возвращает среднюю цену закрытия. Метод не проверяет актуальность значения
+        @return средняя цена закрытия или std::nullopt если значение не рассчитано
+    */
+    std::optional<double> close() const noexcept;
+
+    /*!
+        Возвращает средний объем. Метод не проверяет актуальность значения
+        @return средний объем или std::nullopt если значение не рассчитано
+    */
+    std::optional<double> volume() const noexcept;
+
+    /*!
+        Возвращает время закрытия самой новой свечи, участвовавшей в расчете
+        @return время в мсек Epoch или 0 если НАТР еще не рассчитывался
+    */
+    qint64 oldNatr() const noexcept;
+
+    /*!
+        Возвращает true если рассчитанные значения устарели и не должны использоваться
+        @param currentDateTime - текущее время в мсек Epoch
+        @return true если значения устарели
+    */
+    bool isExpired(qint64 currentDateTime) const noexcept;
+
+    /*!
+        Возвращает true если значения пора пересчитать. Серия, для которой недавно не хватило свечей, не пересчитывается
+        @param currentDateTime - текущее время в мсек Epoch
+        @return true если значения необходимо пересчитать
+    */
+    bool isStale(qint64 currentDateTime) const noexcept;
+
+    /*!
+        Отмечает серию как поставленную в очередь фонового пересчета
+        @return true - серия поставлена в очередь, false - серия уже ожидает пересчета или пересчитывается
+    */
+    bool trySchedule() noexcept;
+
+    /*!
+        Снимает отметку о постановке серии в очередь фонового пересчета
+    */
+    void finishSchedule() noexcept;
+
+    const TradingCatCommon::StockExchangeID& stockExchangeId() const noexcept;
+    const TradingCatCommon::KLineID& klineId() const noexcept;
+
+private:
+    Q_DISABLE_COPY_MOVE(Natr);
+
+private:
+    TradingCatCommon::StockExchangeID _stockExchangeId;   ///< ИД биржи
+    TradingCatCommon::KLineID _klineId;                   ///< ИД свечи
+
+    std::atomic<double> _close = std::numeric_limits<double>::quiet_NaN();  ///< Средняя цена закрытия. NaN - значение не рассчитано
+    std::atomic<double> _volume = std::numeric_limits<double>::quiet_NaN(); ///< Средний объем. NaN - значение не рассчитано
+    std::atomic<qint64> _old = 0;   ///< Время закрытия самой новой свечи участвовавшей в расчете (мсек Epoch)
+    std::atomic<qint64> _insufficientData = 0;  ///< Время последней попытки расчета, для которой не хватило свечей (мсек Epoch)
+    std::atomic<bool> _isScheduled = false;     ///< Серия входит в запущенную пачку фонового пересчета
+
+    QMutex _calculateMutex;         ///< Блокировка расчета. Расчет вызывается из потока пользователя и из NatrsScheduler
+
+};
+
+///////////////////////////////////////////////////////////////////////////////
+///     The Natrs class - плоская таблица НАТРов, индексируемая ИД серии свечей.
+///         Поиск ИД серии выполняется один раз при регистрации, далее чтение
+///         выполняется по индексу без блокировок и выделения памяти
+///
+class Natrs final
+{
+public:
+    using SeriesId = quint32; ///< ИД серии свечей (индекс в таблице)
+
+public:
+    /*!
+        Конструктор
+        @param maxSeriesCount - максимальное количество серий свечей. Таблица выделяется сразу и никогда не перемещается
+    */
+    explicit Natrs(quint32 maxSeriesCount = 100000u);
+
+    /*!
+        Деструктор
+    */
+    ~Natrs() = default;
+
+    /*!
+        Возвращает ИД серии свечей. Если серия еще не зарегистрирована - регистрирует ее
+        @param stockExchangeId - ИД биржи. Не должен быть пустым
+        @param klineId - ИД свечи. Не должен быть пустым
+        @return ИД серии или std::nullopt если таблица заполнена
+    */
+    std::optional<SeriesId> seriesId(const TradingCatCommon::StockExchangeID& stockExchangeId, const TradingCatCommon::KLineID& klineId);
+
+    /*!
+        Возвращает ИД ранее зарегистрированной серии свечей
+        @param stockExchangeId - ИД биржи
+        @param klineId - ИД свечи
+        @return ИД серии или std::nullopt если серия не зарегистрирована
+    */
+    std::optional<SeriesId> findSeriesId(const TradingCatCommon::StockExchangeID& stockExchangeId, const TradingCatCommon::KLineID& klineId) const;
+
+    /*!
+        Возвращает НАТР серии. Метод не выполняет блокировок и проверок актуальности
+        @param id - ИД серии, ранее полученный через seriesId(...) или findSeriesId(...)
+        @return НАТР серии
+    */
+    const Natr& natr(SeriesId id) const noexcept;
+    Natr& natr(SeriesId id) noexcept;
+
+    /*!
+        Возвращает количество зарегистрированных серий
+        @return количество серий
+    */
+    quint32 count() const noexcept;
+
+    /*!
+        Расчитывает НАТР по списку свечей одной серии
+        @param stockExchangeId - ИД биржи
+        @param klines - список свечей. Не должен быть пустым
+    */
+    void calculateNatr(const TradingCatCommon::StockExchangeID& stockExchangeId, const TradingCatCommon::PKLinesList& klines);
+
+private:
+    Q_DISABLE_COPY_MOVE(Natrs);
+
+private:
+    using KLineSeriesMap = std::unordered_map<TradingCatCommon::KLineID, SeriesId>;
+
+    const quint32 _maxSeriesCount = 0;                      ///< Емкость таблицы
+    std::unique_ptr<Natr[]> _table;                         ///< Таблица НАТРов
+    std::atomic<quint32> _count = 0;                        ///< Количество опубликованных серий
+
+    mutable QMutex _registerMutex;                          ///< Блокировка регистрации новых серий
+    std::unordered_map<TradingCatCommon::StockExchangeID, KLineSeriesMap> _seriesMap; ///< Индекс серий
+
+};
+
+///////////////////////////////////////////////////////////////////////////////
+///     The NatrsScheduler class - фоновый пересчет устаревших НАТРов.
+///         Класс периодически просматривает таблицу, сбрасывает устаревшие значения
+///         и пересчитывает их пачками в пуле рабочих потоков. Серия, входящая в еще не
+///         завершенную пачку, повторно в пересчет не ставится
+///
+class NatrsScheduler final
+    : public QObject
+{
+    Q_OBJECT
+
+public:
+    /*!
+        Конструктор
+        @param natrs - таблица НАТРов
+        @param tradingData - источник свечей для пересчета
+        @param parent - указатель на родительский класс
+    */
+    NatrsScheduler(TradingCatCommon::Natrs& natrs, const TradingCatCommon::TradingData& tradingData, QObject* parent = nullptr);
+
+    /*!
+        Деструктор. Дожидается завершения запущенных пересчетов
+    */
+    ~NatrsScheduler() override;
+
+public slots:
+    /*!
+        Начало работы класса.
+    */
+    void start();
+
+    /*!
+        Завершение работы класса
+    */
+    void stop();
+
+signals:
+    /*!
+        Сигнал генерируется после остановки работы класса
+    */
+    void finished();
+
+private slots:
+    /*!
+        Просматривает таблицу и запускает пересчет устаревших значений
+    */
+    void schedule();
+
+private:
+    NatrsScheduler() = delete;
+    Q_DISABLE_COPY_MOVE(NatrsScheduler);
+
+    using SeriesIdList = std::vector<TradingCatCommon::Natrs::SeriesId>;
+
+    /*!
+        Пересчитывает пачку серий и снимает с них отметку о постановке в очередь. Выполняется в рабочем потоке
+        @param natrs - таблица НАТРов
+        @param tradingData - источник свечей
+        @param batch - список ИД серий
+        @param currentDateTime - время начала пересчета (мсек Epoch)
+    */
+    static void recalculate(TradingCatCommon::Natrs& natrs, const TradingCatCommon::TradingData& tradingData, SeriesIdList batch, qint64 currentDateTime);
+
+private:
+    TradingCatCommon::Natrs& _natrs;                    ///< Таблица НАТРов
+    const TradingCatCommon::TradingData& _tradingData;  ///< Источник свечей
+
+    std::unique_ptr<QTimer> _timer;                     ///< Таймер планировщика
+    std::list<std::future<void>> _workers;              ///< Запущенные пересчеты
+    TradingCatCommon::Natrs::SeriesId _nextSeriesId = 0;///< ИД серии с которой начнется следующий просмотр таблицы
+
+    bool _isStarted = false;                            ///< Флаг успешного запуска
+
+};
+
+} // namespace TradingCatCommon
@@ -0,0 +1,93 @@
+#pragma once
+
+//STL
+#include <optional>
+
+//Qt
+#include <QByteArray>
+#include <QByteArrayView>
+#include <QString>
+
+namespace TradingCatCommon
+{
+
+/*!
+    Дописывает в конец буфера кратчайшее представление числа, из которого число восстанавливается без потерь.
+        Нечисловые значения (NaN, inf) записываются как nan/inf, поэтому для JSON их нужно проверять заранее
+    @param buffer - буфер
+    @param value - число
+*/
+void appendNumber(QByteArray& buffer, double value);
+
+/*!
+    Дописывает в конец буфера кратчайшее представление числа с точностью float, из которого число
+        восстанавливается без потерь. Представление короче, чем у того же числа приведенного к double
+    @param buffer - буфер
+    @param value - число
+*/
+void appendNumber(QByteArray& buffer, float value);
+
+/*!
+    Дописывает в конец буфера десятичное представление целого числа
+    @param buffer - буфер
+    @param value - число
+*/
+void appendNumber(QByteArray& buffer, qint64 value);
+
+/*!
+    Дописывает в конец буфера число в формате с фиксированной точкой
+    @param buffer - буфер
+    @param value - число
+    @param precision - количество знаков после точки
+*/
+void appendFixedNumber(QByteArray& buffer, double value, int precision);
+
+/*!
+    Дописывает в конец буфера число с заданным количеством значащих цифр (формат %g)
+    @param buffer - буфер
+    @param value - число
+    @param precision - количество значащих цифр
+*/
+void appendGeneralNumber(QByteArray& buffer, double value, int precision);
+
+/*!
+    Возвращает кратчайшее представление числа, из которого число восстанавливается без потерь
+    @param value - число
+    @return строковое представление числа
+*/
+QString numberToString(double value);
+QString numberToString(float value);
+QString numberToString(qint64 value);
+
+/*!
+    Возвращает число в формате с фиксированной точкой. Замена QString::arg(value, 0, 'f', precision)
+    @param value - число
+    @param precision - количество знаков после точки
+    @return строковое представление числа
+*/
+QString fixedNumberToString(double value, int precision = 6);
+
+/*!
+    Возвращает число с заданным количеством значащих цифр. Замена QString::arg(value) для сообщений,
+        предназначенных для чтения человеком
+    @param value - число
+    @param precision - количество значащих цифр
+    @return строковое представление числа
+*/
+QString generalNumberToString(double value, int precision = 6);
+
+/*!
+    Разбирает число с плавающей точкой. Строка должна целиком состоять из числа. Ведущий знак + не допускается
+    @param str - строка
+    @return число или std::nullopt если строка не является числом
+*/
+std::optional<double> parseDouble(QByteArrayView str) noexcept;
+
+/*!
+    Разбирает целое число. Строка должна целиком состоять из числа. Ведущий знак + не допускается
+    @param str - строка
+    @return число или std::nullopt если строка не является целым числом или число выходит за пределы qint64
+*/
+std::optional<qint64> parseInt64(QByteArrayView str) noexcept;
+
+} // namespace TradingCatCommon
@@ -0,0 +1,193 @@
+#pragma once
+
+//STL
+#include <deque>
+#include <memory>
+#include <unordered_set>
+#include <vector>
+
+//Qt
+#include <QObject>
+#include <QByteArray>
+
+//My
+#include "TradingCatCommon/detector.h"
+#include "TradingCatCommon/kline.h"
+#include "TradingCatCommon/stockexchange.h"
+
+namespace TradingCatCommon
+{
+
+/*!
+    Тип события канала рассылки
+*/
+enum class PushEventType: quint8
+{
+    DETECT = 0,     ///< Сработка детектора для сессии пользователя
+    KLINES = 1,     ///< Новые свечи биржи
+    LOST = 2        ///< Часть событий после курсора клиента уже удалена из журнала
+};
+
+/*!
+    Преобразует тип события в строку
+    @param type - тип события
+    @return строковое представление типа события
+*/
+QString pushEventTypeToString(TradingCatCommon::PushEventType type);
+
+/*!
+    Преобразует строку в тип события
+    @param type - строковое представление типа события
+    @return тип события или std::nullopt если строка не является типом события
+*/
+std::optional<TradingCatCommon::PushEventType> stringToPushEventType(QStringView type);
+
+///////////////////////////////////////////////////////////////////////////////
+///     The PushChannel class - журнал событий для рассылки клиентам по WebSocket.
+///         Каждое событие сериализуется один раз в готовый кадр WebSocket и получает
+///         курсор - возрастающий номер. Соединения забирают события после своего курсора
+///         в своем потоке, поэтому медленный клиент не задерживает остальных, а при
+///         переподключении клиент продолжает получение с последнего полученного курсора.
+///         Журнал ограничен по количеству событий, старые события удаляются.
+///         Подписаться можно только на открытую сессию: сессии открывает и закрывает владелец
+///         сессий пользователей (обработка Login/Logout). ИД сессии - единственное подтверждение
+///         права на события сессии, поэтому ИД должны выдаваться случайными, а не последовательными
+///
+class PushChannel final
+    : public QObject
+{
+    Q_OBJECT
+
+public:
+    using PFrame = std::shared_ptr<const QByteArray>;   ///< Кадр WebSocket с событием
+
+    /*!
+        События для отправки соединению
+    */
+    struct Events
+    {
+        std::vector<PFrame> frames;     ///< Кадры событий
+        quint64 cursor = 0;             ///< Курсор последнего просмотренного события
+        bool isLost = false;            ///< true - часть событий после курсора соединения уже удалена из журнала
+        bool isClosed = false;          ///< true - сессия закрыта, события сессии больше не передаются
+    };
+
+public:
+    /*!
+        Конструктор
+        @param capacity - максимальное количество событий в журнале
+        @param parent - указатель на родительский класс
+    */
+    explicit PushChannel(quint64 capacity = 10000, QObject* parent = nullptr);
+
+    /*!
+        Деструктор
+    */
+    ~PushChannel() override = default;
+
+    /*!
+        Возвращает курсор последнего события журнала. Потокобезопасен
+        @return курсор последнего события. 0 - событий еще не было
+    */
+    quint64 cursor() const;
+
+    /*!
+        Возвращает события после курсора, предназначенные сессии пользователя. Потокобезопасен
+        @param cursor - курсор последнего отправленного соединению события
+        @param sessionId - ИД сессии пользователя
+        @param isKLines - true - включать события новых свечей
+        @param maxBytes - максимальный суммарный размер кадров. Хотя бы одно событие возвращается всегда
+        @return события. Если сессия закрыта - события не возвращаются, Events::isClosed = true
+    */
+    Events eventsAfter(quint64 cursor, qint64 sessionId, bool isKLines, qint64 maxBytes) const;
+
+    /*!
+        Возвращает true если сессия открыта и на ее события можно подписаться. Потокобезопасен
+        @param sessionId - ИД сессии пользователя
+        @return true - сессия открыта
+    */
+    bool isSession(qint64 sessionId) const;
+
+    /*!
+        Формирует кадр с событием о потере части событий. Клиент должен запросить пропущенные данные обычными запросами
+        @param cursor - курсор соединения, после которого часть событий удалена из журнала
+        @return кадр WebSocket
+    */
+    static QByteArray lostFrame(quint64 cursor);
+
+public slots:
+    /*!
+        Открывает сессию пользователя: соединения с этим ИД сессии могут подписаться на ее события
+        @param sessionId - ИД сессии пользователя. Не должен быть равен 0
+    */
+    void openSession(qint64 sessionId);
+
+    /*!
+        Закрывает сессию пользователя. Новые подписки на события сессии не принимаются,
+            подписанные соединения закрываются при следующем обращении за событиями (сигнал sessionClosed())
+        @param sessionId - ИД сессии пользователя
+    */
+    void closeSession(qint64 sessionId);
+
+    /*!
+        Добавляет в журнал сработку детектора
+        @param sessionId - ИД сессии пользователя
+        @param detectData - данные сработки
+    */
+    void klineDetect(qint64 sessionId, const TradingCatCommon::Detector::PKLineDetectData& detectData);
+
+    /*!
+        Добавляет в журнал новые свечи
+        @param stockExchangeId - ИД биржи
+        @param klines - список свечей
+    */
+    void addKLines(const TradingCatCommon::StockExchangeID& stockExchangeId, const TradingCatCommon::PKLinesList& klines);
+
+signals:
+    /*!
+        В журнал добавлено событие. Соединения подключаются к сигналу через очередь своих потоков
+        @param cursor - курсор добавленного события
+    */
+    void eventsAvailable(quint64 cursor);
+
+    /*!
+        Сессия пользователя закрыта. Соединения подключаются к сигналу через очередь своих потоков
+        @param sessionId - ИД сессии пользователя
+    */
+    void sessionClosed(qint64 sessionId);
+
+private:
+    // Удаляем неиспользуемые конструкторы
+    Q_DISABLE_COPY_MOVE(PushChannel);
+
+    /*!
+        Добавляет событие в журнал
+        @param type - тип события
+        @param sessionId - ИД сессии пользователя. 0 - событие для всех сессий
+        @param data - данные события в формате JSON
+    */
+    void addEvent(TradingCatCommon::PushEventType type, qint64 sessionId, const QByteArray& data);
+
+private:
+    /*!
+        Событие журнала
+    */
+    struct Event
+    {
+        quint64 cursor = 0;                                                         ///< Курсор события
+        qint64 sessionId = 0;                                                       ///< ИД сессии пользователя. 0 - для всех сессий
+        TradingCatCommon::PushEventType type = TradingCatCommon::PushEventType::DETECT; ///< Тип события
+        PFrame frame;                                                               ///< Кадр WebSocket
+    };
+
+private:
+    const quint64 _capacity = 0;    ///< Максимальное количество событий в журнале
+
+    std::deque<Event> _events;      ///< Журнал событий. Курсоры событий идут подряд
+    quint64 _lastCursor = 0;        ///< Курсор последнего события
+
+    std::unordered_set<qint64> _sessions;   ///< Открытые сессии пользователей
+
+}; //class PushChannel
+
+} //namespace TradingCatCommon
@@ -0,0 +1,153 @@
+#pragma once
+
+//STL
+#include <memory>
+#include <optional>
+
+//Qt
+#include <QObject>
+#include <QTimer>
+#include <QtNetwork/QTcpSocket>
+
+//My
+#include <Common/tdbloger.h>
+
+#include <TradingCatCommon/detector.h>
+#include <TradingCatCommon/httpclient.h>
+#include <TradingCatCommon/kline.h>
+#include <TradingCatCommon/stockexchange.h>
+#include <TradingCatCommon/websocket.h>
+
+namespace TradingCatCommon
+{
+
+///////////////////////////////////////////////////////////////////////////////
+///     The PushClient class - клиент канала рассылки событий сервера (PushQuery). Одно соединение
+///         WebSocket заменяет периодический опрос сервера: сработки детектора и новые свечи
+///         приходят по мере появления. При разрыве клиент переподключается и продолжает
+///         получение с курсора последнего полученного события. Задержка переподключения
+///         случайна и растет при повторных неудачах, как у повторов запросов HTTPClient
+///
+class PushClient final
+    : public QObject
+{
+    Q_OBJECT
+
+public:
+    /*!
+        Конструктор
+        @param config - конфигурация подключения к серверу
+        @param sessionId - ИД сессии пользователя, сработки детектора которой нужно получать
+        @param isKLines - true - получать новые свечи всех бирж
+        @param parent - указатель на родительский класс
+    */
+    PushClient(const HTTPClientConfig& config, qint64 sessionId, bool isKLines, QObject* parent = nullptr);
+
+    /*!
+        Деструктор
+    */
+    ~PushClient() override;
+
+    /*!
+        Возвращает курсор последнего полученного события
+        @return курсор
+    */
+    quint64 cursor() const noexcept;
+
+public slots:
+    /*!
+        Подключается к серверу
+    */
+    void start();
+
+    /*!
+        Отключается от сервера
+    */
+    void stop();
+
+signals:
+    void sendLogMsg(Common::TDBLoger::MSG_CODE category, const QString& msg);
+
+    /*!
+        Получена сработка детектора
+        @param detectData - данные сработки
+    */
+    void klineDetect(const TradingCatCommon::Detector::PKLineDetectData& detectData);
+
+    /*!
+        Получены новые свечи
+        @param stockExchangeId - ИД биржи
+        @param klinesList - список свечей. Гарантируется что список не пустой
+    */
+    void newKLines(const TradingCatCommon::StockExchangeID& stockExchangeId, const TradingCatCommon::PKLinesList& klinesList);
+
+    /*!
+        Часть событий потеряна (клиент отстал или сервер был перезапущен). Пропущенные данные
+            нужно запросить через HTTPClient
+    */
+    void eventsLost();
+
+    /*!
+        Соединение переведено в режим WebSocket, события приходят по мере появления
+    */
+    void opened();
+
+    /*!
+        Соединение разорвано. До переподключения события не приходят
+    */
+    void closed();
+
+private slots:
+    void connected();
+    void readyRead();
+    void disconnected();
+    void errorOccurred(QAbstractSocket::SocketError socketError);
+
+    void reconnect();
+
+private:
+    PushClient() = delete;
+    Q_DISABLE_COPY_MOVE(PushClient);
+
+    using ParseResult = std::optional<QString>;
+
+    /*!
+        Разбирает ответ сервера на запрос перехода в режим WebSocket
+        @return std::nullopt - заголовок ответа еще не принят полностью или переход выполнен, иначе - описание ошибки
+    */
+    ParseResult parseHandshake();
+
+    /*!
+        Разбирает сообщение с событием сервера
+        @param message - сообщение
+        @return std::nullopt - сообщение обработано, иначе - описание ошибки
+    */
+    ParseResult parseMessage(const QByteArray& message);
+
+    /*!
+        Закрывает соединение и планирует переподключение
+        @param msg - причина закрытия
+    */
+    void restart(const QString& msg);
+
+private:
+    const HTTPClientConfig _config;     ///< Конфигурация подключения
+    const qint64 _sessionId = 0;        ///< ИД сессии пользователя
+    const bool _isKLines = false;       ///< Получать новые свечи
+
+    QTcpSocket* _socket = nullptr;
+    QTimer* _reconnectTimer = nullptr;
+
+    std::unique_ptr<TradingCatCommon::WebSocketFrameReader> _frameReader; ///< Разбор кадров сервера
+    QByteArray _handshake;              ///< Принятая часть ответа на запрос перехода в режим WebSocket
+    QByteArray _key;                    ///< Значение заголовка Sec-WebSocket-Key
+    bool _isUpgraded = false;           ///< Соединение переведено в режим WebSocket
+    qint64 _reconnectDelay = 0;         ///< Задержка последнего переподключения (мсек). 0 - соединение еще не разрывалось
+
+    quint64 _cursor = 0;                ///< Курсор последнего полученного события
+
+    bool _isStarted = false;
+
+}; // class PushClient
+
+} // namespace TradingCatCommon
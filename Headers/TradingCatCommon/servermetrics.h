@@ -0,0 +1,221 @@
+#pragma once
+
+//STL
+#include <array>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+//Qt
+#include <QByteArray>
+#include <QStringList>
+
+namespace TradingCatCommon
+{
+
+///////////////////////////////////////////////////////////////////////////////
+///     The LatencyHistogram class - гистограмма задержек в стиле HDR Histogram: интервалы
+///         значений растут по степеням двойки, каждая степень делится на равные части, поэтому
+///         относительная погрешность одинакова во всем диапазоне, а номер интервала вычисляется
+///         несколькими битовыми операциями. Запись выполняет один поток без блокировок,
+///         читать можно из любого потока
+///
+class LatencyHistogram final
+{
+public:
+    static constexpr int SUB_BUCKET_BITS = 2;                       ///< Каждая степень двойки делится на 2^SUB_BUCKET_BITS интервалов
+    static constexpr quint64 SUB_BUCKET_COUNT = 1u << SUB_BUCKET_BITS;
+    static constexpr int MAX_VALUE_BITS = 27;                       ///< Последний интервал содержит все значения от 2^MAX_VALUE_BITS * 7/4 мксек (~235 сек)
+    static constexpr size_t BUCKET_COUNT = (MAX_VALUE_BITS - SUB_BUCKET_BITS + 2) * SUB_BUCKET_COUNT; ///< Количество интервалов
+
+    /*!
+        Снимок гистограммы
+    */
+    struct Snapshot
+    {
+        std::array<quint64, BUCKET_COUNT> counts = {};  ///< Количество значений в интервалах
+        quint64 count = 0;                              ///< Общее количество значений
+        quint64 sum = 0;                                ///< Сумма значений (мксек)
+    };
+
+public:
+    LatencyHistogram() = default;
+    ~LatencyHistogram() = default;
+
+    /*!
+        Добавляет значение. Должен вызываться только из потока-владельца
+        @param value - задержка (мксек)
+    */
+    void add(quint64 value) noexcept;
+
+    /*!
+        Добавляет текущие значения гистограммы к снимку
+        @param snapshot - снимок
+    */
+    void addTo(Snapshot& snapshot) const noexcept;
+
+    /*!
+        Возвращает верхнюю границу интервала (включительно)
+        @param index - номер интервала
+        @return верхняя граница (мксек)
+    */
+    static quint64 upperBound(size_t index) noexcept;
+
+private:
+    Q_DISABLE_COPY_MOVE(LatencyHistogram);
+
+    /*!
+        Возвращает номер интервала для значения
+        @param value - значение
+        @return номер интервала
+    */
+    static size_t bucketIndex(quint64 value) noexcept;
+
+private:
+    std::array<std::atomic<quint64>, BUCKET_COUNT> _counts = {};  ///< Количество значений в интервалах
+    std::atomic<quint64> _count = 0;                            ///< Общее количество значений
+    std::atomic<quint64> _sum = 0;                              ///< Сумма значений
+
+}; //class LatencyHistogram
+
+///////////////////////////////////////////////////////////////////////////////
+///     The ServerMetrics class - метрики HTTP сервера. Каждый поток (реактор) пишет в свой
+///         блок метрик без блокировок и атомарных read-modify-write операций. Блоки
+///         суммируются только при запросе метрик и выдаются в текстовом формате Prometheus
+///
+class ServerMetrics final
+{
+public:
+    ///////////////////////////////////////////////////////////////////////////////
+    ///     The ThreadMetrics class - метрики одного потока. Все методы изменения должны вызываться
+    ///         только из потока-владельца
+    ///
+    class ThreadMetrics final
+    {
+    public:
+        /*!
+            Конструктор
+            @param server - метрики сервера, которым принадлежит блок
+            @param routesCount - количество маршрутов
+        */
+        ThreadMetrics(const TradingCatCommon::ServerMetrics& server, size_t routesCount);
+
+        /*!
+            Возвращает метрики сервера, которым принадлежит блок
+            @return метрики сервера
+        */
+        const TradingCatCommon::ServerMetrics& server() const noexcept;
+
+        /*!
+            Учитывает обработанный запрос
+            @param route - номер маршрута
+            @param code - HTTP код ответа
+            @param received - размер запроса (байт)
+            @param sent - размер ответа (байт)
+            @param latency - время от приема первого байта запроса до отправки ответа (мксек)
+        */
+        void addRequest(size_t route, quint16 code, qint64 received, qint64 sent, quint64 latency) noexcept;
+
+        /*!
+            Учитывает данные, переданные вне ответа на запрос (события WebSocket)
+            @param route - номер маршрута
+            @param sent - размер данных (байт)
+        */
+        void addSent(size_t route, qint64 sent) noexcept;
+
+        /*!
+            Изменяет количество открытых соединений
+            @param delta - изменение
+        */
+        void addConnections(qint64 delta) noexcept;
+
+        /*!
+            Изменяет количество соединений WebSocket
+            @param delta - изменение
+        */
+        void addWebSockets(qint64 delta) noexcept;
+
+        /*!
+            Изменяет количество соединений, обработка запросов которых приостановлена до передачи ответов
+            @param delta - изменение
+        */
+        void addPaused(qint64 delta) noexcept;
+
+    private:
+        friend class ServerMetrics;
+
+        Q_DISABLE_COPY_MOVE(ThreadMetrics);
+
+        /*!
+            Счетчик. Записывает один поток, поэтому обычные load/store без read-modify-write
+        */
+        struct Counter
+        {
+            std::atomic<qint64> value = 0;
+
+            void add(qint64 delta) noexcept { value.store(value.load(std::memory_order_relaxed) + delta, std::memory_order_relaxed); }
+            qint64 get() const noexcept { return value.load(std::memory_order_relaxed); }
+        };
+
+        /*!
+            Метрики маршрута
+        */
+        struct RouteMetrics
+        {
+            Counter requests;                       ///< Количество запросов
+            Counter received;                       ///< Принято байт
+            Counter sent;                           ///< Передано байт
+            Counter errors;                         ///< Количество ответов с кодом ошибки (4xx, 5xx)
+            TradingCatCommon::LatencyHistogram latency; ///< Задержки ответов
+        };
+
+        static constexpr size_t CODES_COUNT = 600;  ///< HTTP коды 0..599
+
+    private:
+        const TradingCatCommon::ServerMetrics& _server;             ///< Метрики сервера
+        std::unique_ptr<RouteMetrics[]> _routes;                    ///< Метрики маршрутов
+        const size_t _routesCount = 0;                              ///< Количество маршрутов
+        std::array<Counter, CODES_COUNT> _codes;                    ///< Количество ответов по HTTP кодам
+        Counter _connections;                                       ///< Открытые соединения
+        Counter _webSockets;                                        ///< Соединения WebSocket
+        Counter _paused;                                            ///< Соединения с приостановленной обработкой запросов
+
+    }; //class ThreadMetrics
+
+public:
+    /*!
+        Конструктор
+        @param routes - названия маршрутов. Номер маршрута - индекс в списке
+        @param threadsCount - количество потоков
+    */
+    ServerMetrics(const QStringList& routes, size_t threadsCount);
+
+    /*!
+        Деструктор
+    */
+    ~ServerMetrics() = default;
+
+    /*!
+        Возвращает блок метрик потока
+        @param thread - номер потока
+        @return блок метрик
+    */
+    ThreadMetrics& threadMetrics(size_t thread);
+
+    /*!
+        Суммирует метрики всех потоков и формирует текст в формате Prometheus. Потокобезопасен
+        @return метрики
+    */
+    QByteArray toPrometheus() const;
+
+private:
+    ServerMetrics() = delete;
+    Q_DISABLE_COPY_MOVE(ServerMetrics);
+
+private:
+    const QStringList _routes;                                  ///< Названия маршрутов
+    std::vector<std::unique_ptr<ThreadMetrics>> _threads;       ///< Блоки метрик потоков
+
+}; //class ServerMetrics
+
+} //namespace TradingCatCommon
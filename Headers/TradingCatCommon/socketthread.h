@@ -1,5 +1,9 @@
 #pragma once
 
+//STL
+#include <chrono>
+#include <memory>
+
 //Ot
 #include <QObject>
 #include <QtNetwork/QTcpSocket>
@@ -11,6 +15,13 @@
 //My
 #include "Common/tdbloger.h"
 #include "TradingCatCommon/httprequest.h"
+#include "TradingCatCommon/httpcompression.h"
+#include "TradingCatCommon/httpanswer.h"
+#include "TradingCatCommon/admissioncontrol.h"
+#include "TradingCatCommon/pushchannel.h"
+#include "TradingCatCommon/servermetrics.h"
+#include "TradingCatCommon/websocket.h"
+#include "TradingCatCommon/transmitdata.h"
 #include "TradingCatCommon/types.h"
 #include "TradingCatCommon/tradingdata.h"
 
@@ -23,26 +34,174 @@ class SocketThread
     Q_OBJECT
 
 public:
-    SocketThread(quint64 id, const HTTPServerConfig &serverConfig, const TradingCatCommon::TradingData& data, QObject *parent = nullptr);
+    SocketThread(quint64 id, const HTTPServerConfig &serverConfig, const TradingCatCommon::TradingData& data,
+                 TradingCatCommon::AdmissionControl* admissionControl = nullptr, TradingCatCommon::PushChannel* pushChannel = nullptr,
+                 TradingCatCommon::ServerMetrics::ThreadMetrics* metrics = nullptr, QObject *parent = nullptr);
     ~SocketThread();
 
     quint64 id() const noexcept;
 
+    /*!
+        Возвращает названия маршрутов для метрик сервера. Номер маршрута - индекс в списке
+        @return названия маршрутов
+    */
+    static QStringList metricsRoutes();
+
+    /*!
+        Обработчик запроса
+        @param query - параметры запроса
+        @param format - формат ответа
+        @param encoding - [in] метод сжатия, поддерживаемый клиентом, [out] фактический метод сжатия ответа
+        @return ответ для отправки
+    */
+    using RouteHandler = QByteArray (SocketThread::*)(const QUrlQuery& query, TradingCatCommon::PackageFormat format,
+                                                      TradingCatCommon::ContentEncoding& encoding);
+
+    /*!
+        Маршрут запроса
+    */
+    struct Route
+    {
+        RouteHandler handler = nullptr;                                                     ///< Обработчик запроса
+        TradingCatCommon::RequestClass requestClass = TradingCatCommon::RequestClass::STATUS; ///< Класс запроса
+        size_t metricsRoute = 0;                                                            ///< Номер маршрута в метриках
+    };
+
+    /*!
+        Ищет маршрут по пути запроса в таблице маршрутов. Служебные пути (подписка на события, метрики)
+            в таблицу не входят и проверяются отдельно
+        @param path - путь запроса. Начинается с '/'
+        @return маршрут или nullptr если маршрут не найден
+    */
+    static const Route* findRoute(const QString& path);
+
 public slots:
     void stop();
     void startSocket(qintptr handle);
 
+    /*!
+        Принимает соединение и сразу отвечает ошибкой. Используется при превышении лимита соединений
+        @param handle - дескриптор соединения
+        @param code - HTTP код ответа
+        @param msg - текст ответа
+    */
+    void rejectSocket(qintptr handle, quint16 code, const QByteArray& msg);
+
 private:
     void parseResource();
 
-    void sendAnswer(quint16 code, const QByteArray& msg); //отправляет ответ
+    void sendAnswer(quint16 code, const QByteArray& msg, const QString& contentType = *TradingCatCommon::JSON_CONTENT_TYPE,
+                    TradingCatCommon::ContentEncoding encoding = TradingCatCommon::ContentEncoding::IDENTITY,
+                    const QHash<QString, QString>& headers = {}); //отправляет ответ
+
+    /*!
+        Проверяет допуск запроса. Если запрос не допущен - отправляет ответ с кодом ошибки и заголовком Retry-After
+        @param client - ИД клиента (IP адрес или сессия)
+        @param requestClass - класс запроса
+        @return true - запрос допущен к обработке
+    */
+    bool admitRequest(const QString& client, TradingCatCommon::RequestClass requestClass);
+
+    /*!
+        Добавляет в ответ заголовки Connection и Keep-Alive. Если соединение не остается
+            постоянным - устанавливает признак закрытия соединения после передачи ответа
+        @param answer - ответ
+    */
+    void addConnectionHeaders(TradingCatCommon::HTTPAnswer& answer);
+
+    /*!
+        Сжимает ответ, если это разрешено конфигурацией и размер ответа не меньше порога сжатия
+        @param answer - ответ
+        @param encoding - [in] метод сжатия, поддерживаемый клиентом, [out] фактический метод сжатия ответа
+        @return ответ для отправки
+    */
+    QByteArray encodeAnswer(const QByteArray& answer, TradingCatCommon::ContentEncoding& encoding) const;
+
+    /*!
+        Возвращает ответ из кеша TradingData. В режиме CompressionMode::CACHED сжатый вариант ответа также берется из кеша.
+            ETag ответа сохраняется для заголовка ответа. Если у клиента уже есть этот ответ (If-None-Match) - тело не формируется
+        @param stockExchangeId - ИД биржи от данных которой зависит ответ
+        @param variant - вариант ответа
+        @param make - функция формирования ответа
+        @param encoding - [in] метод сжатия, поддерживаемый клиентом, [out] фактический метод сжатия ответа
+        @return ответ для отправки. Пустой массив - клиенту отправляется 304 Not Modified
+    */
+    QByteArray cachedAnswer(const TradingCatCommon::StockExchangeID& stockExchangeId, const QString& variant,
+                            const TradingCatCommon::TradingData::AnswerMaker& make, TradingCatCommon::ContentEncoding& encoding);
+
+    /*!
+        Возвращает true если ETag совпадает с одним из значений заголовка If-None-Match запроса
+        @param eTag - ETag ответа
+        @return true - у клиента уже есть этот ответ
+    */
+    bool isNotModified(const QString& eTag) const;
+
+    /*!
+        Обрабатывает все полностью принятые запросы. Обработка приостанавливается, если объем
+            непереданных ответов соединения достиг HTTPServerConfig::writeHighWatermark
+    */
+    void processRequests();
+
+    /*!
+        Перезапускает таймер соединения: таймаут передачи если есть непереданные данные, таймаут приема
+            если принята часть запроса, иначе - таймаут простоя постоянного соединения.
+            Уже идущий таймаут передачи не продлевается - его продлевает только передача данных клиенту (bytesWritten)
+    */
+    void restartWatchDog();
+
+    /*!
+        Передает данные клиенту с учетом объема непереданных данных соединения и сервера
+        @param data - данные
+    */
+    void writeData(const QByteArray& data);
+
+    /*!
+        Переводит соединение в режим WebSocket для рассылки событий PushChannel (запрос PushQuery)
+        @param query - параметры запроса
+    */
+    void upgradeWebSocket(const QUrlQuery& query);
+
+    /*!
+        Обрабатывает принятые кадры WebSocket
+        @param data - принятые данные
+    */
+    void readWebSocket(const QByteArray& data);
+
+    /*!
+        Начинает передачу ответа частями (Transfer-Encoding: chunked) для потока, созданного обработчиком запроса
+        @param contentType - тип содержимого ответа
+        @param encoding - метод сжатия, поддерживаемый клиентом
+    */
+    void startStream(const QString& contentType, TradingCatCommon::ContentEncoding encoding);
+
+    /*!
+        Передает следующие части потокового ответа, пока объем непереданных данных соединения
+            не достигнет HTTPServerConfig::writeHighWatermark. Остальные части передаются
+            по мере освобождения буфера записи. После передачи последней части поток завершается
+    */
+    void streamNext();
+
+    /*!
+        Передает накопленные в буфере потока данные одной частью
+        @param isFinish - true - последняя часть ответа
+        @return true - данные переданы, false - ошибка сжатия, соединение закрыто
+    */
+    bool writeStreamChunk(bool isFinish);
 
 private slots:
     void readyRead();
+    void bytesWritten(qint64 bytes);
     void errorOccurred(QAbstractSocket::SocketError socketError);
 
     void timeout();
 
+    /*!
+        Передает клиенту WebSocket новые события канала рассылки, пока объем непереданных
+            данных соединения не достигнет HTTPServerConfig::writeHighWatermark. Остальные события
+            передаются по мере освобождения буфера записи
+    */
+    void pushEvents();
+
 signals:
     void sendLogMsg(Common::MSG_CODE category, const QString& msg);
     void finishedSocket(quint64 id);
@@ -50,11 +209,47 @@ signals:
 private:
     void finishSocket();
 
-    QString serverStatus() const;
-    QString stockExchangeList() const;
-    QString klineList(const QUrlQuery& query) const;
-    QString klineNew(const QUrlQuery& query) const;
-    QString klineHistory(const QUrlQuery& query) const;
+    /*!
+        Служебные маршруты метрик. Номера идут после маршрутов таблицы routes()
+    */
+    enum class ServiceRoute: size_t
+    {
+        PUSH = 0,       ///< Подписка на события (WebSocket)
+        METRICS = 1,    ///< Метрики сервера
+        OTHER = 2       ///< Неизвестный путь или некорректный запрос
+    };
+
+    /*!
+        Возвращает номер служебного маршрута в метриках
+        @param route - служебный маршрут
+        @return номер маршрута
+    */
+    static size_t metricsRoute(ServiceRoute route);
+
+    /*!
+        Возвращает таблицу маршрутов (путь запроса -> маршрут). Таблица строится один раз при первом обращении
+        @return таблица маршрутов
+    */
+    static const QHash<QString, Route>& routes();
+
+    QByteArray serverStatus(const QUrlQuery& query, TradingCatCommon::PackageFormat format, TradingCatCommon::ContentEncoding& encoding);
+    QByteArray stockExchangeList(const QUrlQuery& query, TradingCatCommon::PackageFormat format, TradingCatCommon::ContentEncoding& encoding);
+    QByteArray klineList(const QUrlQuery& query, TradingCatCommon::PackageFormat format, TradingCatCommon::ContentEncoding& encoding);
+    QByteArray klineNew(const QUrlQuery& query, TradingCatCommon::PackageFormat format, TradingCatCommon::ContentEncoding& encoding);
+
+    /*!
+        Обработчик запроса истории свечей. Ответ в формате JSON не формируется целиком: обработчик создает
+            поток и возвращает пустой ответ, свечи передаются частями по мере передачи клиенту
+    */
+    QByteArray klineHistory(const QUrlQuery& query, TradingCatCommon::PackageFormat format, TradingCatCommon::ContentEncoding& encoding);
+
+    /*!
+        Возвращает метрики сервера в формате Prometheus
+        @return метрики
+    */
+    QByteArray metrics() const;
+
+    struct KLinesStream; ///< Состояние ответа, передаваемого частями
 
 private:
     const quint64 _id = 0;
@@ -64,12 +259,32 @@ private:
 
     const TradingCatCommon::HTTPServerConfig& _serverConfig;
     const TradingCatCommon::TradingData& _data;
+    TradingCatCommon::AdmissionControl* const _admissionControl = nullptr;  ///< Допуск запросов. nullptr - запросы не ограничиваются
+    TradingCatCommon::PushChannel* const _pushChannel = nullptr;   ///< Канал рассылки событий. nullptr - рассылка не поддерживается
+    TradingCatCommon::ServerMetrics::ThreadMetrics* const _metrics = nullptr;  ///< Метрики потока соединения. nullptr - метрики не собираются
 
     bool _isFirstPacket = true;
+    bool _isClosing = false;        ///< Соединение закроется после передачи всех данных
+    bool _isReadPaused = false;     ///< Обработка запросов приостановлена до передачи клиенту накопленных ответов
+    quint32 _requestsCount = 0;     ///< Количество обработанных запросов соединения
+    qint64 _pendingWriteBytes = 0;  ///< Объем ответов соединения, ожидающих передачи
+
+    bool _isWebSocket = false;      ///< Соединение переведено в режим WebSocket
+    std::unique_ptr<TradingCatCommon::WebSocketFrameReader> _webSocketReader;  ///< Разбор кадров клиента WebSocket
+    qint64 _pushSessionId = 0;      ///< ИД сессии пользователя, события которой передаются соединению
+    quint64 _pushCursor = 0;        ///< Курсор последнего переданного события
+    bool _isPushKLines = false;     ///< Передавать события новых свечей
 
     qintptr _handle = 0;
+    QString _clientAddress;         ///< IP адрес клиента
+    size_t _metricsRoute = 0;       ///< Номер маршрута текущего запроса в метриках
+    std::chrono::steady_clock::time_point _requestStart;   ///< Время приема первого байта текущего запроса
+
+    std::unique_ptr<KLinesStream> _stream;  ///< Ответ, передаваемый частями. nullptr - ответ не передается частями
+    QString _answerETag;            ///< ETag ответа на текущий запрос. Пустая строка - ответ без ETag
 
     QTimer* _watchDog = nullptr;
+    bool _isTransmitTimeout = false;    ///< Таймер соединения отсчитывает таймаут передачи
 
 }; //class SocketThread
 
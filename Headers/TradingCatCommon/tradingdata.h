@@ -2,9 +2,12 @@
 
 //STL
 #include <memory>
+#include <functional>
 
 //Qt
 #include <QObject>
+#include <QHash>
+#include <QByteArray>
 
 //My
 #include "TradingCatCommon/kline.h"
@@ -23,6 +26,10 @@ class TradingData
 {
     Q_OBJECT
 
+public:
+    using PAnswer = std::shared_ptr<const QByteArray>;  ///< Сериализованный ответ сервера
+    using AnswerMaker = std::function<QByteArray()>;     ///< Функция формирования ответа
+
 public:
     explicit TradingData(const TradingCatCommon::StockExchangesIDList& stockExcangesIdList, QObject* parent = nullptr);
 
@@ -45,6 +52,21 @@ public:
                                                   qint64 start,
                                                   qint64 end) const;
 
+    /*!
+        Возвращает не более maxCount самых новых свечей за заданный период
+        @param stockExchangeID  - ИД Биржи
+        @param klineID - ИД свечи
+        @param start - время начала периода (мсек epoch)
+        @param end - время конца периода (мсек epoch)
+        @param maxCount - максимальное количество свечей
+        @return список свечей в порядке убывания времени закрытия
+    */
+    TradingCatCommon::PKLinesList getKLinesOnDate(const TradingCatCommon::StockExchangeID &stockExchangeID,
+                                                  const TradingCatCommon::KLineID& klineID,
+                                                  qint64 start,
+                                                  qint64 end,
+                                                  qsizetype maxCount) const;
+
     /*!
         Возвращает общее количество монет
         @return общее количество монет
@@ -64,6 +86,27 @@ public:
     */
     const TradingCatCommon::PKLinesIDList& getKLinesIDList(const TradingCatCommon::StockExchangeID& stockExchangeID) const;
 
+    /*!
+        Возвращает версию списка свечей биржи. Версия увеличивается при каждом изменении содержимого списка
+        @param stockExchangeID - ИД биржи
+        @return версия списка. 0 - если список еще не получен или ИД биржи неизвестно
+    */
+    quint64 klinesIDListVersion(const TradingCatCommon::StockExchangeID& stockExchangeID) const;
+
+    /*!
+        Возвращает сериализованный ответ из кеша. Если в кеше нет ответа для текущей версии списка
+            свечей биржи - ответ формируется функцией make и сохраняется в кеше. Кеш биржи
+            сбрасывается при обновлении списка ее свечей
+        @param stockExchangeID - ИД биржи, от данных которой зависит ответ. Для ответов, зависящих
+            только от списка бирж (не изменяется во время работы), передается пустой ИД
+        @param variant - вариант ответа (путь запроса, формат, сжатие и т.п.)
+        @param make - функция формирования ответа. Вызывается без блокировок
+        @param eTag - [out] ETag ответа (см. answerETag()). nullptr - ETag не требуется
+        @return сериализованный ответ
+    */
+    PAnswer cachedAnswer(const TradingCatCommon::StockExchangeID& stockExchangeID, const QString& variant, const AnswerMaker& make,
+                         QString* eTag = nullptr) const;
+
     /*!
         Возвращает список бирж на которых залистина даная монета
         @param symbol - название монеты
@@ -112,9 +155,21 @@ private:
     TradingData() = delete;
     Q_DISABLE_COPY_MOVE(TradingData);
 
+private:
+    struct CachedAnswer
+    {
+        quint64 version = 0;    ///< Версия списка свечей, для которой сформирован ответ
+        PAnswer answer;         ///< Ответ
+        QString eTag;           ///< ETag ответа. Пустая строка - еще не вычислен
+    };
+
+    using CachedAnswers = QHash<QString, CachedAnswer>;
+
 private:
     const TradingCatCommon::StockExchangesIDList _stockExcangesIdList;  ///< Список используемых бирж
     std::unordered_map<TradingCatCommon::StockExchangeID, TradingCatCommon::PKLinesIDList> _klinesIdList;  ///< Список свичей по биржам
+    std::unordered_map<TradingCatCommon::StockExchangeID, quint64> _klinesIdListVersion; ///< Версии списков свечей по биржам
+    mutable std::unordered_map<TradingCatCommon::StockExchangeID, CachedAnswers> _answersCache; ///< Кеш сериализованных ответов по биржам
     std::unique_ptr<TradingCatCommon::KLinesDataContainer> _dataKLine;  ///< Данные
     std::unordered_map<TradingCatCommon::Symbol, TradingCatCommon::StockExchangesIDList> _moneyListing; ///< Список бирж по монетам (на каких биржах монета залистина)
 
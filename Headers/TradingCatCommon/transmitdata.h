@@ -1,16 +1,22 @@
 #pragma once
 
+//STL
+#include <type_traits>
+
 //Qt
 #include <QJsonDocument>
 #include <QJsonObject>
 #include <QJsonArray>
 #include <QUrlQuery>
+#include <QDataStream>
 
 //My
 #include <Common/parser.h>
 
 #include "TradingCatCommon/kline.h"
 #include "TradingCatCommon/stockexchange.h"
+#include "TradingCatCommon/jsonwriter.h"
+#include "TradingCatCommon/jsonreader.h"
 
 namespace TradingCatCommon
 {
@@ -28,11 +34,117 @@ enum class PackageType: quint8
     CONFIG = 5,                 ///< Сохранение конфигурации пользователя
     STOCKEXCHANGES = 6,         ///< Список поддерживаемых бирж
     KLINESIDLIST = 7,           ///< Список доступных на бирже свечей
-    DETECT = 8                  ///< Список свечей прошедших фильтр
+    DETECT = 8,                 ///< Список свечей прошедших фильтр
+    PUSH = 9                    ///< Подписка на события сервера (WebSocket)
 };
 
 Q_GLOBAL_STATIC_WITH_ARGS(const QString, OK_ANSWER_TEXT, ("OK")); ///< Сообщение об успешной обработке данных
 
+/*!
+    Формат представления пакета при передаче
+*/
+enum class PackageFormat: quint8
+{
+    JSON = 0,                   ///< JSON (формат по умолчанию)
+    BINARY = 1,                 ///< Компактный двоичный формат
+    JSON_COLUMNAR = 2           ///< JSON, списки свечей одной серии передаются в колоночном формате
+};
+
+static const quint32 BINARY_PACKAGE_MAGIC = 0x54434154;   ///< Сигнатура двоичного пакета ("TCAT")
+static const quint16 BINARY_PACKAGE_VERSION = 1;          ///< Версия двоичного формата
+static const qsizetype BINARY_PACKAGE_HEADER_SIZE = 10;   ///< Размер заголовка двоичного пакета: сигнатура(4) + версия(2) + длина(4)
+static const qint64 BINARY_STRING_MIN_SIZE = 4;         ///< Минимальный размер строки в двоичном пакете: длина(4)
+static const qint64 BINARY_KLINE_ID_MIN_SIZE = BINARY_STRING_MIN_SIZE + 8; ///< Минимальный размер ИД свечи: символ + тип(8)
+static const qint64 BINARY_KLINE_MIN_SIZE = 1 + 2 * 8 + 6 * 4;  ///< Минимальный размер свечи в массиве: признак ИД(1) + время(2*8) + значения(6*4)
+
+Q_GLOBAL_STATIC_WITH_ARGS(const QString, JSON_CONTENT_TYPE, ("application/json"));            ///< MIME тип JSON пакета
+Q_GLOBAL_STATIC_WITH_ARGS(const QString, BINARY_CONTENT_TYPE, ("application/x-tradingcat"));  ///< MIME тип двоичного пакета
+Q_GLOBAL_STATIC_WITH_ARGS(const QString, COLUMNAR_JSON_CONTENT_TYPE, ("application/json; layout=columnar")); ///< MIME тип JSON пакета с колоночными списками свечей
+
+/*!
+    Определяет формат ответа по значению заголовка Accept запроса. Тип сравнивается с учетом
+        параметров (application/json;layout=columnar), типы с q=0 не учитываются. Если клиент не
+        запросил двоичный или колоночный формат - используется JSON
+    @param accept - значение заголовка Accept
+    @return формат ответа
+*/
+PackageFormat acceptToPackageFormat(const QString& accept);
+
+/*!
+    Возвращает MIME тип пакета для заголовка Content-Type
+    @param format - формат пакета
+    @return MIME тип
+*/
+const QString& packageFormatToContentType(PackageFormat format);
+
+/*!
+    Возвращает ETag ответа сервера. ETag вычисляется по содержимому несжатого ответа, поэтому
+        клиент может получить его из принятого ответа без доступа к заголовкам. ETag слабый (W/),
+        так как сжатые варианты ответа имеют тот же ETag
+    @param answer - несжатый ответ
+    @return значение заголовка ETag
+*/
+QString answerETag(const QByteArray& answer);
+
+/*!
+    Настраивает поток для чтения/записи двоичного пакета
+    @param stream - поток
+*/
+void initBinaryStream(QDataStream& stream);
+
+/*!
+    Проверяет состояние потока после чтения. В случае ошибки генерирует ParseException
+    @param stream - поток
+    @param path - путь к читаемому значению для сообщения об ошибке
+*/
+void checkBinaryStream(const QDataStream& stream, const QString& path);
+
+/*!
+    Проверяет, что прочитанное из потока количество элементов массива умещается в оставшиеся данные.
+        Количество приходит от клиента и не должно использоваться для выделения памяти без проверки.
+        В случае ошибки генерирует ParseException
+    @param stream - поток
+    @param count - количество элементов
+    @param minElementSize - минимальный размер одного элемента в потоке (байт)
+    @param path - путь к читаемому массиву для сообщения об ошибке
+*/
+void checkBinaryCount(const QDataStream& stream, quint32 count, qint64 minElementSize, const QString& path);
+
+/*!
+    Записывает строку в поток в кодировке UTF-8
+    @param stream - поток
+    @param str - строка
+*/
+void writeBinaryString(QDataStream& stream, const QString& str);
+
+/*!
+    Читает строку в кодировке UTF-8 из потока
+    @param stream - поток
+    @return строка
+*/
+QString readBinaryString(QDataStream& stream);
+
+/*!
+    Возвращает true если данные являются двоичным пакетом
+    @param data - данные
+    @return true если данные начинаются с сигнатуры двоичного пакета
+*/
+bool isBinaryPackage(const QByteArray& data) noexcept;
+
+/*!
+    Добавляет к данным пакета заголовок двоичного пакета
+    @param payload - данные пакета
+    @return двоичный пакет
+*/
+QByteArray makeBinaryPackage(const QByteArray& payload);
+
+/*!
+    Проверяет заголовок двоичного пакета и возвращает данные пакета. В случае ошибки генерирует ParseException
+    @param data - двоичный пакет
+    @return данные пакета
+*/
+QByteArray readBinaryPackage(const QByteArray& data);
+
 ///////////////////////////////////////////////////////////////////////////////
 /// Запросы на сервер
 ///////////////////////////////////////////////////////////////////////////////
@@ -141,6 +253,8 @@ public:
 public:
     StatusAnswer() = default;
     StatusAnswer(const QJsonObject& json);
+    explicit StatusAnswer(QDataStream& stream);
+    explicit StatusAnswer(TradingCatCommon::JsonReader& reader);
     StatusAnswer(ErrorCode code, const QString& msg = QString());
 
     /*!
@@ -149,6 +263,18 @@ public:
      */
     QJsonObject toJson() const;
 
+    /*!
+        Записывает статус в потоковый JSON
+        @param writer - JSON writer
+     */
+    void writeJson(TradingCatCommon::JsonWriter& writer) const;
+
+    /*!
+        Сериализует статус в двоичный поток
+        @param stream - поток
+     */
+    void toBinary(QDataStream& stream) const;
+
     /*!
         Возвращает true если код статуса равен ErrorCode::OK
      */
@@ -177,10 +303,26 @@ public:
         Q_UNUSED(json)
     };
 
+    explicit NullDataPackage(QDataStream& stream) noexcept
+    {
+        Q_UNUSED(stream)
+    };
+
     QJsonObject toJson() const noexcept
     {
         return {};
     };
+
+    void writeJson(TradingCatCommon::JsonWriter& writer) const
+    {
+        writer.beginObject();
+        writer.endObject();
+    };
+
+    void toBinary(QDataStream& stream) const noexcept
+    {
+        Q_UNUSED(stream)
+    };
 };
 
 
@@ -203,10 +345,28 @@ public:
     {
     }
 
+    /*!
+        Конструктор используется на стороне клиента. Формат пакета (JSON или двоичный) определяется автоматически
+        @param data - полученные от сервера данные
+    */
     Package(const QByteArray& data)
     {
         using namespace Common;
 
+        if (isBinaryPackage(data))
+        {
+            fromBinary(data);
+
+            return;
+        }
+
+        if constexpr (std::is_constructible_v<TPackageDataJson, JsonReader&>)
+        {
+            fromJsonReader(data);
+
+            return;
+        }
+
         try
         {
             const auto jsonDoc = JSONParseToDocument(data);
@@ -222,10 +382,15 @@ public:
                 if (jsonData.isNull() || jsonData.isUndefined())
                 {
                     _errorString = QString("Root/Data cannot be empty");
+
+                    return;
                 }
 
                 _data = TPackageDataJson(jsonData);
-
+                if (_data.isError())
+                {
+                    _errorString = QString("Root/Data: %1").arg(_data.errorString());
+                }
             }
         }
         catch (const ParseException& err)
@@ -234,18 +399,94 @@ public:
         }
     }
 
-    QByteArray toJson() const
+    QByteArray toJson(JsonWriter::Options options = JsonWriter::Options()) const
     {
-        QJsonObject result;
+        QByteArray result;
+        toJson(result, options);
+
+        return result;
+    }
 
-        result.insert("Status", _status.toJson());
+    /*!
+        Дописывает JSON представление пакета в конец буфера. Позволяет переиспользовать
+            один буфер для нескольких ответов без повторного выделения памяти
+        @param buffer - буфер
+        @param options - параметры представления данных
+    */
+    void toJson(QByteArray& buffer, JsonWriter::Options options = JsonWriter::Options()) const
+    {
+        JsonWriter writer(buffer, options);
+        writeJson(writer);
+
+        buffer.append("\n\r", 2);
+    }
+
+    /*!
+        Записывает пакет в потоковый JSON. Ключи записываются в алфавитном порядке, поэтому
+            результат совпадает с QJsonDocument::toJson(QJsonDocument::Compact)
+        @param writer - JSON writer
+    */
+    void writeJson(JsonWriter& writer) const
+    {
+        writer.beginObject();
 
         if (_status)
         {
-            result.insert("Data", _data.toJson());
+            writer.key("Data");
+
+            //Данные без потоковой записи сериализуем через QJsonDocument
+            if constexpr (requires(const TPackageDataJson& data, JsonWriter& dataWriter) { data.writeJson(dataWriter); })
+            {
+                _data.writeJson(writer);
+            }
+            else
+            {
+                writer.rawValue(QJsonDocument(_data.toJson()).toJson(QJsonDocument::Compact));
+            }
+        }
+
+        writer.key("Status");
+        _status.writeJson(writer);
+
+        writer.endObject();
+    }
+
+    QByteArray toBinary() const
+    {
+        QByteArray payload;
+
+        {
+            QDataStream stream(&payload, QIODevice::WriteOnly);
+            initBinaryStream(stream);
+
+            _status.toBinary(stream);
+
+            if (_status)
+            {
+                _data.toBinary(stream);
+            }
         }
 
-        return QJsonDocument(result).toJson(QJsonDocument::Compact) + "\n\r";
+        return makeBinaryPackage(payload);
+    }
+
+    /*!
+        Сериализует пакет в заданном формате
+        @param format - формат пакета
+        @return данные пакета
+    */
+    QByteArray toByteArray(PackageFormat format) const
+    {
+        switch (format)
+        {
+        case PackageFormat::BINARY: return toBinary();
+        case PackageFormat::JSON_COLUMNAR: return toJson(JsonWriter::Option::COLUMNAR_KLINES);
+        case PackageFormat::JSON:
+        default:
+            break;
+        }
+
+        return toJson();
     }
 
     const TPackageDataJson& data() const noexcept
@@ -268,6 +509,96 @@ public:
         return _errorString;
     }
 
+private:
+    /*!
+        Потоковый разбор JSON пакета без построения QJsonDocument. Ключи могут следовать в любом порядке
+        @param data - полученные от сервера данные
+    */
+    void fromJsonReader(const QByteArray& data)
+    {
+        using namespace Common;
+
+        try
+        {
+            JsonReader reader(data);
+
+            bool hasStatus = false;
+            bool hasData = false;
+
+            reader.beginObject();
+            while (reader.nextKey())
+            {
+                const auto key = reader.key();
+                if (key == "Status")
+                {
+                    _status = StatusAnswer(reader);
+                    hasStatus = true;
+                }
+                else if (key == "Data")
+                {
+                    //"Data":null прочитан целиком, пропускать нечего. Для успешного ответа это ошибка Root/Data
+                    if (!reader.readNull())
+                    {
+                        _data = TPackageDataJson(reader);
+                        if (_data.isError())
+                        {
+                            reader.error(QString("Incorrect data: %1").arg(_data.errorString()));
+                        }
+                        hasData = true;
+                    }
+                }
+                else
+                {
+                    reader.skipValue();
+                }
+            }
+            reader.end();
+
+            if (!hasStatus)
+            {
+                _errorString = QString("Root/Status cannot be empty");
+            }
+            else if (_status && !hasData)
+            {
+                _errorString = QString("Root/Data cannot be empty");
+            }
+        }
+        catch (const ParseException& err)
+        {
+            _errorString = err.what();
+        }
+    }
+
+    void fromBinary(const QByteArray& data)
+    {
+        using namespace Common;
+
+        try
+        {
+            const auto payload = readBinaryPackage(data);
+
+            QDataStream stream(payload);
+            initBinaryStream(stream);
+
+            _status = StatusAnswer(stream);
+
+            if (_status)
+            {
+                _data = TPackageDataJson(stream);
+                if (_data.isError())
+                {
+                    throw ParseException(QString("Root/Data: %1").arg(_data.errorString()));
+                }
+            }
+
+            checkBinaryStream(stream, "Root");
+        }
+        catch (const ParseException& err)
+        {
+            _errorString = err.what();
+        }
+    }
+
 private:
     QString _errorString;
 
@@ -285,8 +616,34 @@ public:
     explicit KLineJson(const TradingCatCommon::PKLine& kline);
     explicit KLineJson(const QJsonValue& json);
 
+    /*!
+        Конструктор чтения свечи из двоичного потока. Свеча в двоичном формате не содержит ИД
+        @param stream - поток
+        @param klineId - ИД свечи
+    */
+    KLineJson(QDataStream& stream, const TradingCatCommon::KLineID& klineId);
+
+    /*!
+        Конструктор потокового чтения свечи из JSON
+        @param reader - JSON reader, установленный на начало объекта свечи. Ошибка разбора генерирует исключение
+            Common::ParseException, поскольку после нее позиция reader не соответствует структуре документа
+    */
+    explicit KLineJson(TradingCatCommon::JsonReader& reader);
+
     QJsonObject toJson() const;
 
+    /*!
+        Записывает свечу в потоковый JSON
+        @param writer - JSON writer
+    */
+    void writeJson(TradingCatCommon::JsonWriter& writer) const;
+
+    /*!
+        Записывает данные свечи (без ИД) в двоичный поток
+        @param stream - поток
+    */
+    void toBinary(QDataStream& stream) const;
+
     const TradingCatCommon::PKLine& kline() const noexcept;
 
     bool isError() const noexcept;
@@ -295,6 +652,9 @@ public:
 private:
     KLineJson() = delete;
 
+    void writeJsonData(TradingCatCommon::JsonWriter& writer) const;
+    void toBinaryData(QDataStream& stream) const;
+
 private:
     QString _errorString;
 
@@ -310,8 +670,12 @@ class KLinesArrayJson
 public:
     KLinesArrayJson(const PKLinesList& klinesList);
     KLinesArrayJson(const QJsonValue& json);
+    explicit KLinesArrayJson(QDataStream& stream);
+    explicit KLinesArrayJson(TradingCatCommon::JsonReader& reader);
 
     QJsonArray toJson() const;
+    void writeJson(TradingCatCommon::JsonWriter& writer) const;
+    void toBinary(QDataStream& stream) const;
 
     const PKLinesList& klinesList() const noexcept;
 
@@ -321,6 +685,30 @@ public:
 private:
     KLinesArrayJson() = delete;
 
+    /*!
+        Возвращает true если список можно записать в колоночном формате: список не пуст и все свечи принадлежат одной серии
+        @return true - колоночный формат возможен
+    */
+    bool isColumnarAvailable() const;
+
+    /*!
+        Записывает список в колоночном формате: ИД серии один раз, далее параллельные массивы значений.
+            Время закрытия передается разностями с предыдущей свечей, время открытия - длительностью свечи
+        @param writer - JSON writer
+    */
+    void writeColumnarJson(TradingCatCommon::JsonWriter& writer) const;
+
+    struct Columns; ///< Прочитанные колонки списка свечей
+
+    void fromColumnarJson(const QJsonObject& json);
+    void fromColumnarJson(TradingCatCommon::JsonReader& reader);
+
+    /*!
+        Собирает список свечей из прочитанных колонок и проверяет его корректность
+        @param columns - колонки
+    */
+    void fromColumns(const Columns& columns);
+
 private:
     QString _errorString;
 
@@ -336,8 +724,12 @@ class KLineIDJson final
 public:
     KLineIDJson(const TradingCatCommon::KLineID& klineId);
     KLineIDJson(const QJsonValue& json);
+    explicit KLineIDJson(QDataStream& stream);
+    explicit KLineIDJson(TradingCatCommon::JsonReader& reader);
 
     QJsonObject toJson() const;
+    void writeJson(TradingCatCommon::JsonWriter& writer) const;
+    void toBinary(QDataStream& stream) const;
 
     const TradingCatCommon::KLineID& klineId() const noexcept;
 
@@ -362,8 +754,12 @@ class StockExchangeIDJson final
 public:
     StockExchangeIDJson(const TradingCatCommon::StockExchangeID& stockExchangeId);
     StockExchangeIDJson(const QJsonValue& json);
+    explicit StockExchangeIDJson(QDataStream& stream);
+    explicit StockExchangeIDJson(TradingCatCommon::JsonReader& reader);
 
     QJsonObject toJson() const;
+    void writeJson(TradingCatCommon::JsonWriter& writer) const;
+    void toBinary(QDataStream& stream) const;
 
     const TradingCatCommon::StockExchangeID& stockExchangeId() const noexcept;
 
@@ -387,9 +783,13 @@ class StockExchangesIDArrayJson final
 {
 public:
     explicit StockExchangesIDArrayJson(const QJsonValue& json);
+    explicit StockExchangesIDArrayJson(QDataStream& stream);
+    explicit StockExchangesIDArrayJson(TradingCatCommon::JsonReader& reader);
     explicit StockExchangesIDArrayJson(const TradingCatCommon::StockExchangesIDList& stockExchangesIDList);
 
     QJsonArray toJson() const;
+    void writeJson(TradingCatCommon::JsonWriter& writer) const;
+    void toBinary(QDataStream& stream) const;
 
     TradingCatCommon::StockExchangesIDList stockExchagesIDList() const;
 
@@ -10,6 +10,8 @@
 
 //My
 #include "TradingCatCommon/kline.h"
+#include "TradingCatCommon/httpcompression.h"
+#include "TradingCatCommon/admissioncontrol.h"
 
 namespace TradingCatCommon
 {
@@ -36,10 +38,20 @@ struct HTTPServerConfig
 {
     QHostAddress address = QHostAddress::LocalHost;                 ///< адрес интерфейса на котором запускаеться сервер
     quint16 port = 80;                                              ///< Порт
-    quint64 maxUsers = 1000;                                        ///< Максимальное количество пользователей
+    quint64 maxUsers = 1000;                                        ///< Максимальное количество пользователей (одновременных соединений)
+    quint32 threadCount = 0;                                        ///< Количество потоков обработки соединений. 0 - по количеству ядер
+    quint32 keepAliveTimeout = 60 * 1000;                           ///< Время простоя постоянного соединения до закрытия (мсек)
+    quint32 keepAliveMaxRequests = 1000;                            ///< Максимальное количество запросов в одном соединении
+    qint64 writeHighWatermark = 4 * 1024 * 1024;                    ///< Объем непереданных ответов соединения, при котором прекращается обработка его запросов (байт)
+    qint64 writeLowWatermark = 1 * 1024 * 1024;                     ///< Объем непереданных ответов соединения, при котором обработка запросов возобновляется (байт)
+    qint64 maxPendingWriteBytes = 256 * 1024 * 1024;                ///< Максимальный объем непереданных ответов всех соединений сервера (байт)
     QString rootDir = QCoreApplication::applicationDirPath();       ///< Корневая папка
     QString name;                                                   ///< Название сервера
     const QDateTime startDateTime = QDateTime::currentDateTime();   ///< Время запуска
+    TradingCatCommon::CompressionMode compressionMode = TradingCatCommon::CompressionMode::CACHED; ///< Режим сжатия ответов
+    qsizetype compressionThreshold = 1024;                          ///< Минимальный размер ответа для сжатия (байт)
+    int compressionLevel = 6;                                       ///< Уровень сжатия zlib (1..9)
+    TradingCatCommon::AdmissionConfig admission;                    ///< Допуск запросов: бюджеты клиентов и приоритеты классов запросов
 };
 
 } //namespace TradingCatCommon
@@ -1,3 +1,6 @@
+//STL
+#include <vector>
+
 //Qt
 #include <QObject>
 #include <QJsonArray>
@@ -6,6 +9,8 @@
 //My
 #include "TradingCatCommon/detector.h"
 #include "TradingCatCommon/httpclient.h"
+#include "TradingCatCommon/klinescache.h"
+#include "TradingCatCommon/pushclient.h"
 
 namespace TradingCatCommon
 {
@@ -55,36 +60,118 @@ private slots:
     void stockExchangeListHTTPClient(const TradingCatCommon::StockExchangesIDList& stockExchangeIdList, quint64 id);
     void klineListHTTPClient(const TradingCatCommon::StockExchangeID& stockExchangeId, const TradingCatCommon::KLinesIDList& klineIdList, quint64 id);
     void klineNewHTTPClient(const TradingCatCommon::StockExchangeID& stockExchangeId, const TradingCatCommon::PKLinesList& klinesList, quint64 id);
+    void klineNewReceivedHTTPClient(qsizetype klinesCount, qint64 lastGetId, quint64 id);
     void klineHistoryHTTPClient(const TradingCatCommon::StockExchangeID& stockExchangeId, const TradingCatCommon::PKLinesList& klinesList, quint64 id);
     void serverStatusHTTPClient(const QString&serverName, const QString& serverVersion, const QDateTime& serverTime, qint64 upTime, quint64 id);
     void errorOccurredHTTPClient(const QString& msg, TradingCatCommon::PackageType type, quint64 id);
 
+    void sendLogMsgPushClient(Common::TDBLoger::MSG_CODE category, const QString& msg);
+    void newKLinesPushClient(const TradingCatCommon::StockExchangeID& stockExchangeId, const TradingCatCommon::PKLinesList& klinesList);
+    void openedPushClient();
+    void closedPushClient();
+    void eventsLostPushClient();
+
     void updateNew();
 
 private:
     UserCore() = delete;
     Q_DISABLE_COPY_MOVE(UserCore);
 
+    /*!
+        Начинает периодический запрос новых свечей
+    */
+    void startUpdate();
+
+    /*!
+        Планирует следующий запрос новых свечей. Пока сервер отдает новые свечи запросы идут с минимальным
+            интервалом. Когда новых свечей нет - следующий запрос выполняется в момент публикации свечей,
+            закрывающихся на ближайшей границе периода. Если к этому моменту свечи не опубликованы -
+            запросы повторяются с экспоненциально растущим интервалом
+        @param isAdvanced - true - последний ответ содержал новые свечи
+    */
+    void scheduleUpdate(bool isAdvanced);
+
+    /*!
+        Возвращает период закрытия свечей, по которому выравниваются запросы - длительность самой короткой запрашиваемой свечи
+        @return период (мсек)
+    */
+    qint64 updatePeriod() const;
+
+    /*!
+        Передает новые свечи в кеш и детектор. Свеча может прийти и через канал рассылки, и в ответ на опрос -
+            детектор получает каждую свечу один раз
+        @param stockExchangeId - ИД биржи
+        @param klinesList - список свечей
+    */
+    void addNewKLines(const TradingCatCommon::StockExchangeID& stockExchangeId, const TradingCatCommon::PKLinesList& klinesList);
+
 private:
     using StockExchangesMap = std::unordered_map<TradingCatCommon::StockExchangeID, TradingCatCommon::KLinesIDList>;
 
+    /*!
+        Ключ запроса истории свечей: одинаковые запросы объединяются в один
+    */
+    struct HistoryRequestKey
+    {
+        TradingCatCommon::StockExchangeID stockExchangeId;  ///< ИД биржи
+        TradingCatCommon::KLineID klineId;                  ///< ИД свечи
+        qint64 end = 0;                                     ///< Конец окна истории, выровненный по границе свечи (мсек epoch)
+
+        bool operator==(const HistoryRequestKey& key) const = default;
+    };
+
+    struct HistoryRequestKeyHash
+    {
+        size_t operator()(const HistoryRequestKey& key) const noexcept;
+    };
+
+    /*!
+        Выполняемый запрос истории свечей
+    */
+    struct HistoryRequest
+    {
+        HistoryRequestKey key;                                                  ///< Ключ запроса
+        qint64 start = 0;                                                       ///< Начало окна истории (мсек epoch)
+        qint64 requestStart = 0;                                                ///< Начало части окна, запрошенной у сервера (мсек epoch)
+        std::vector<TradingCatCommon::Detector::PKLineDetectData> detects;     ///< Обнаружения, ожидающие историю свечей
+    };
+
+    /*!
+        Передает свечи окна истории из кеша всем обнаружениям, ожидающим запрос
+        @param historyRequest - запрос истории свечей
+        @return true - свечи переданы, false - в кеше нет свечей окна
+    */
+    bool sendKLineDetect(const HistoryRequest& historyRequest);
+
 private:
     const HTTPClientConfig _httpClientConfig;
 
     TradingCatCommon::Detector* _detector = nullptr;
     TradingCatCommon::HTTPClient* _httpClient = nullptr;
+    TradingCatCommon::PushClient* _pushClient = nullptr;  ///< Канал рассылки новых свечей. nullptr - сессия не задана, свечи запрашиваются опросом
 
     const TradingCatCommon::KLineTypes _types = {TradingCatCommon::KLineType::MIN1};
 
     QTimer* _updateTimer = nullptr;
+    qint64 _lastGetId = 0;          ///< Курсор запросов новых свечей из последнего ответа
+    qint64 _publishLag = 0;         ///< Оценка задержки публикации свечей сервером после закрытия (мсек)
+    qint64 _updateBackoff = 0;      ///< Интервал повтора запроса при отсутствии новых свечей (мсек). 0 - последний ответ содержал новые свечи
+    bool _isUpdateAligned = false;  ///< Текущий запрос отправлен в ожидаемый момент публикации свечей
+    bool _isPushOpened = false;     ///< Канал рассылки подключен, периодический опрос остановлен
+    std::unordered_map<TradingCatCommon::StockExchangeID, std::unordered_map<TradingCatCommon::KLineID, qint64>> _lastNewKLines; ///< Время закрытия последней переданной детектору свечи каждой серии
 
-    StockExchangesMap::const_iterator _nextStockExchange;
     StockExchangesMap _stockExchangesMap;
+    std::unordered_map<quint64, TradingCatCommon::StockExchangeID> _klineListRequests;  ///< Выполняемые запросы списков свечей по ИД запроса
+
+    std::unordered_map<quint64, HistoryRequest> _detectKLine;  ///< Выполняемые запросы истории по ИД запроса
+    std::unordered_map<HistoryRequestKey, quint64, HistoryRequestKeyHash> _historyRequests; ///< ИД выполняемых запросов истории по ключу
 
-    std::unordered_map<quint64, TradingCatCommon::Detector::PKLineDetectData> _detectKLine;
+    TradingCatCommon::KLinesCache _klinesCache; ///< Свечи, полученные от сервера. Из кеша запрашивается только недостающая часть истории
 
     std::unordered_map<quint64, qint64> _serverStatus;
 
+    TradingCatCommon::HTTPClientAnswersCache _answersCache; ///< Сохраненные ответы HTTP клиента. Сохраняются между перезапусками, чтобы не загружать неизменившиеся списки
+
     bool _isStarted = false;
 };
 
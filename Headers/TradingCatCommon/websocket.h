@@ -0,0 +1,98 @@
+#pragma once
+
+//STL
+#include <optional>
+
+//Qt
+#include <QByteArray>
+#include <QByteArrayView>
+#include <QString>
+
+namespace TradingCatCommon
+{
+
+/*!
+    Тип кадра WebSocket (RFC 6455)
+*/
+enum class WebSocketOpCode: quint8
+{
+    CONTINUATION = 0x0, ///< Продолжение фрагментированного сообщения
+    TEXT = 0x1,         ///< Текстовое сообщение
+    BINARY = 0x2,       ///< Двоичное сообщение
+    CLOSE = 0x8,        ///< Закрытие соединения
+    PING = 0x9,         ///< Ping
+    PONG = 0xA          ///< Pong
+};
+
+/*!
+    Возвращает значение заголовка Sec-WebSocket-Accept для ключа клиента
+    @param key - значение заголовка Sec-WebSocket-Key
+    @return значение заголовка Sec-WebSocket-Accept
+*/
+QByteArray webSocketAcceptKey(const QByteArray& key);
+
+/*!
+    Формирует кадр WebSocket. Сообщение передается одним кадром
+    @param opCode - тип кадра
+    @param payload - данные кадра
+    @param isMasked - true - данные маскируются (обязательно для кадров клиента)
+    @return кадр
+*/
+QByteArray makeWebSocketFrame(TradingCatCommon::WebSocketOpCode opCode, QByteArrayView payload, bool isMasked = false);
+
+///////////////////////////////////////////////////////////////////////////////
+///     The WebSocketFrameReader class - разбор кадров WebSocket по мере поступления данных
+///
+class WebSocketFrameReader final
+{
+public:
+    /*!
+        Кадр WebSocket
+    */
+    struct Frame
+    {
+        TradingCatCommon::WebSocketOpCode opCode = TradingCatCommon::WebSocketOpCode::TEXT;    ///< Тип кадра
+        bool isFinal = true;    ///< Последний кадр сообщения
+        QByteArray payload;     ///< Данные кадра (без маски)
+    };
+
+public:
+    /*!
+        Конструктор
+        @param maxPayloadSize - максимальный размер данных кадра. Кадры большего размера считаются ошибкой
+    */
+    explicit WebSocketFrameReader(qint64 maxPayloadSize = 1024 * 1024);
+
+    /*!
+        Добавляет принятые данные
+        @param data - данные
+    */
+    void add(const QByteArray& data);
+
+    /*!
+        Возвращает следующий полностью принятый кадр
+        @return кадр или std::nullopt, если кадр еще не принят полностью или произошла ошибка
+    */
+    std::optional<Frame> next();
+
+    /*!
+        Возвращает true если данные не являются корректным потоком кадров WebSocket
+        @return true - ошибка
+    */
+    bool isError() const noexcept;
+
+    /*!
+        Возвращает текстовое описание ошибки
+        @return текстовое описание ошибки
+    */
+    const QString& errorString() const noexcept;
+
+private:
+    const qint64 _maxPayloadSize = 0;   ///< Максимальный размер данных кадра
+
+    QByteArray _buffer;     ///< Принятые и еще не разобранные данные
+    QString _errorString;   ///< Описание ошибки
+
+};
+
+} // namespace TradingCatCommon
@@ -0,0 +1,125 @@
+//STL
+#include <algorithm>
+#include <cmath>
+
+//Qt
+#include <QDateTime>
+#include <QMutex>
+#include <QMutexLocker>
+
+#include "TradingCatCommon/admissioncontrol.h"
+
+using namespace TradingCatCommon;
+
+Q_GLOBAL_STATIC(QMutex, admissionMutex);
+
+static const qint64 OVERLOAD_RETRY_AFTER = 1; ///< Рекомендуемая задержка повтора запроса при перегрузке сервера (сек)
+
+AdmissionControl::AdmissionControl(const AdmissionConfig& config)
+    : _isEnabled(config.isEnabled)
+    , _maxClients(config.maxClients)
+    , _limits{config.status, config.list, config.history, config.detect}
+{
+    Q_ASSERT(_maxClients > 0);
+
+    for (const auto& limit: _limits)
+    {
+        Q_ASSERT(limit.rate >= 0.0 && limit.burst >= 1.0);
+
+        if (limit.rate > 0.0)
+        {
+            _idleTime = std::max(_idleTime, static_cast<qint64>(std::ceil(limit.burst / limit.rate * 1000.0)));
+        }
+    }
+}
+
+AdmissionControl::Decision AdmissionControl::admit(const QString& client, RequestClass requestClass, double load)
+{
+    Decision decision;
+
+    if (!_isEnabled)
+    {
+        return decision;
+    }
+
+    const auto index = static_cast<size_t>(requestClass);
+    Q_ASSERT(index < REQUEST_CLASS_COUNT);
+
+    const auto& limit = _limits[index];
+
+    //При перегрузке сервера первыми отклоняются запросы с наименьшим приоритетом
+    if (limit.shedLoad < 1.0 && load >= limit.shedLoad)
+    {
+        decision.code = 503;
+        decision.retryAfter = OVERLOAD_RETRY_AFTER;
+
+        return decision;
+    }
+
+    if (limit.rate <= 0.0)
+    {
+        return decision;
+    }
+
+    const auto currentTime = QDateTime::currentMSecsSinceEpoch();
+
+    QMutexLocker<QMutex> admissionLocker(admissionMutex);
+
+    //Клиент, который дольше всех не обращался, находится в конце списка использования, поэтому
+    //проверка и вытеснение клиента с восстановившимся бюджетом выполняются за O(1)
+    ClientBuckets* buckets = nullptr;
+    auto clients_it = _clients.find(client);
+    if (clients_it != _clients.end())
+    {
+        _usage.splice(_usage.begin(), _usage, clients_it->second.usage);
+    }
+    else
+    {
+        //Бюджеты клиента, не обращавшегося дольше _idleTime, полностью восстановились - он не отличается от нового
+        if (_clients.size() >= _maxClients && currentTime - _clients.at(_usage.back()).lastTime >= _idleTime)
+        {
+            _clients.erase(_usage.back());
+            _usage.pop_back();
+        }
+
+        if (_clients.size() < _maxClients)
+        {
+            _usage.push_front(client);
+            clients_it = _clients.emplace(client, Client{ClientBuckets(), 0, _usage.begin()}).first;
+        }
+    }
+
+    if (clients_it != _clients.end())
+    {
+        clients_it->second.lastTime = currentTime;
+        buckets = &clients_it->second.buckets;
+    }
+    else
+    {
+        //Клиенты сверх лимита делят общий бюджет, чтобы таблица бюджетов не росла неограниченно
+        buckets = &_sharedBuckets;
+    }
+
+    auto& bucket = (*buckets)[index];
+    if (bucket.tokens < 0.0)
+    {
+        bucket.tokens = limit.burst;
+    }
+    else
+    {
+        bucket.tokens = std::min(limit.burst, bucket.tokens + limit.rate * static_cast<double>(currentTime - bucket.updateTime) / 1000.0);
+    }
+    bucket.updateTime = currentTime;
+
+    if (bucket.tokens < 1.0)
+    {
+        decision.code = 429;
+        decision.retryAfter = std::max<qint64>(static_cast<qint64>(std::ceil((1.0 - bucket.tokens) / limit.rate)), 1);
+
+        return decision;
+    }
+
+    bucket.tokens -= 1.0;
+
+    return decision;
+}
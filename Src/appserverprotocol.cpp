@@ -101,6 +101,39 @@ QJsonObject ServerStatusAnswer::toJson() const
     return statusJson;
 }
 
+ServerStatusAnswer::ServerStatusAnswer(QDataStream &stream)
+{
+    try
+    {
+        qint64 serverTime = 0;
+        stream >> serverTime >> _upTime;
+
+        _serverTime = QDateTime::fromMSecsSinceEpoch(serverTime);
+        _serverName = readBinaryString(stream);
+        _serverVersion = readBinaryString(stream);
+        _usersOnline = readBinaryString(stream).split(',');
+
+        checkBinaryStream(stream, "Root/Data");
+    }
+    catch (const ParseException& err)
+    {
+        _errorString = err.what();
+        _serverTime = QDateTime();
+        _upTime = 0;
+        _serverName.clear();
+        _serverVersion.clear();
+    }
+}
+
+void ServerStatusAnswer::toBinary(QDataStream &stream) const
+{
+    stream << QDateTime::currentDateTime().toMSecsSinceEpoch() << _upTime;
+
+    writeBinaryString(stream, _serverName);
+    writeBinaryString(stream, _serverVersion);
+    writeBinaryString(stream, _usersOnline.join(','));
+}
+
 
 ///////////////////////////////////////////////////////////////////////////////
 ///     The LoginUserQuery class - запрос запрос логина
@@ -219,6 +252,33 @@ QJsonObject LoginAnswer::toJson() const
     return dataJson;
 }
 
+LoginAnswer::LoginAnswer(QDataStream &stream)
+{
+    try
+    {
+        stream >> _sessionId;
+
+        _message = readBinaryString(stream);
+        const auto config = readBinaryString(stream);
+
+        checkBinaryStream(stream, "Root/Data");
+
+        _config = UserConfig(config);
+    }
+    catch (const ParseException& err)
+    {
+        _errorString = err.what();
+    }
+}
+
+void LoginAnswer::toBinary(QDataStream &stream) const
+{
+    stream << _sessionId;
+
+    writeBinaryString(stream, _message);
+    writeBinaryString(stream, _config.toJson());
+}
+
 qint64 LoginAnswer::sessionId() const noexcept
 {
     return _sessionId;
@@ -337,6 +397,26 @@ QJsonObject LogoutAnswer::toJson() const
     return dataJson;
 }
 
+LogoutAnswer::LogoutAnswer(QDataStream &stream)
+{
+    try
+    {
+        _message = readBinaryString(stream);
+
+        checkBinaryStream(stream, "Root/Data");
+    }
+    catch (const ParseException& err)
+    {
+        _errorString = err.what();
+        _message.clear();
+    }
+}
+
+void LogoutAnswer::toBinary(QDataStream &stream) const
+{
+    writeBinaryString(stream, _message);
+}
+
 const QString &LogoutAnswer::message() const noexcept
 {
     return _message;
@@ -471,6 +551,26 @@ QJsonObject ConfigAnswer::toJson() const
     return dataJson;
 }
 
+ConfigAnswer::ConfigAnswer(QDataStream &stream)
+{
+    try
+    {
+        _message = readBinaryString(stream);
+
+        checkBinaryStream(stream, "Root/Data");
+    }
+    catch (const ParseException& err)
+    {
+        _errorString = err.what();
+        _message.clear();
+    }
+}
+
+void ConfigAnswer::toBinary(QDataStream &stream) const
+{
+    writeBinaryString(stream, _message);
+}
+
 const QString &ConfigAnswer::message() const noexcept
 {
     return _message;
@@ -593,6 +693,51 @@ QJsonObject StockExchangesAnswer::toJson() const
     return result;
 }
 
+void StockExchangesAnswer::writeJson(JsonWriter &writer) const
+{
+    writer.beginObject();
+
+    writer.keyValue("Msg", _message);
+    writer.key("StockExchanges");
+    StockExchangesIDArrayJson(_stockExchangeIdList).writeJson(writer);
+
+    writer.endObject();
+}
+
+StockExchangesAnswer::StockExchangesAnswer(QDataStream &stream)
+{
+    try
+    {
+        _message = readBinaryString(stream);
+
+        checkBinaryStream(stream, "Root/Data/Msg");
+
+        StockExchangesIDArrayJson stockExchangesIDJson(stream);
+
+        if (stockExchangesIDJson.isError())
+        {
+            _errorString =  stockExchangesIDJson.errorString();
+
+            return;
+        }
+
+        _stockExchangeIdList = stockExchangesIDJson.stockExchagesIDList();
+    }
+    catch (const ParseException& err)
+    {
+        _message.clear();
+        _stockExchangeIdList.clear();
+
+        _errorString = err.what();
+    }
+}
+
+void StockExchangesAnswer::toBinary(QDataStream &stream) const
+{
+    writeBinaryString(stream, _message);
+    StockExchangesIDArrayJson(_stockExchangeIdList).toBinary(stream);
+}
+
 const QString &StockExchangesAnswer::message() const noexcept
 {
     return _message;
@@ -672,6 +817,98 @@ const QString &DetectQuery::errorString() const noexcept
     return _errorString;
 }
 
+///////////////////////////////////////////////////////////////////////////////
+///     The PushQuery class - подписка на события сервера
+///
+PushQuery::PushQuery()
+    : Query(PackageType::PUSH, "/data/push")
+{
+}
+
+PushQuery::PushQuery(const QUrlQuery &query)
+    : PushQuery()
+{
+    try
+    {
+        bool ok = false;
+        _sessionId = query.queryItemValue("sessionId").toLong(&ok);
+        if (!ok || _sessionId == 0)
+        {
+            throw ParseException("Value of key 'sessionId' must be non zero number");
+        }
+
+        if (query.hasQueryItem("cursor"))
+        {
+            _cursor = query.queryItemValue("cursor").toULongLong(&ok);
+            if (!ok)
+            {
+                throw ParseException("Value of key 'cursor' must be number");
+            }
+        }
+
+        _isKLines = query.queryItemValue("klines") == "1";
+    }
+    catch (const ParseException& err)
+    {
+        _errorString = err.what();
+        _sessionId = 0;
+        _cursor = 0;
+        _isKLines = false;
+    }
+}
+
+PushQuery::PushQuery(qint64 sessionId, quint64 cursor, bool isKLines)
+    : PushQuery()
+{
+    Q_ASSERT(sessionId != 0);
+
+    _sessionId = sessionId;
+    _cursor = cursor;
+    _isKLines = isKLines;
+}
+
+QUrlQuery PushQuery::query() const
+{
+    QUrlQuery query;
+
+    query.addQueryItem("sessionId", QString::number(_sessionId));
+    if (_cursor != 0)
+    {
+        query.addQueryItem("cursor", QString::number(_cursor));
+    }
+    if (_isKLines)
+    {
+        query.addQueryItem("klines", "1");
+    }
+
+    return query;
+}
+
+qint64 PushQuery::sessionId() const noexcept
+{
+    return _sessionId;
+}
+
+quint64 PushQuery::cursor() const noexcept
+{
+    return _cursor;
+}
+
+bool PushQuery::isKLines() const noexcept
+{
+    return _isKLines;
+}
+
+bool PushQuery::isError() const noexcept
+{
+    return !_errorString.isEmpty();
+}
+
+const QString &PushQuery::errorString() const noexcept
+{
+    return _errorString;
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 ///     The DetectAnswer class - класс ответа на запрос  DetectQuery
 ///
@@ -828,6 +1065,234 @@ QJsonObject DetectAnswer::toJson() const
     return resultJson;
 }
 
+void DetectAnswer::writeJson(JsonWriter &writer) const
+{
+    //Ключи записываются в алфавитном порядке, как в QJsonObject
+    writer.beginObject();
+
+    writer.key("Detect");
+    writer.beginArray();
+    for(const auto& detected: _klinesDetectedList.detected)
+    {
+        Q_CHECK_PTR(detected->history);
+        Q_CHECK_PTR(detected->reviewHistory);
+
+        Q_ASSERT(!detected->stockExchangeId.isEmpty());
+        Q_ASSERT(!detected->history->empty());
+        Q_ASSERT(!detected->reviewHistory->empty());
+
+        writer.beginObject();
+
+        writer.keyValue("Delta", detected->delta);
+        writer.keyValue("FilterActivate", static_cast<int>(detected->filterActivate.toInt()));
+        writer.key("History");
+        KLinesArrayJson(detected->history).writeJson(writer);
+        writer.keyValue("Msg", detected->msg);
+        writer.key("ReviewHistory");
+        KLinesArrayJson(detected->reviewHistory).writeJson(writer);
+        writer.key("StockExchangeID");
+        StockExchangeIDJson(detected->stockExchangeId).writeJson(writer);
+        writer.keyValue("Volume", detected->volume);
+
+        writer.endObject();
+    }
+    writer.endArray();
+
+    writer.keyValue("IsFull", _klinesDetectedList.isFull);
+
+    writer.endObject();
+}
+
+DetectAnswer::DetectAnswer(QDataStream &stream)
+{
+    try
+    {
+        quint32 count = 0;
+        stream >> _klinesDetectedList.isFull >> count;
+
+        checkBinaryStream(stream, "Root/Data");
+        //Биржа и сообщение - строки, дельта, объем и фильтры - по 4 байта
+        checkBinaryCount(stream, count, 2 * BINARY_STRING_MIN_SIZE + 3 * 4, "Root/Data/Detect");
+
+        for (quint32 i = 0; i < count; ++i)
+        {
+            auto detect = std::make_shared<TradingCatCommon::Detector::KLineDetectData>();
+
+            detect->stockExchangeId = StockExchangeIDJson(stream).stockExchangeId();
+
+            quint32 filterActivate = 0;
+            stream >> detect->delta >> detect->volume >> filterActivate;
+
+            detect->filterActivate = Filter::FilterTypes::fromInt(filterActivate);
+            detect->msg = readBinaryString(stream);
+
+            checkBinaryStream(stream, "Root/Data/Detect/[]");
+
+            if (detect->stockExchangeId.isEmpty())
+            {
+                throw ParseException("Value of Root/Data/Detect/[]/StockExchangeID cannot be empty");
+            }
+
+            {
+                KLinesArrayJson history(stream);
+
+                if (history.isError())
+                {
+                    throw ParseException(QString("Invalid value Root/Data/Detect/[]/History: %1").arg(history.errorString()));
+                }
+
+                detect->history = history.klinesList();
+
+                if (detect->history->empty())
+                {
+                    throw ParseException(QString("Value Root/Data/Detect/[]/History cannot be empty"));
+                }
+            }
+
+            {
+                KLinesArrayJson reviewHistory(stream);
+
+                if (reviewHistory.isError())
+                {
+                    throw ParseException(QString("Invalid value Root/Data/Detect/[]/ReviewHistory: %1").arg(reviewHistory.errorString()));
+                }
+
+                detect->reviewHistory = reviewHistory.klinesList();
+
+                if (detect->reviewHistory->empty())
+                {
+                    throw ParseException(QString("Value Root/Data/Detect/[]/ReviewHistory cannot be empty"));
+                }
+            }
+
+            _klinesDetectedList.detected.emplace_back(std::move(detect));
+        }
+    }
+    catch (const ParseException& err)
+    {
+        _errorString = err.what();
+    }
+}
+
+DetectAnswer::DetectAnswer(JsonReader &reader)
+{
+    reader.beginObject();
+    while (reader.nextKey())
+    {
+        const auto key = reader.key();
+        if (key == "IsFull")
+        {
+            _klinesDetectedList.isFull = reader.readBool();
+        }
+        else if (key == "Detect")
+        {
+            reader.beginArray();
+            while (reader.nextElement())
+            {
+                _klinesDetectedList.detected.emplace_back(readDetect(reader));
+            }
+        }
+        else
+        {
+            reader.skipValue();
+        }
+    }
+}
+
+TradingCatCommon::Detector::PKLineDetectData DetectAnswer::readDetect(JsonReader &reader)
+{
+    auto detect = std::make_shared<TradingCatCommon::Detector::KLineDetectData>();
+
+    bool hasDelta = false;
+    bool hasVolume = false;
+    bool hasMsg = false;
+    bool hasFilterActivate = false;
+
+    reader.beginObject();
+    while (reader.nextKey())
+    {
+        const auto key = reader.key();
+        if (key == "Delta")
+        {
+            detect->delta = reader.readFloat();
+            hasDelta = true;
+        }
+        else if (key == "FilterActivate")
+        {
+            detect->filterActivate = Filter::FilterTypes::fromInt(static_cast<quint32>(reader.readInt64()));
+            hasFilterActivate = true;
+        }
+        else if (key == "History" || key == "ReviewHistory")
+        {
+            KLinesArrayJson history(reader);
+            if (history.isError())
+            {
+                reader.error(history.errorString());
+            }
+            if (history.klinesList()->empty())
+            {
+                reader.error("Value cannot be empty");
+            }
+
+            (key == "History" ? detect->history : detect->reviewHistory) = history.klinesList();
+        }
+        else if (key == "Msg")
+        {
+            detect->msg = reader.readString();
+            hasMsg = true;
+        }
+        else if (key == "StockExchangeID")
+        {
+            detect->stockExchangeId = StockExchangeIDJson(reader).stockExchangeId();
+            if (detect->stockExchangeId.isEmpty())
+            {
+                reader.error("Value cannot be empty");
+            }
+        }
+        else if (key == "Volume")
+        {
+            detect->volume = reader.readFloat();
+            hasVolume = true;
+        }
+        else
+        {
+            reader.skipValue();
+        }
+    }
+
+    //Ошибки отсутствия обязательных значений формируются только после разбора всего объекта
+    if (!hasDelta || !hasVolume || !hasMsg || !hasFilterActivate || detect->stockExchangeId.isEmpty() || !detect->history || !detect->reviewHistory)
+    {
+        reader.error("Detect item must contain StockExchangeID, Delta, Volume, Msg, FilterActivate, History and ReviewHistory");
+    }
+
+    return detect;
+}
+
+void DetectAnswer::toBinary(QDataStream &stream) const
+{
+    stream << _klinesDetectedList.isFull << static_cast<quint32>(_klinesDetectedList.detected.size());
+
+    for(const auto& detected: _klinesDetectedList.detected)
+    {
+        Q_CHECK_PTR(detected->history);
+        Q_CHECK_PTR(detected->reviewHistory);
+
+        Q_ASSERT(!detected->stockExchangeId.isEmpty());
+        Q_ASSERT(!detected->history->empty());
+        Q_ASSERT(!detected->reviewHistory->empty());
+
+        StockExchangeIDJson(detected->stockExchangeId).toBinary(stream);
+
+        stream << detected->delta << detected->volume << static_cast<quint32>(detected->filterActivate.toInt());
+
+        writeBinaryString(stream, detected->msg);
+
+        KLinesArrayJson(detected->history).toBinary(stream);
+        KLinesArrayJson(detected->reviewHistory).toBinary(stream);
+    }
+}
+
 const Detector::KLinesDetectedList &DetectAnswer::klinesDetectedList() const noexcept
 {
     return _klinesDetectedList;
@@ -994,6 +1459,80 @@ QJsonObject KLinesIDListAnswer::toJson() const
     return resultJson;
 }
 
+void KLinesIDListAnswer::writeJson(JsonWriter &writer) const
+{
+    writer.beginObject();
+
+    writer.key("KLinesIDList");
+    writer.beginArray();
+    for (const auto& klineId: *_klinesIdList)
+    {
+        KLineIDJson(klineId).writeJson(writer);
+    }
+    writer.endArray();
+
+    writer.keyValue("Msg", _message);
+    writer.key("StockExchangeID");
+    StockExchangeIDJson(_stockExchangeId).writeJson(writer);
+
+    writer.endObject();
+}
+
+KLinesIDListAnswer::KLinesIDListAnswer(QDataStream &stream)
+{
+    _klinesIdList = std::make_shared<KLinesIDList>();
+    try
+    {
+        _stockExchangeId = StockExchangeIDJson(stream).stockExchangeId();
+
+        quint32 count = 0;
+        stream >> count;
+
+        checkBinaryStream(stream, "Root/Data/StockExchangeID");
+
+        if (_stockExchangeId.isEmpty())
+        {
+            throw ParseException(QString("Error parsing Root/Data/StockExchangeID: stock exchange ID cannot be empty"));
+        }
+
+        checkBinaryCount(stream, count, BINARY_KLINE_ID_MIN_SIZE, "Root/Data/KLinesIdList");
+
+        _klinesIdList->reserve(count);
+        for (quint32 i = 0; i < count; ++i)
+        {
+            KLineIDJson klineId(stream);
+
+            checkBinaryStream(stream, "Root/Data/KLinesIdList/[]");
+
+            _klinesIdList->insert(klineId.klineId());
+        }
+
+        _message = readBinaryString(stream);
+
+        checkBinaryStream(stream, "Root/Data/KLinesIdList");
+    }
+    catch (const ParseException& err)
+    {
+        _errorString = err.what();
+
+        _stockExchangeId = StockExchangeID();
+        _klinesIdList->clear();
+    }
+}
+
+void KLinesIDListAnswer::toBinary(QDataStream &stream) const
+{
+    StockExchangeIDJson(_stockExchangeId).toBinary(stream);
+
+    stream << static_cast<quint32>(_klinesIdList->size());
+    for (const auto& klineId: *_klinesIdList)
+    {
+        KLineIDJson(klineId).toBinary(stream);
+    }
+
+    writeBinaryString(stream, _message);
+}
+
 const StockExchangeID &KLinesIDListAnswer::stockExchangeId() const noexcept
 {
     return _stockExchangeId;
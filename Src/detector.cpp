@@ -1,6 +1,8 @@
 //STL
 #include <cfloat>
 
+#include "TradingCatCommon/numberformat.h"
+
 #include "TradingCatCommon/detector.h"
 
 using namespace TradingCatCommon;
@@ -129,7 +131,7 @@ void Detector::addKLines(const TradingCatCommon::StockExchangeID& stockExchangeI
                 detectType.setFlag(Filter::UNDETECT, false);
                 detectType.setFlag(Filter::DELTA);
 
-                msg += QString(", %1:%2").arg(Filter::filterTypeToString(Filter::DELTA)).arg(delta, 0, 'f');
+                msg += QString(", %1:%2").arg(Filter::filterTypeToString(Filter::DELTA)).arg(fixedNumberToString(delta));
             }
 
             const auto volume = kline->volumeKLine();
@@ -143,8 +145,8 @@ void Detector::addKLines(const TradingCatCommon::StockExchangeID& stockExchangeI
 
                 msg += QString(", %1:%2(%3 slots)")
                            .arg(Filter::filterTypeToString(Filter::VOLUME))
-                           .arg(volume, 0, 'f')
-                           .arg(kline->volume, 0, 'f', 0);
+                           .arg(fixedNumberToString(volume))
+                           .arg(fixedNumberToString(kline->volume, 0));
             }
 
             if (detectType.testFlag(Filter::DELTA) && detectType.testFlag(Filter::VOLUME))
@@ -153,11 +155,11 @@ void Detector::addKLines(const TradingCatCommon::StockExchangeID& stockExchangeI
                           .arg(stockExchangeId.toString())
                           .arg(kline->id.toString())
                           .arg(QDateTime::fromMSecsSinceEpoch(kline->closeTime).toString("hh:mm"))
-                          .arg(kline->high)
-                          .arg(kline->open)
-                          .arg(kline->close)
-                          .arg(kline->low)
-                          .arg(kline->volume)
+                          .arg(generalNumberToString(kline->high))
+                          .arg(generalNumberToString(kline->open))
+                          .arg(generalNumberToString(kline->close))
+                          .arg(generalNumberToString(kline->low))
+                          .arg(generalNumberToString(kline->volume))
                           .arg(msg.remove(0, 2));
 
                 const auto& klineIdHistory = kline->id;
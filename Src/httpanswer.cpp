@@ -3,6 +3,7 @@
 using namespace TradingCatCommon;
 
 HTTPAnswer::HTTPAnswer(uint16_t code)
+    : _code(code)
 {
     Q_ASSERT(AnswerCode.contains(code));
 
@@ -17,14 +18,18 @@ QByteArray HTTPAnswer::getAnswer()
 {
     QByteArray answer = QString("%1\r\n").arg(_status).toUtf8();
 
-    //добавляем тег Content-Length если его нет
-    if (_headers.find("Content-Length") == _headers.end())
+    //добавляем тег Content-Length если его нет. Информационные ответы (1xx) и 304 Not Modified тела не имеют,
+    //при передаче частями (Transfer-Encoding) длина тела заранее неизвестна
+    if (_code >= 200 && _code != 304)
     {
-        _headers.insert("Content-Length", QString::number(_body.size()));
-    }
-    if (_headers.find("Content-Type") == _headers.end())
-    {
-         _headers.insert("Content-Type", "application/json");
+        if (_headers.find("Content-Length") == _headers.end() && _headers.find("Transfer-Encoding") == _headers.end())
+        {
+            _headers.insert("Content-Length", QString::number(_body.size()));
+        }
+        if (_headers.find("Content-Type") == _headers.end())
+        {
+             _headers.insert("Content-Type", "application/json");
+        }
     }
     for (auto headers_it = _headers.begin(); headers_it != _headers.end(); ++headers_it)
     {
@@ -46,3 +51,34 @@ void HTTPAnswer::addBody(const QByteArray& data)
 {
     _body += data;
 }
+
+void HTTPAnswer::addBody(const QByteArray& body, ContentEncoding encoding)
+{
+    Q_ASSERT(_body.isEmpty());
+
+    _body = body;
+
+    //Содержимое ответа зависит от Accept-Encoding запроса, сообщаем об этом промежуточным кешам
+    _headers.insert("Vary", "Accept-Encoding");
+    if (encoding != ContentEncoding::IDENTITY)
+    {
+        _headers.insert("Content-Encoding", contentEncodingToString(encoding));
+    }
+}
+
+QByteArray HTTPAnswer::chunk(const QByteArray& data)
+{
+    if (data.isEmpty())
+    {
+        return QByteArray("0\r\n\r\n");
+    }
+
+    QByteArray result;
+    result.reserve(data.size() + 16);
+    result += QByteArray::number(data.size(), 16);
+    result += "\r\n";
+    result += data;
+    result += "\r\n";
+
+    return result;
+}
@@ -1,12 +1,15 @@
+//STL
+#include <algorithm>
+
 //Qt
-#include <QJsonParseError>
+#include <QRandomGenerator>
 
 #include "TradingCatCommon/httpclient.h"
 
 using namespace TradingCatCommon;
 using namespace Common;
 
-static const quint64 SEND_TIMEOUT = 10u * 1000u; //ms
+static const qint64 TIMEOUT_WHEEL_TICK = 1000;   ///< Интервал поворота колеса таймаутов (мсек). Определяет точность таймаута запроса
 
 HTTPClient::HTTPClient(const HTTPClientConfig& config, QObject *parent /* = nullptr */)
     : QObject{parent}
@@ -22,56 +25,297 @@ HTTPClient::HTTPClient(const HTTPClientConfig& config, QObject *parent /* = null
             SLOT(errorOccurredHTTP(QNetworkReply::NetworkError, quint64, const QString&, quint64)));
     connect(_http, SIGNAL(sendLogMsg(Common::TDBLoger::MSG_CODE, const QString&, quint64)),
             SLOT(sendLogMsgHTTP(Common::TDBLoger::MSG_CODE, const QString&, quint64)));
+
+    _headers.insert("Accept", QString("%1, %2").arg(packageFormatToContentType(_config.format)).arg(*JSON_CONTENT_TYPE).toUtf8());
+    if (_config.compression)
+    {
+        _headers.insert("Accept-Encoding", "gzip, deflate");
+    }
+    //Все запросы отправляются через один HTTPSSLQuery, который переиспользует открытые соединения с сервером
+    _headers.insert("Connection", "keep-alive");
+
+    _http->setHeaders(_headers);
+
+    //Запрос попадает в интервал, который будет обработан не раньше чем через requestTimeout,
+    //поэтому фактический таймаут - от requestTimeout до requestTimeout + TIMEOUT_WHEEL_TICK
+    _timeoutWheel.resize(static_cast<size_t>((_config.requestTimeout + TIMEOUT_WHEEL_TICK - 1) / TIMEOUT_WHEEL_TICK) + 2);
+
+    _timeoutWheelTimer = new QTimer(this);
+
+    connect(_timeoutWheelTimer, SIGNAL(timeout()), SLOT(timeoutWheel()));
+
+    _timeoutWheelTimer->start(TIMEOUT_WHEEL_TICK);
+}
+
+bool HTTPClient::isCachedAnswer(PackageType type) noexcept
+{
+    //Списки бирж и свечей изменяются редко, а запрашиваются при каждом запуске и повторе
+    return type == PackageType::STOCK_EXCHANGE_LIST || type == PackageType::KLINE_LIST;
+}
+
+QString HTTPClient::answerCacheKey(const Query& query)
+{
+    return QString("%1?%2").arg(query.path()).arg(query.query().toString());
 }
 
 quint64 HTTPClient::getPackage(std::unique_ptr<Query>&& query)
 {
-    Q_CHECK_PTR(_http);
     Q_CHECK_PTR(query);
 
-    QUrl url(QString("http://%1").arg(_config.address.toString()));
-    url.setPort(_config.port);
-    url.setPath(QString("/%1").arg(query->path()));
+    const auto id = query->id();
+
+    _queue.push_back({std::move(query), Clock::now()});
+
+    sendQueued();
 
-    const auto queryList = query->query();
-    if (!queryList.isEmpty())
+    _metrics.maxQueueSize = std::max<quint64>(_metrics.maxQueueSize, _queue.size());
+
+    return id;
+}
+
+void HTTPClient::sendQueued()
+{
+    Q_CHECK_PTR(_http);
+
+    //Количество выполняемых запросов не больше числа соединений HTTPSSLQuery с сервером, поэтому запрос не ждет
+    //свободного соединения внутри HTTPSSLQuery и время ожидания учитывается в очереди клиента
+    //Запросы, завершенные по таймауту, продолжают занимать соединения HTTPSSLQuery до ответа сервера
+    for (auto it_queue = _queue.begin(); it_queue != _queue.end() && _package.size() + _expired.size() < _config.maxInFlightRequests; )
     {
-        url.setQuery(queryList);
+        //Запросы, приостановленные автоматом защиты, ждут в очереди окончания паузы
+        if (!isCircuitAllow(it_queue->query->type()))
+        {
+            ++it_queue;
+
+            continue;
+        }
+
+        auto query = std::move(it_queue->query);
+        const auto queueTime = it_queue->queueTime;
+        it_queue = _queue.erase(it_queue);
+
+        QUrl url(QString("http://%1").arg(_config.address.toString()));
+        url.setPort(_config.port);
+        url.setPath(query->path());
+
+        const auto queryList = query->query();
+        if (!queryList.isEmpty())
+        {
+            url.setQuery(queryList);
+        }
+
+        query->trySend();
+
+        //Заголовки применяются к каждому отправляемому запросу, поэтому If-None-Match добавляется только к запросу с сохраненным ответом
+        if (isCachedAnswer(query->type()))
+        {
+            auto headers = _headers;
+            const auto it_answersCache = _answersCache.constFind(answerCacheKey(*query));
+            if (it_answersCache != _answersCache.constEnd())
+            {
+                headers.insert("If-None-Match", it_answersCache->eTag.toLatin1());
+            }
+            _http->setHeaders(headers);
+        }
+        else
+        {
+            _http->setHeaders(_headers);
+        }
+
+        const auto sendTime = Clock::now();
+        const auto id = _http->send(url, HTTPSSLQuery::RequestType::GET);
+
+        _metrics.queueTime.add(static_cast<quint64>(std::chrono::duration_cast<std::chrono::microseconds>(sendTime - queueTime).count()));
+        ++_metrics.requests;
+
+        //Интервал перед текущим будет обработан последним
+        _timeoutWheel[(_timeoutWheelPos + _timeoutWheel.size() - 1) % _timeoutWheel.size()].push_back(id);
+
+        _package.emplace(id, SentPackage{std::move(query), sendTime});
     }
+}
 
-    query->trySend();
+void HTTPClient::finishPackage(quint64 id)
+{
+    const auto it_package = _package.find(id);
+    if (it_package == _package.end())
+    {
+        return;
+    }
+
+    _metrics.serverTime.add(static_cast<quint64>(std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - it_package->second.sendTime).count()));
+
+    _package.erase(it_package);
+
+    sendQueued();
+}
+
+void HTTPClient::timeoutWheel()
+{
+    _timeoutWheelPos = (_timeoutWheelPos + 1) % _timeoutWheel.size();
+
+    //Ответы на часть запросов интервала уже получены - их ИД пропускаются
+    auto expired = std::move(_timeoutWheel[_timeoutWheelPos]);
+    _timeoutWheel[_timeoutWheelPos].clear();
+
+    for (const auto id: expired)
+    {
+        //HTTPSSLQuery не сообщил о завершении запроса и за второй таймаут - больше не ждем его
+        if (_expired.erase(id) != 0)
+        {
+            emit sendLogMsg(TDBLoger::MSG_CODE::WARNING_CODE, QString("HTTP request %1 did not complete after timeout. Release it").arg(id));
+
+            continue;
+        }
+
+        if (!_package.contains(id))
+        {
+            continue;
+        }
+
+        ++_metrics.timeouts;
+
+        //До ответа сервера запрос занимает соединение, поэтому остается в числе выполняемых еще один таймаут
+        _expired.insert(id);
+        _timeoutWheel[(_timeoutWheelPos + _timeoutWheel.size() - 1) % _timeoutWheel.size()].push_back(id);
+
+        errorOccurredHTTP(QNetworkReply::TimeoutError, 0, QString("Request timeout: %1 ms").arg(_config.requestTimeout), id);
+    }
 
-    const auto id = _http->send(url, HTTPSSLQuery::RequestType::GET);
+    if (!_queue.empty())
+    {
+        sendQueued();
+    }
+}
 
-    if (query->isFirstUse())
+bool HTTPClient::releaseExpired(quint64 id)
+{
+    if (_expired.erase(id) == 0)
     {
-        query->setID(id);
+        return false;
     }
 
-    _package.emplace(id, std::move(query));
+    sendQueued();
 
-    return id;
+    return true;
 }
 
 void HTTPClient::retryGetPackage(std::unique_ptr<Query>&& query)
 {
-    QTimer::singleShot(SEND_TIMEOUT, this,
+    Q_CHECK_PTR(query);
+
+    QTimer::singleShot(retryDelay(query->type()), this,
         [query = std::move(query), this]() mutable
         {
             getPackage(std::move(query));
         });
 }
 
-HTTPClient::ParseResult HTTPClient::parseStockExchangeList(const QByteArray &answer, const Query* query)
+qint64 HTTPClient::decorrelatedJitter(qint64 base, qint64 cap, qint64 previous)
+{
+    Q_ASSERT(base > 0);
+    Q_ASSERT(base <= cap);
+
+    const auto upper = std::clamp(previous * 3, base, cap);
+
+    return upper > base ? static_cast<qint64>(QRandomGenerator::global()->bounded(base, upper + 1)) : base;
+}
+
+qint64 HTTPClient::retryDelay(PackageType type)
+{
+    auto& circuit = _metrics.circuits[type];
+
+    //Задержки разных клиентов случайны, поэтому после перезапуска сервера повторы не приходят одновременно
+    circuit.retryDelay = decorrelatedJitter(_config.retryBaseDelay, _config.retryMaxDelay, circuit.retryDelay);
+
+    if (circuit.state != HTTPClientCircuitState::OPEN)
+    {
+        return circuit.retryDelay;
+    }
+
+    return std::max(circuit.retryDelay, circuit.openUntil - QDateTime::currentMSecsSinceEpoch());
+}
+
+bool HTTPClient::isCircuitAllow(PackageType type)
 {
-    QJsonParseError error;
-    const auto jsonDoc = QJsonDocument::fromJson(answer, &error);
-    if (error.error != QJsonParseError::NoError)
+    const auto it_circuit = _metrics.circuits.find(type);
+    if (it_circuit == _metrics.circuits.end())
     {
-        return QString("Error JSON parsing: %1").arg(error.errorString());
+        return true;
     }
 
-    Package<StockExchangesIDArrayJson> package(jsonDoc);
+    auto& circuit = it_circuit->second;
+    switch (circuit.state)
+    {
+    case HTTPClientCircuitState::CLOSED:
+        return true;
+    case HTTPClientCircuitState::OPEN:
+        if (QDateTime::currentMSecsSinceEpoch() < circuit.openUntil)
+        {
+            return false;
+        }
+
+        //Пауза закончилась - отправляем пробный запрос
+        circuit.state = HTTPClientCircuitState::HALF_OPEN;
+
+        return true;
+    case HTTPClientCircuitState::HALF_OPEN:
+        return false;
+    default:
+        Q_ASSERT(false);
+    }
+
+    return false;
+}
+
+void HTTPClient::circuitSuccess(PackageType type)
+{
+    const auto it_circuit = _metrics.circuits.find(type);
+    if (it_circuit == _metrics.circuits.end())
+    {
+        return;
+    }
+
+    auto& circuit = it_circuit->second;
+    if (circuit.state != HTTPClientCircuitState::CLOSED)
+    {
+        emit sendLogMsg(TDBLoger::MSG_CODE::INFORMATION_CODE, QString("The server responds again. Requests type %1 resumed")
+                                                                  .arg(static_cast<quint8>(type)));
+    }
+
+    circuit.state = HTTPClientCircuitState::CLOSED;
+    circuit.failures = 0;
+    circuit.retryDelay = 0;
+    circuit.openTime = 0;
+}
+
+void HTTPClient::circuitFailure(PackageType type)
+{
+    auto& circuit = _metrics.circuits[type];
+
+    ++circuit.failures;
+
+    //Ошибка пробного запроса открывает автомат снова, иначе - после нескольких ошибок подряд
+    if (circuit.state == HTTPClientCircuitState::OPEN ||
+        (circuit.state == HTTPClientCircuitState::CLOSED && circuit.failures < _config.circuitFailureThreshold))
+    {
+        return;
+    }
+
+    circuit.state = HTTPClientCircuitState::OPEN;
+    circuit.openTime = decorrelatedJitter(_config.circuitOpenTime, _config.circuitMaxOpenTime, circuit.openTime);
+    circuit.openUntil = QDateTime::currentMSecsSinceEpoch() + circuit.openTime;
+    ++circuit.opens;
+
+    emit sendLogMsg(TDBLoger::MSG_CODE::WARNING_CODE, QString("The server does not respond. Requests type %1 paused for %2 ms after %3 failures")
+                                                          .arg(static_cast<quint8>(type))
+                                                          .arg(circuit.openTime)
+                                                          .arg(circuit.failures));
+}
+
+HTTPClient::ParseResult HTTPClient::parseStockExchangeList(const QByteArray &answer, const Query* query)
+{
+    Package<StockExchangesIDArrayJson> package(answer);
     if (package.isError())
     {
         return QString("Error get answer StockExchangeList from Stock exchage server. Error: %1").arg(package.errorString());
@@ -86,14 +330,7 @@ HTTPClient::ParseResult HTTPClient::parseStockExchangeList(const QByteArray &ans
 
 HTTPClient::ParseResult HTTPClient::parseKLineList(const QByteArray &answer, const Query* query)
 {
-    QJsonParseError error;
-    const auto jsonDoc = QJsonDocument::fromJson(answer, &error);
-    if (error.error != QJsonParseError::NoError)
-    {
-        return QString("Error JSON parsing: %1").arg(error.errorString());
-    }
-
-    Package<KLinesIDArrayJson> package(jsonDoc);
+    Package<KLinesIDArrayJson> package(answer);
     if (package.isError())
     {
         return QString("Error get answer KLineList from Stock exchage server. Error: %1").arg(package.errorString());
@@ -115,14 +352,7 @@ HTTPClient::ParseResult HTTPClient::parseKLineList(const QByteArray &answer, con
 
 HTTPClient::ParseResult HTTPClient::parseKLineNew(const QByteArray &answer, const Query* query)
 {
-    QJsonParseError error;
-    const auto jsonDoc = QJsonDocument::fromJson(answer, &error);
-    if (error.error != QJsonParseError::NoError)
-    {
-        return QString("Error JSON parsing: %1").arg(error.errorString());
-    }
-
-    Package<KLinesNewArrayJson> package(jsonDoc);
+    Package<KLinesNewArrayJson> package(answer);
     if (package.isError())
     {
         return QString("Error get answer KLineNew from Stock exchage server. Error: %1").arg(package.errorString());
@@ -149,19 +379,14 @@ HTTPClient::ParseResult HTTPClient::parseKLineNew(const QByteArray &answer, cons
         emit klineNew(stockExchangeId, klinesList, query->id());
     }
 
+    emit klineNewReceived(static_cast<qsizetype>(data.klines().size()), _lastGetKLineId, query->id());
+
     return std::nullopt;
 }
 
 HTTPClient::ParseResult HTTPClient::parseKLineHistory(const QByteArray &answer, const Query* query)
 {
-    QJsonParseError error;
-    const auto jsonDoc = QJsonDocument::fromJson(answer, &error);
-    if (error.error != QJsonParseError::NoError)
-    {
-        return QString("Error JSON parsing: %1").arg(error.errorString());
-    }
-
-    Package<KLinesHistoryArrayJson> package(jsonDoc);
+    Package<KLinesHistoryArrayJson> package(answer);
     if (package.isError())
     {
         return QString("Error get answer KLineHistory from Stock exchage server. Error: %1").arg(package.errorString());
@@ -181,6 +406,12 @@ HTTPClient::ParseResult HTTPClient::parseKLineHistory(const QByteArray &answer,
         it_newKLines->second->push_back(kline.kline());
     }
 
+    //Ожидающий ответа должен узнать о завершении запроса, поэтому пустая история - ошибка
+    if (newKLines.empty())
+    {
+        return QString("Get empty KLine history");
+    }
+
     for (const auto& [stockExchangeId, klinesList]: newKLines)
     {
         emit klineHistory(stockExchangeId, klinesList, query->id());
@@ -191,14 +422,7 @@ HTTPClient::ParseResult HTTPClient::parseKLineHistory(const QByteArray &answer,
 
 HTTPClient::ParseResult HTTPClient::parseServerStatus(const QByteArray& answer, const Query* query)
 {
-    QJsonParseError error;
-    const auto jsonDoc = QJsonDocument::fromJson(answer, &error);
-    if (error.error != QJsonParseError::NoError)
-    {
-        return QString("Error JSON parsing: %1").arg(error.errorString());
-    }
-
-    Package<ServerStatusJson> package(jsonDoc);
+    Package<ServerStatusJson> package(answer);
     if (package.isError())
     {
         return QString("Error get answer ServerStatus from Stock exchage server. Error: %1").arg(package.errorString());
@@ -211,17 +435,50 @@ HTTPClient::ParseResult HTTPClient::parseServerStatus(const QByteArray& answer,
     return std::nullopt;
 }
 
-void HTTPClient::getAnswerHTTP(const QByteArray& answer, quint64 id)
+void HTTPClient::getAnswerHTTP(const QByteArray& httpAnswer, quint64 id)
 {
+    //Ответ на запрос, уже завершенный по таймауту
     auto it_package = _package.find(id);
     if (it_package == _package.end())
     {
-        Q_ASSERT(false);
+        releaseExpired(id);
+
+        return;
     }
 
-    auto& query = it_package->second;
+    //Сервер ответил, даже если ответ не удастся разобрать
+    circuitSuccess(it_package->second.query->type());
+
+    //Заголовок Content-Encoding недоступен, поэтому сжатый ответ определяем по сигнатуре.
+    //JSON и двоичный пакеты не могут начинаться с сигнатуры gzip/zlib
+    auto answer = isCompressedData(httpAnswer) ? decompressData(httpAnswer) : httpAnswer;
+
+    auto& query = it_package->second.query;
+
+    //Пустой результат распаковки не должен восприниматься как ответ 304 Not Modified
+    if (answer.isEmpty() && !httpAnswer.isEmpty())
+    {
+        ++_metrics.errors;
+
+        emit errorOccurred(QString("The request to the server could not be completed. Incorrect compressed answer or answer size exceeds %1 bytes")
+                               .arg(MAX_DECOMPRESSED_SIZE), query->type(), query->id());
+
+        finishPackage(id);
+
+        return;
+    }
     const auto packageType = query->type();
 
+    //Ответ 304 Not Modified не имеет тела - используем сохраненный ответ
+    const auto isCached = isCachedAnswer(packageType);
+    const auto cacheKey = isCached ? answerCacheKey(*query) : QString();
+    const auto it_answersCache = isCached && answer.isEmpty() ? _answersCache.constFind(cacheKey) : _answersCache.constEnd();
+    const bool isNotModified = it_answersCache != _answersCache.constEnd();
+    if (isNotModified)
+    {
+        answer = it_answersCache->answer;
+    }
+
     ParseResult parseResult;
     switch (packageType)
     {
@@ -247,25 +504,61 @@ void HTTPClient::getAnswerHTTP(const QByteArray& answer, quint64 id)
 
     if (parseResult.has_value())
     {
+        //Сохраненный ответ не должен приводить к повторной ошибке
+        _answersCache.remove(cacheKey);
+
+        ++_metrics.errors;
+
         emit errorOccurred(QString("The request to the server could not be completed. %1")
-                               .arg(parseResult.value()), query->type(), id);
+                               .arg(parseResult.value()), query->type(), query->id());
+    }
+    else if (isCached && !isNotModified)
+    {
+        //ETag вычисляется так же как на сервере - по содержимому несжатого ответа
+        _answersCache.insert(cacheKey, HTTPClientCachedAnswer{answerETag(answer), answer});
     }
 
-    _package.erase(id);
+    finishPackage(id);
 }
 
 void HTTPClient::errorOccurredHTTP(QNetworkReply::NetworkError code, quint64 serverCode, const QString &msg, quint64 id)
 {
     Q_UNUSED(code);
-    Q_UNUSED(serverCode);
 
+    //Ошибка запроса, уже завершенного по таймауту
     auto it_package = _package.find(id);
-    Q_ASSERT(it_package != _package.end());
+    if (it_package == _package.end())
+    {
+        releaseExpired(id);
+
+        return;
+    }
+
+    auto& query = it_package->second.query;
+
+    //Ответ 304 Not Modified - сохраненный ответ не изменился
+    if (serverCode == 304 && isCachedAnswer(query->type()) && _answersCache.contains(answerCacheKey(*query)))
+    {
+        getAnswerHTTP(QByteArray(), id);
+
+        return;
+    }
 
     emit sendLogMsg(TDBLoger::MSG_CODE::WARNING_CODE, QString("Error processing HTTP request: Package ID: %1 Message: %2").arg(id).arg(msg));
 
-    auto& query = it_package->second;
+    ++_metrics.errors;
+
     const auto packageType = query->type();
+
+    //Сервер недоступен, перегружен или перезапускается. Ответ 4xx означает, что сервер работает
+    if (serverCode == 0 || serverCode >= 500)
+    {
+        circuitFailure(packageType);
+    }
+    else
+    {
+        circuitSuccess(packageType);
+    }
     switch (packageType)
     {
     case PackageType::STOCK_EXCHANGE_LIST:
@@ -284,7 +577,7 @@ void HTTPClient::errorOccurredHTTP(QNetworkReply::NetworkError code, quint64 ser
         }
         else
         {
-            emit errorOccurred(QString("The request to the server could not be completed. %1").arg(msg), query->type(), id);
+            emit errorOccurred(QString("The request to the server could not be completed. %1").arg(msg), query->type(), query->id());
         }
         break;
     case PackageType::NULL_DATA:
@@ -294,7 +587,7 @@ void HTTPClient::errorOccurredHTTP(QNetworkReply::NetworkError code, quint64 ser
         Q_ASSERT(false);
     }
 
-    _package.erase(id);
+    finishPackage(id);
 }
 
 void HTTPClient::sendLogMsgHTTP(Common::TDBLoger::MSG_CODE category, const QString &msg, quint64 id)
@@ -341,7 +634,25 @@ quint64 HTTPClient::sendKLineHistory(const StockExchangeID stockExchangeID, cons
     return getPackage(std::move(query));
 }
 
+const HTTPClientAnswersCache& HTTPClient::answersCache() const noexcept
+{
+    return _answersCache;
+}
+
+void HTTPClient::setAnswersCache(const HTTPClientAnswersCache& answersCache)
+{
+    _answersCache = answersCache;
+}
+
+const HTTPClientMetrics& HTTPClient::metrics() const noexcept
+{
+    return _metrics;
+}
+
 bool HTTPClientConfig::isCheck() const noexcept
 {
-    return !address.isNull() && port != 0;
+    return !address.isNull() && port != 0 && maxInFlightRequests > 0 && requestTimeout > 0 &&
+           retryBaseDelay > 0 && retryBaseDelay <= retryMaxDelay &&
+           circuitFailureThreshold > 0 && circuitOpenTime > 0 && circuitOpenTime <= circuitMaxOpenTime &&
+           pushSessionId >= 0;
 }
@@ -0,0 +1,237 @@
+//STL
+#include <algorithm>
+
+//zlib
+#include <zlib.h>
+
+//Qt
+#include <QStringList>
+
+#include "TradingCatCommon/httpcompression.h"
+
+using namespace TradingCatCommon;
+
+static const int ZLIB_WINDOW_BITS = 15;         ///< Размер окна zlib
+static const int GZIP_WINDOW_BITS_OFFSET = 16;  ///< Добавка к размеру окна для формата gzip
+static const int AUTO_WINDOW_BITS_OFFSET = 32;  ///< Добавка к размеру окна для автоматического определения формата при распаковке
+static const qsizetype DECOMPRESS_CHUNK_SIZE = 64 * 1024;
+
+ContentEncoding TradingCatCommon::acceptEncodingToContentEncoding(const QString &acceptEncoding)
+{
+    bool isGzip = false;
+    bool isDeflate = false;
+
+    for (const auto& item: acceptEncoding.split(',', Qt::SkipEmptyParts))
+    {
+        const auto params = item.split(';');
+        const auto coding = params.front().trimmed().toLower();
+
+        //Кодирование с нулевым весом клиент явно не принимает
+        bool isAccept = true;
+        for (qsizetype i = 1; i < params.size(); ++i)
+        {
+            const auto param = params[i].trimmed();
+            if (param.startsWith("q=", Qt::CaseInsensitive))
+            {
+                isAccept = param.mid(2).toDouble() > 0.0;
+            }
+        }
+
+        if (!isAccept)
+        {
+            continue;
+        }
+
+        if (coding == "gzip" || coding == "x-gzip" || coding == "*")
+        {
+            isGzip = true;
+        }
+        else if (coding == "deflate")
+        {
+            isDeflate = true;
+        }
+    }
+
+    if (isGzip)
+    {
+        return ContentEncoding::GZIP;
+    }
+    if (isDeflate)
+    {
+        return ContentEncoding::DEFLATE;
+    }
+
+    return ContentEncoding::IDENTITY;
+}
+
+QString TradingCatCommon::contentEncodingToString(ContentEncoding encoding)
+{
+    switch (encoding)
+    {
+    case ContentEncoding::GZIP: return "gzip";
+    case ContentEncoding::DEFLATE: return "deflate";
+    case ContentEncoding::IDENTITY:
+    default:
+        break;
+    }
+
+    return QString();
+}
+
+QByteArray TradingCatCommon::compressData(const QByteArray &data, ContentEncoding encoding, int level)
+{
+    Q_ASSERT(encoding != ContentEncoding::IDENTITY);
+    Q_ASSERT(level >= Z_BEST_SPEED && level <= Z_BEST_COMPRESSION);
+
+    z_stream stream = {};
+    const auto windowBits = encoding == ContentEncoding::GZIP ? ZLIB_WINDOW_BITS + GZIP_WINDOW_BITS_OFFSET : ZLIB_WINDOW_BITS;
+    if (deflateInit2(&stream, level, Z_DEFLATED, windowBits, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+    {
+        return QByteArray();
+    }
+
+    QByteArray result(static_cast<qsizetype>(deflateBound(&stream, static_cast<uLong>(data.size()))), Qt::Uninitialized);
+
+    stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.constData()));
+    stream.avail_in = static_cast<uInt>(data.size());
+    stream.next_out = reinterpret_cast<Bytef*>(result.data());
+    stream.avail_out = static_cast<uInt>(result.size());
+
+    //Размер выходного буфера равен deflateBound(), поэтому данные сжимаются за один вызов
+    const auto res = deflate(&stream, Z_FINISH);
+    const auto totalOut = static_cast<qsizetype>(stream.total_out);
+
+    deflateEnd(&stream);
+
+    if (res != Z_STREAM_END)
+    {
+        return QByteArray();
+    }
+
+    result.resize(totalOut);
+
+    return result;
+}
+
+bool TradingCatCommon::isCompressedData(const QByteArray &data) noexcept
+{
+    if (data.size() < 2)
+    {
+        return false;
+    }
+
+    const auto first = static_cast<uchar>(data[0]);
+    const auto second = static_cast<uchar>(data[1]);
+
+    //gzip
+    if (first == 0x1f && second == 0x8b)
+    {
+        return true;
+    }
+
+    //zlib: метод сжатия deflate и корректная контрольная сумма заголовка
+    return (first & 0x0f) == Z_DEFLATED && ((first << 8) | second) % 31 == 0;
+}
+
+QByteArray TradingCatCommon::decompressData(const QByteArray &data, qsizetype maxSize /* = MAX_DECOMPRESSED_SIZE */)
+{
+    Q_ASSERT(maxSize > 0);
+
+    z_stream stream = {};
+    if (inflateInit2(&stream, ZLIB_WINDOW_BITS + AUTO_WINDOW_BITS_OFFSET) != Z_OK)
+    {
+        return QByteArray();
+    }
+
+    stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.constData()));
+    stream.avail_in = static_cast<uInt>(data.size());
+
+    QByteArray result;
+    int res = Z_OK;
+    while (res == Z_OK)
+    {
+        //Буфер выделяется с запасом в 1 байт сверх maxSize, чтобы отличить данные ровно maxSize от превышения
+        const auto offset = result.size();
+        if (offset > maxSize)
+        {
+            break;
+        }
+
+        const auto chunkSize = std::min(DECOMPRESS_CHUNK_SIZE, maxSize + 1 - offset);
+        result.resize(offset + chunkSize);
+
+        stream.next_out = reinterpret_cast<Bytef*>(result.data() + offset);
+        stream.avail_out = static_cast<uInt>(chunkSize);
+
+        res = inflate(&stream, Z_NO_FLUSH);
+
+        result.resize(offset + chunkSize - static_cast<qsizetype>(stream.avail_out));
+    }
+
+    inflateEnd(&stream);
+
+    if (res != Z_STREAM_END || result.size() > maxSize)
+    {
+        return QByteArray();
+    }
+
+    return result;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///     The StreamCompressor class
+///
+StreamCompressor::StreamCompressor(ContentEncoding encoding, int level)
+    : _stream(std::make_unique<z_stream>())
+{
+    Q_ASSERT(encoding != ContentEncoding::IDENTITY);
+    Q_ASSERT(level >= Z_BEST_SPEED && level <= Z_BEST_COMPRESSION);
+
+    const auto windowBits = encoding == ContentEncoding::GZIP ? ZLIB_WINDOW_BITS + GZIP_WINDOW_BITS_OFFSET : ZLIB_WINDOW_BITS;
+    if (deflateInit2(_stream.get(), level, Z_DEFLATED, windowBits, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+    {
+        _stream.reset();
+        _isError = true;
+    }
+}
+
+StreamCompressor::~StreamCompressor()
+{
+    if (_stream)
+    {
+        deflateEnd(_stream.get());
+    }
+}
+
+QByteArray StreamCompressor::compress(const QByteArray &data, bool isFinish)
+{
+    if (_isError)
+    {
+        return QByteArray();
+    }
+
+    //Сброс после каждой части добавляет несколько байт, поэтому запас больше чем у deflateBound() для одного вызова
+    QByteArray result(static_cast<qsizetype>(deflateBound(_stream.get(), static_cast<uLong>(data.size()))) + 64, Qt::Uninitialized);
+
+    _stream->next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.constData()));
+    _stream->avail_in = static_cast<uInt>(data.size());
+    _stream->next_out = reinterpret_cast<Bytef*>(result.data());
+    _stream->avail_out = static_cast<uInt>(result.size());
+
+    const auto res = deflate(_stream.get(), isFinish ? Z_FINISH : Z_SYNC_FLUSH);
+    if ((isFinish && res != Z_STREAM_END) || (!isFinish && res != Z_OK) || _stream->avail_in != 0)
+    {
+        _isError = true;
+
+        return QByteArray();
+    }
+
+    result.resize(result.size() - static_cast<qsizetype>(_stream->avail_out));
+
+    return result;
+}
+
+bool StreamCompressor::isError() const noexcept
+{
+    return _isError;
+}
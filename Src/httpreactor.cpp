@@ -0,0 +1,219 @@
+//Linux
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+
+#include "TradingCatCommon/httpreactor.h"
+
+using namespace TradingCatCommon;
+using namespace Common;
+
+static const int LISTEN_BACKLOG = SOMAXCONN;
+
+/*!
+    Создает слушающий сокет с SO_REUSEPORT. Несколько таких сокетов на одном адресе и порту
+        позволяют ядру распределять входящие соединения между потоками без общей блокировки
+    @param address - адрес интерфейса
+    @param port - порт
+    @param errorString - [out] описание ошибки
+    @return дескриптор сокета или -1 в случае ошибки
+*/
+static qintptr makeListenSocket(const QHostAddress& address, quint16 port, QString& errorString)
+{
+    const auto protocol = address.protocol();
+    const bool isIPv4 = protocol == QAbstractSocket::IPv4Protocol;
+
+    const int fd = ::socket(isIPv4 ? AF_INET : AF_INET6, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd == -1)
+    {
+        errorString = QString("Error create socket: %1").arg(std::strerror(errno));
+
+        return -1;
+    }
+
+    const auto makeError = [fd, &errorString](const QString& operation)
+    {
+        errorString = QString("%1: %2").arg(operation).arg(std::strerror(errno));
+        ::close(fd);
+
+        return -1;
+    };
+
+    const int on = 1;
+    if (::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on)) == -1)
+    {
+        return makeError("Error set SO_REUSEADDR");
+    }
+    if (::setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &on, sizeof(on)) == -1)
+    {
+        return makeError("Error set SO_REUSEPORT");
+    }
+
+    int res = -1;
+    if (isIPv4)
+    {
+        sockaddr_in addr = {};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(port);
+        addr.sin_addr.s_addr = htonl(address.toIPv4Address());
+
+        res = ::bind(fd, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr));
+    }
+    else
+    {
+        //QHostAddress::Any - принимаем соединения и по IPv4 и по IPv6
+        const int v6only = protocol == QAbstractSocket::IPv6Protocol ? 1 : 0;
+        if (::setsockopt(fd, IPPROTO_IPV6, IPV6_V6ONLY, &v6only, sizeof(v6only)) == -1)
+        {
+            return makeError("Error set IPV6_V6ONLY");
+        }
+
+        sockaddr_in6 addr = {};
+        addr.sin6_family = AF_INET6;
+        addr.sin6_port = htons(port);
+        const auto ipv6 = address.toIPv6Address();
+        std::memcpy(&addr.sin6_addr, &ipv6, sizeof(addr.sin6_addr));
+
+        res = ::bind(fd, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr));
+    }
+
+    if (res == -1)
+    {
+        return makeError("Error bind socket");
+    }
+
+    if (::listen(fd, LISTEN_BACKLOG) == -1)
+    {
+        return makeError("Error listen socket");
+    }
+
+    return fd;
+}
+
+HTTPReactor::HTTPReactor(quint64 id, const HTTPServerConfig &serverConfig, const TradingData &data,
+                         quint64 maxConnections, AdmissionControl* admissionControl /* = nullptr */,
+                         PushChannel* pushChannel /* = nullptr */, ServerMetrics::ThreadMetrics* metrics /* = nullptr */,
+                         QObject *parent /* = nullptr */)
+    : QTcpServer(parent)
+    , _id(id)
+    , _serverConfig(serverConfig)
+    , _data(data)
+    , _maxConnections(maxConnections)
+    , _admissionControl(admissionControl)
+    , _pushChannel(pushChannel)
+    , _metrics(metrics)
+{
+    Q_ASSERT(_maxConnections > 0);
+}
+
+HTTPReactor::~HTTPReactor()
+{
+    stop();
+}
+
+quint64 HTTPReactor::id() const noexcept
+{
+    return _id;
+}
+
+void HTTPReactor::start()
+{
+    Q_ASSERT(!_isStarted);
+
+    QString errorString;
+    const auto fd = makeListenSocket(_serverConfig.address, _serverConfig.port, errorString);
+    if (fd == -1 || !setSocketDescriptor(fd))
+    {
+        if (fd != -1)
+        {
+            errorString = QString("Error listen socket: %1").arg(this->errorString());
+            ::close(fd);
+        }
+
+        emit errorOccurred(EXIT_CODE::SERVICE_START_ERR, QString("Reactor %1. Error listening server on %2:%3. %4")
+                                                             .arg(_id)
+                                                             .arg(_serverConfig.address.toString())
+                                                             .arg(_serverConfig.port)
+                                                             .arg(errorString));
+
+        return;
+    }
+
+    _isStarted = true;
+
+    emit sendLogMsg(TDBLoger::MSG_CODE::INFORMATION_CODE, QString("Reactor %1 is listening on %2:%3")
+                                                              .arg(_id)
+                                                              .arg(_serverConfig.address.toString())
+                                                              .arg(_serverConfig.port));
+
+    emit started(_id);
+}
+
+void HTTPReactor::stop()
+{
+    if (_isStarted)
+    {
+        close(); //прекращаем прием соединений
+
+        //Закрываем открытые соединения
+        for (const auto& [id, connection]: _connections)
+        {
+            QObject::disconnect(connection, nullptr, this, nullptr);
+            delete connection;
+        }
+        _connections.clear();
+
+        _isStarted = false;
+    }
+
+    //Сигнал отправляется и если реактор не запустился, чтобы поток реактора мог завершиться
+    emit finished(_id);
+}
+
+void HTTPReactor::incomingConnection(qintptr handle)
+{
+    auto connection = makeConnection();
+
+    if (static_cast<quint64>(_connections.size()) > _maxConnections)
+    {
+        emit sendLogMsg(TDBLoger::MSG_CODE::WARNING_CODE, QString("Reactor %1. Too many connetions: %2").arg(_id).arg(_maxConnections));
+
+        //Ответ отправляется без блокировки потока, соединение закроется после передачи
+        connection->rejectSocket(handle, 429, "Too Many Requests");
+
+        return;
+    }
+
+    connection->startSocket(handle);
+}
+
+SocketThread *HTTPReactor::makeConnection()
+{
+    const auto id = ++_lastConnectionId;
+
+    auto connection = new SocketThread(id, _serverConfig, _data, _admissionControl, _pushChannel, _metrics, this);
+
+    //log
+    QObject::connect(connection, SIGNAL(sendLogMsg(Common::MSG_CODE, const QString&)),
+                     SIGNAL(sendLogMsg(Common::MSG_CODE, const QString&)));
+
+    //соединение закрыто
+    QObject::connect(connection, SIGNAL(finishedSocket(quint64)), SLOT(finishedSocket(quint64)));
+
+    _connections.emplace(id, connection);
+
+    return connection;
+}
+
+void HTTPReactor::finishedSocket(quint64 id)
+{
+    const auto connections_it = _connections.find(id);
+    Q_ASSERT(connections_it != _connections.end());
+
+    //Сигнал приходит из обработчика соединения, поэтому удаляем его отложенно
+    connections_it->second->deleteLater();
+
+    _connections.erase(connections_it);
+}
@@ -1,100 +1,173 @@
-//Qt
-#include <QTextStream>
-#include <QDebug>
-#include <QRegularExpression>
+//STL
+#include <algorithm>
+#include <string_view>
+
+//My
+#include "TradingCatCommon/numberformat.h"
 
 #include "TradingCatCommon/httprequest.h"
 
 using namespace TradingCatCommon;
 
+static const qsizetype MAX_HEAD_SIZE = 64 * 1024;  ///< Максимальный размер заголовка запроса
+static const std::string_view HEAD_END = "\r\n\r\n";
+static const std::string_view LINE_END = "\r\n";
+
+/*!
+    Удаляет пробелы и табуляции в начале и в конце строки
+*/
+static std::string_view trimmed(std::string_view str) noexcept
+{
+    const auto begin = str.find_first_not_of(" \t");
+    if (begin == std::string_view::npos)
+    {
+        return str.substr(str.size()); //пустая строка, указывающая в тот же буфер
+    }
+
+    return str.substr(begin, str.find_last_not_of(" \t") - begin + 1);
+}
+
 void HTTPRequest::add(const QByteArray& data)
 {
     _totalGetSize += data.size(); //суммируем объем принятых данных
 
-    _body += data; //сохраняем пришедшие данные
-    //проверяем пришел ли весь заголовок (должна содержаться пустая строчка)
-    if (!_headerParsed)
+    if (_state == State::ERROR || _state == State::COMPLETE)
     {
-        if (_body.contains("\r\n\r\n")) { //найден заголовок - парсим его
-            QTextStream requestStr(_body);
+        _buffer += data; //данные следующего запроса
 
-            requestStr.setAutoDetectUnicode(true); //преобразуем в UNICODE
+        return;
+    }
 
-            QString tmp;
-            requestStr >> tmp; //читаем тип запроса
-            if (tmp == "GET")
-            {
-                _type = RequestType::GET;
-            }
-            else if (tmp == "POST")
-            {
-                _type = RequestType::POST;
-            }
-            else
-            {
-                _errorCode = 405; //Bad request
-                _errorMsg = "Method must be POST";
+    _buffer += data; //сохраняем пришедшие данные
+
+    if (_state == State::HEAD)
+    {
+        parseHead();
+    }
+
+    if (_state == State::BODY && _buffer.size() - _bodyBegin >= _lengthBody)
+    {
+        _state = State::COMPLETE;
+        _errorCode = 200;
+    }
+}
 
-                return;
-            }
+void HTTPRequest::parseHead()
+{
+    //Поиск продолжается с места остановки. Разделитель мог прийти частично в предыдущем фрагменте
+    const std::string_view buffer(_buffer.constData(), static_cast<size_t>(_buffer.size()));
+    const auto headEnd = buffer.find(HEAD_END, static_cast<size_t>(std::max<qsizetype>(_scanPos - (HEAD_END.size() - 1), 0)));
+    if (headEnd == std::string_view::npos)
+    {
+        _scanPos = _buffer.size();
 
-            requestStr >> tmp; //читаем запрашиваемый ресурс
-            tmp.remove(0,1);
+        if (_buffer.size() > MAX_HEAD_SIZE)
+        {
+            setError(431, "Request header too large");
+        }
 
-            _resurce = tmp; //main.http
+        return;
+    }
 
-            requestStr >> tmp; //читаем версию протокола
-            _protocol = tmp;      //HTTP/1.1
-            if (_protocol != "HTTP/1.1") {
-                _errorCode = 505; //Bad request
-                _errorMsg = "Protocol must be HTTP/1.1";
+    const auto head = buffer.substr(0, headEnd);
 
-                return;
-            }
+    //Строка запроса: METHOD /resource HTTP/1.1
+    const auto requestLineEnd = std::min(head.find(LINE_END), head.size());
+    const auto requestLine = head.substr(0, requestLineEnd);
 
-            requestStr.readLine(); //пропускаем строчку
+    const auto methodEnd = std::min(requestLine.find(' '), requestLine.size());
+    const auto method = requestLine.substr(0, methodEnd);
+    if (method == "GET")
+    {
+        _type = RequestType::GET;
+    }
+    else if (method == "POST")
+    {
+        _type = RequestType::POST;
+    }
+    else
+    {
+        setError(405, "Method must be POST"); //Bad request
 
-            //считываем заголовок
-            while (!requestStr.atEnd()) {
-                QString key = requestStr.readLine();
+        return;
+    }
 
-                if (key == "")
-                {
-                    break; //дальше идет тело запроса
-                }
+    const auto target = trimmed(requestLine.substr(std::min(methodEnd + 1, requestLine.size())));
+    const auto targetEnd = std::min(target.find(' '), target.size());
+    const auto resource = target.substr(0, targetEnd);
+    const auto protocol = trimmed(target.substr(targetEnd));
 
-                qsizetype pos = key.indexOf(":");
-                QString value = key.mid(pos + 2); //читаем строку до конца
+    const auto path = resource.substr(resource.starts_with('/') ? 1 : 0);
+    _resurce = QString::fromUtf8(path.data(), static_cast<qsizetype>(path.size())); //main.http
 
-                key.remove(pos, key.length() - pos);
+    _protocol = QString::fromLatin1(protocol.data(), static_cast<qsizetype>(protocol.size()));  //HTTP/1.1
+    if (protocol != "HTTP/1.1")
+    {
+        setError(505, "Protocol must be HTTP/1.1"); //Bad request
 
-                _header.insert(key, value);
-            }
+        return;
+    }
 
-            _expectedSize = _body.size();
+    //Поля заголовка запоминаются как смещения в буфере приема
+    _header.clear();
+    auto lineBegin = requestLineEnd + LINE_END.size();
+    while (lineBegin < head.size())
+    {
+        const auto lineEnd = std::min(head.find(LINE_END, lineBegin), head.size());
+        const auto line = head.substr(lineBegin, lineEnd - lineBegin);
+
+        const auto pos = line.find(':');
+        const auto name = pos != std::string_view::npos ? trimmed(line.substr(0, pos)) : std::string_view();
+        if (!name.empty())
+        {
+            const auto value = trimmed(line.substr(pos + 1));
+
+            HeaderField field;
+            field.nameBegin = name.data() - buffer.data();
+            field.nameSize = static_cast<qsizetype>(name.size());
+            field.valueBegin = value.data() - buffer.data();
+            field.valueSize = static_cast<qsizetype>(value.size());
+
+            _header.push_back(field);
+        }
 
-            //остальное записываем в тело запроса
-            _body.clear();
-            _body = requestStr.readAll().toUtf8(); //все остальное - тело запроса
+        lineBegin = lineEnd + LINE_END.size();
+    }
 
-            bool ok = false;
-            _lengthBody = header("Content-Length").toLongLong(&ok);
-            if (_type == RequestType::POST && !ok)
-            {
-                _errorCode = 411; //Bad request
-                _errorMsg = "Length Required";
+    _bodyBegin = static_cast<qsizetype>(headEnd + HEAD_END.size());
 
-                return;
-            }
+    const auto contentLength = headerView(QLatin1String("Content-Length"));
+    const auto lengthBody = parseInt64(contentLength);
+    if (_type == RequestType::POST && (!lengthBody.has_value() || lengthBody.value() < 0))
+    {
+        setError(411, "Length Required"); //Bad request
 
-            _expectedSize = _expectedSize - _body.size() + _lengthBody;
-            _headerParsed = true;
-        }
+        return;
     }
-    if (isComplite() && isGetHeader())
+
+    _lengthBody = std::max<qint64>(lengthBody.value_or(0), 0);
+    _state = State::BODY;
+}
+
+void HTTPRequest::setError(uint16_t code, const QString &msg)
+{
+    _state = State::ERROR;
+    _errorCode = code;
+    _errorMsg = msg;
+}
+
+QByteArrayView HTTPRequest::headerView(QLatin1String key) const noexcept
+{
+    for (const auto& field: _header)
     {
-        _errorCode = 200;
+        const QLatin1String name(_buffer.constData() + field.nameBegin, field.nameSize);
+        if (name.compare(key, Qt::CaseInsensitive) == 0)
+        {
+            return QByteArrayView(_buffer.constData() + field.valueBegin, field.valueSize);
+        }
     }
+
+    return QByteArrayView();
 }
 
 HTTPRequest::RequestType HTTPRequest::type() const noexcept
@@ -102,20 +175,21 @@ HTTPRequest::RequestType HTTPRequest::type() const noexcept
     return _type;
 }
 
-QByteArray HTTPRequest::body() const noexcept
+QByteArray HTTPRequest::body() const
 {
-    return _body;
+    if (_state != State::BODY && _state != State::COMPLETE)
+    {
+        return QByteArray();
+    }
+
+    return _buffer.mid(_bodyBegin, _lengthBody);
 }
 
 QString HTTPRequest::header(const QString& key) const
 {
-    const auto header_it = _header.find(key);
-    if (header_it == _header.end())
-    {
-        return QString();
-    }
+    const auto latin1Key = key.toLatin1();
 
-    return header_it.value();
+    return QString::fromUtf8(headerView(QLatin1String(latin1Key)));
 }
 
 QUrl HTTPRequest::resurce() const noexcept
@@ -146,12 +220,17 @@ QString HTTPRequest::errorMsg() const
 
 bool HTTPRequest::isComplite() const noexcept
 {
-    return (_body.size() >= _lengthBody);
+    return _state == State::COMPLETE;
 }
 
 bool HTTPRequest::isGetHeader() const noexcept
 {
-    return _headerParsed;
+    return _state == State::BODY || _state == State::COMPLETE;
+}
+
+bool HTTPRequest::isError() const noexcept
+{
+    return _state == State::ERROR;
 }
 
 qint64 HTTPRequest::size() const noexcept
@@ -161,6 +240,37 @@ qint64 HTTPRequest::size() const noexcept
 
 quint64 HTTPRequest::expectedSize() const  noexcept
 {
-    return _expectedSize;
+    if (!isGetHeader())
+    {
+        return 0;
+    }
+
+    return static_cast<quint64>(_bodyBegin + _lengthBody);
 }
 
+ContentEncoding HTTPRequest::acceptEncoding() const
+{
+    return acceptEncodingToContentEncoding(header("Accept-Encoding"));
+}
+
+bool HTTPRequest::isKeepAlive() const
+{
+    //В HTTP/1.1 соединение постоянное, если клиент явно не запросил его закрытие
+    const auto connection = headerView(QLatin1String("Connection"));
+
+    return !QLatin1String(connection.data(), connection.size()).contains(QLatin1String("close"), Qt::CaseInsensitive);
+}
+
+QByteArray HTTPRequest::takeTail()
+{
+    if (_state != State::COMPLETE)
+    {
+        return QByteArray();
+    }
+
+    const auto bodyEnd = _bodyBegin + _lengthBody;
+    auto tail = _buffer.mid(bodyEnd);
+    _buffer.truncate(bodyEnd);
+
+    return tail;
+}
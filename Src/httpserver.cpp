@@ -1,13 +1,20 @@
+//STL
+#include <algorithm>
+
+//Qt
+#include <QThread>
+
 #include "TradingCatCommon/httpserver.h"
 
 using namespace TradingCatCommon;
 
-static const quint32 MAX_CONNETIONS = 100;
-
-HttpServer::HttpServer(const HTTPServerConfig &serverConfig, const TradingCatCommon::TradingData& data, QObject *parent /* = nullptr */)
-    : QTcpServer(parent)
+HttpServer::HttpServer(const HTTPServerConfig &serverConfig, const TradingCatCommon::TradingData& data,
+                       PushChannel* pushChannel /* = nullptr */, QObject *parent /* = nullptr */)
+    : QObject(parent)
+    , _admissionControl(std::make_unique<AdmissionControl>(serverConfig.admission))
     , _serverConfig(serverConfig)
     , _data(data)
+    , _pushChannel(pushChannel)
 {
 }
 
@@ -16,75 +23,62 @@ HttpServer::~HttpServer()
     stop();
 }
 
-void HttpServer::incomingConnection(qintptr handle)
+quint32 HttpServer::reactorCount() const
 {
-    if (_freeConnections.size() == 0)
+    if (_serverConfig.threadCount > 0)
     {
-         emit sendLogMsg(Common::TDBLoger::MSG_CODE::WARNING_CODE, QString("Too many connetions: %1").arg(MAX_CONNETIONS));
-
-         auto tcpSocket = new QTcpSocket();
-         tcpSocket->setSocketDescriptor(handle);
-
-         QByteArray answer = "HTTP/1.1 429 Too Many Requests\r\nContent-Length:17\r\n\r\nToo Many Requests";
-
-         tcpSocket->write(answer, answer.size());
-         tcpSocket->waitForBytesWritten();
-         tcpSocket->disconnectFromHost();
-
-         return;
+        return _serverConfig.threadCount;
     }
 
-    const auto p_connection = _freeConnections.front();
-
-    _freeConnections.pop();
-
-    emit startSocket(p_connection->socket->id(), handle);
+    return static_cast<quint32>(std::max(QThread::idealThreadCount(), 1));
 }
 
-void HttpServer::HttpServer::start()
+void HttpServer::start()
 {
-    // for (quint32 i = 0; i < MAX_CONNETIONS; ++i)
-    // {
-    //     Connection tmp;
-
-    //     tmp.thread = std::make_unique<Thread>(i); //создаем поток
-    //     tmp.socket = std::make_unique<SocketThread>(i, _serverConfig, _data); //создаем класс обработчика соединения
-
-    //     tmp.socket->moveToThread(tmp.thread.get()); //перемещаем обработчик в отдельный поток
+    if (_isStarted)
+    {
+        return;
+    }
 
-    //     //запускаем обработку стазу после создания потока
-    //     QObject::connect(tmp.thread.get(), SIGNAL(started(quint64)), SLOT(startedSocket(quint64)), Qt::QueuedConnection);
+    const auto count = reactorCount();
+    const auto maxConnections = std::max<quint64>(_serverConfig.maxUsers / count, 1);
 
+    _metrics = std::make_unique<ServerMetrics>(SocketThread::metricsRoutes(), count);
 
-    //     //log
-    //     QObject::connect(tmp.socket.get(), SIGNAL(sendLogMsg(Common::TDBLoger::MSG_CODE, const QString&)),
-    //                  SLOT(sendLogMsgSocket(Common::TDBLoger::MSG_CODE, const QString&)), Qt::QueuedConnection);
+    _reactors.reserve(count);
+    for (quint32 i = 0; i < count; ++i)
+    {
+        Reactor tmp;
 
-    //     //Ставим поток на удаление когда завершили работы
-    //     QObject::connect(tmp.socket.get(), SIGNAL(finished()), tmp.thread.get(), SLOT(quit()), Qt::DirectConnection);
+        tmp.thread = std::make_unique<Thread>(i); //создаем поток
+        tmp.reactor = std::make_unique<HTTPReactor>(i, _serverConfig, _data, maxConnections, _admissionControl.get(), _pushChannel,
+                                                     &_metrics->threadMetrics(i)); //создаем реактор
 
-    //     //тормозим поток при отключении сервера
-    //     QObject::connect(this, SIGNAL(stopAll()), tmp.socket.get(), SLOT(stop()), Qt::QueuedConnection);
+        tmp.reactor->moveToThread(tmp.thread.get()); //перемещаем реактор в отдельный поток
 
+        //запускаем прием соединений сразу после старта потока
+        QObject::connect(tmp.thread.get(), SIGNAL(started()), tmp.reactor.get(), SLOT(start()));
 
+        //log
+        QObject::connect(tmp.reactor.get(), SIGNAL(sendLogMsg(Common::MSG_CODE, const QString&)),
+                         SLOT(sendLogMsgReactor(Common::MSG_CODE, const QString&)), Qt::QueuedConnection);
+        QObject::connect(tmp.reactor.get(), SIGNAL(errorOccurred(Common::EXIT_CODE, const QString&)),
+                         SLOT(errorOccurredReactor(Common::EXIT_CODE, const QString&)), Qt::QueuedConnection);
+        QObject::connect(tmp.reactor.get(), SIGNAL(started(quint64)), SLOT(startedReactor(quint64)), Qt::QueuedConnection);
 
-    //     //запускаем поток на выполнение
-    //     const auto p_thread = tmp.thread.get();
+        //завершаем поток когда реактор остановлен
+        QObject::connect(tmp.reactor.get(), SIGNAL(finished(quint64)), tmp.thread.get(), SLOT(quit()), Qt::DirectConnection);
 
-    //     _poolConnections.emplace(i, std::move(tmp));
+        //тормозим реактор при отключении сервера
+        QObject::connect(this, SIGNAL(stopAll()), tmp.reactor.get(), SLOT(stop()), Qt::QueuedConnection);
 
-    //     p_thread->start(QThread::NormalPriority);
-    // }
+        //запускаем поток на выполнение
+        tmp.thread->start(QThread::NormalPriority);
 
-    // if (listen(_serverConfig.address, _serverConfig.port))
-    // {
-    //     emit sendLogMsg(Common::TDBLoger::MSG_CODE::INFORMATION_CODE, QString("The server was listening on %1:%2").arg(_serverConfig.address.toString()).arg(_serverConfig.port));
-    // }
-    // else
-    // {
-    //     emit errorOccurred(Common::EXIT_CODE::SERVICE_START_ERR, QString("Error listening server on %1:%2").arg(_serverConfig.address.toString()).arg(_serverConfig.port));
-    // }
+        _reactors.emplace_back(std::move(tmp));
+    }
 
+    _listeningCount = 0;
     _isStarted = true;
 }
 
@@ -95,45 +89,50 @@ void HttpServer::stop()
         return;
     }
 
-    close(); //Закрываем все соединения
-
-    emit stopAll(); //тормозим все потоки
+    emit stopAll(); //тормозим все реакторы
 
-    for (const auto& connection: _poolConnections)
+    for (const auto& reactor: _reactors)
     {
-        connection.second->thread->wait();
+        reactor.thread->wait();
     }
 
-    _poolConnections.clear();
+    _reactors.clear();
+
+    _listeningCount = 0;
+    _isStarted = false;
 
     emit sendLogMsg(Common::TDBLoger::MSG_CODE::INFORMATION_CODE,  "Server is stoped succesfull");
 
     emit finished();
 }
 
-void HttpServer::startedConnecton(quint64 id)
+void HttpServer::sendLogMsgReactor(Common::TDBLoger::MSG_CODE category, const QString &msg)
 {
-
+    emit sendLogMsg(category, msg);
 }
 
-// void HttpServer::startedSocket(quint64 id)
-// {
-//     const auto connections_it = _poolConnections.find(id);
-//     Q_ASSERT(connections_it != _poolConnections.end());
-
-//     _freeConnections.push(connections_it->second.get());
-// }
-
-void HttpServer::sendLogMsgSocket(Common::TDBLoger::MSG_CODE category, const QString &msg)
+void HttpServer::errorOccurredReactor(Common::EXIT_CODE errorCode, const QString &errorString)
 {
-    emit sendLogMsg(category, msg);
+    emit errorOccurred(errorCode, errorString);
 }
 
-void HttpServer::finishedSocket(quint64 id)
+void HttpServer::startedReactor(quint64 id)
 {
-    const auto connections_it = _busyConnections.find(id);
-    Q_ASSERT(connections_it != _busyConnections.end());
+    Q_UNUSED(id);
 
-    _freeConnections.push(connections_it->second);
-}
+    //Сервер считается запущенным только когда все реакторы слушают порт. Ошибка запуска реактора приходит через errorOccurred
+    if (!_isStarted || ++_listeningCount != _reactors.size())
+    {
+        return;
+    }
 
+    const auto count = reactorCount();
+
+    emit sendLogMsg(Common::TDBLoger::MSG_CODE::INFORMATION_CODE, QString("The server was started on %1:%2. Reactors: %3. Max connections per reactor: %4")
+                                                                     .arg(_serverConfig.address.toString())
+                                                                     .arg(_serverConfig.port)
+                                                                     .arg(count)
+                                                                     .arg(std::max<quint64>(_serverConfig.maxUsers / count, 1)));
+
+    emit started();
+}
@@ -0,0 +1,476 @@
+//STL
+#include <charconv>
+#include <cmath>
+#include <cstring>
+
+//My
+#include <Common/parser.h>
+
+#include "TradingCatCommon/numberformat.h"
+
+#include "TradingCatCommon/jsonreader.h"
+
+using namespace TradingCatCommon;
+using namespace Common;
+
+static bool isNumberChar(char ch) noexcept
+{
+    return (ch >= '0' && ch <= '9') || ch == '-' || ch == '+' || ch == '.' || ch == 'e' || ch == 'E';
+}
+
+static void appendUtf8(QByteArray& buffer, char32_t codePoint)
+{
+    if (codePoint < 0x80)
+    {
+        buffer.append(static_cast<char>(codePoint));
+    }
+    else if (codePoint < 0x800)
+    {
+        buffer.append(static_cast<char>(0xc0 | (codePoint >> 6)));
+        buffer.append(static_cast<char>(0x80 | (codePoint & 0x3f)));
+    }
+    else if (codePoint < 0x10000)
+    {
+        buffer.append(static_cast<char>(0xe0 | (codePoint >> 12)));
+        buffer.append(static_cast<char>(0x80 | ((codePoint >> 6) & 0x3f)));
+        buffer.append(static_cast<char>(0x80 | (codePoint & 0x3f)));
+    }
+    else
+    {
+        buffer.append(static_cast<char>(0xf0 | (codePoint >> 18)));
+        buffer.append(static_cast<char>(0x80 | ((codePoint >> 12) & 0x3f)));
+        buffer.append(static_cast<char>(0x80 | ((codePoint >> 6) & 0x3f)));
+        buffer.append(static_cast<char>(0x80 | (codePoint & 0x3f)));
+    }
+}
+
+JsonReader::JsonReader(QByteArrayView json, const QString& rootPath /* = QString("Root") */)
+    : _begin(json.data())
+    , _pos(json.data())
+    , _end(json.data() + json.size())
+    , _rootPath(rootPath)
+{
+    _levels.reserve(8);
+}
+
+void JsonReader::beginObject()
+{
+    expect('{');
+
+    _levels.push_back({false, true, -1, {}});
+}
+
+bool JsonReader::nextKey()
+{
+    Q_ASSERT(!_levels.empty() && !_levels.back().isArray);
+
+    auto& level = _levels.back();
+
+    if (peek() == '}')
+    {
+        ++_pos;
+        _levels.pop_back();
+
+        return false;
+    }
+
+    if (!level.isFirst)
+    {
+        expect(',');
+    }
+    level.isFirst = false;
+
+    if (peek() != '"')
+    {
+        error("Object key expected");
+    }
+
+    level.key = readRawString(_keyBuffer);
+
+    expect(':');
+
+    return true;
+}
+
+QByteArrayView JsonReader::key() const noexcept
+{
+    Q_ASSERT(!_levels.empty() && !_levels.back().isArray);
+
+    return _levels.back().key;
+}
+
+void JsonReader::beginArray()
+{
+    expect('[');
+
+    _levels.push_back({true, true, -1, {}});
+}
+
+bool JsonReader::nextElement()
+{
+    Q_ASSERT(!_levels.empty() && _levels.back().isArray);
+
+    auto& level = _levels.back();
+
+    if (peek() == ']')
+    {
+        ++_pos;
+        _levels.pop_back();
+
+        return false;
+    }
+
+    if (!level.isFirst)
+    {
+        expect(',');
+    }
+    level.isFirst = false;
+
+    ++level.index;
+
+    return true;
+}
+
+JsonReader::ValueType JsonReader::nextValueType()
+{
+    switch (peek())
+    {
+    case '{': return ValueType::OBJECT;
+    case '[': return ValueType::ARRAY;
+    case '"': return ValueType::STRING;
+    case 't':
+    case 'f': return ValueType::BOOL;
+    case 'n': return ValueType::NULL_VALUE;
+    default:
+        break;
+    }
+
+    return ValueType::NUMBER;
+}
+
+QString JsonReader::readString()
+{
+    if (peek() != '"')
+    {
+        error("String value expected");
+    }
+
+    QByteArray buffer;
+    const auto str = readRawString(buffer);
+
+    return QString::fromUtf8(str);
+}
+
+double JsonReader::readDouble()
+{
+    const auto number = readNumberView();
+
+    const auto result = parseDouble(number);
+    if (!result.has_value())
+    {
+        error(QString("Incorrect number value: %1").arg(QString::fromLatin1(number)));
+    }
+
+    return result.value();
+}
+
+float JsonReader::readFloat()
+{
+    return static_cast<float>(readDouble());
+}
+
+qint64 JsonReader::readInt64()
+{
+    const auto number = readNumberView();
+
+    const auto result = parseInt64(number);
+    if (result.has_value())
+    {
+        return result.value();
+    }
+
+    //Целое число может быть записано в экспоненциальной форме
+    const auto doubleResult = parseDouble(number);
+    if (!doubleResult.has_value() ||
+        std::trunc(doubleResult.value()) != doubleResult.value() || std::abs(doubleResult.value()) > 9007199254740992.0)
+    {
+        error(QString("Incorrect integer value: %1").arg(QString::fromLatin1(number)));
+    }
+
+    return static_cast<qint64>(doubleResult.value());
+}
+
+bool JsonReader::readBool()
+{
+    const auto ch = peek();
+    if (ch == 't' && _end - _pos >= 4 && std::memcmp(_pos, "true", 4) == 0)
+    {
+        _pos += 4;
+
+        return true;
+    }
+    if (ch == 'f' && _end - _pos >= 5 && std::memcmp(_pos, "false", 5) == 0)
+    {
+        _pos += 5;
+
+        return false;
+    }
+
+    error("Boolean value expected");
+}
+
+bool JsonReader::readNull()
+{
+    if (peek() != 'n')
+    {
+        return false;
+    }
+
+    if (_end - _pos < 4 || std::memcmp(_pos, "null", 4) != 0)
+    {
+        error("Null value expected");
+    }
+
+    _pos += 4;
+
+    return true;
+}
+
+void JsonReader::skipValue()
+{
+    switch (peek())
+    {
+    case '{':
+        beginObject();
+        while (nextKey())
+        {
+            skipValue();
+        }
+        break;
+    case '[':
+        beginArray();
+        while (nextElement())
+        {
+            skipValue();
+        }
+        break;
+    case '"':
+    {
+        QByteArray buffer;
+        readRawString(buffer);
+        break;
+    }
+    case 't':
+    case 'f':
+        readBool();
+        break;
+    case 'n':
+        readNull();
+        break;
+    default:
+        readNumberView();
+    }
+}
+
+void JsonReader::end()
+{
+    skipWhitespace();
+
+    if (_pos != _end)
+    {
+        error("Unexpected data after root value");
+    }
+}
+
+void JsonReader::error(const QString &msg) const
+{
+    throw ParseException(QString("Error parsing %1 (offset %2): %3").arg(path()).arg(_pos - _begin).arg(msg));
+}
+
+void JsonReader::skipWhitespace() noexcept
+{
+    while (_pos != _end && (*_pos == ' ' || *_pos == '\n' || *_pos == '\r' || *_pos == '\t'))
+    {
+        ++_pos;
+    }
+}
+
+char JsonReader::peek()
+{
+    skipWhitespace();
+
+    if (_pos == _end)
+    {
+        error("Unexpected end of data");
+    }
+
+    return *_pos;
+}
+
+void JsonReader::expect(char ch)
+{
+    if (peek() != ch)
+    {
+        error(QString("'%1' expected").arg(ch));
+    }
+
+    ++_pos;
+}
+
+QByteArrayView JsonReader::readNumberView()
+{
+    skipWhitespace();
+
+    const auto begin = _pos;
+    while (_pos != _end && isNumberChar(*_pos))
+    {
+        ++_pos;
+    }
+
+    if (_pos == begin)
+    {
+        error("Number value expected");
+    }
+
+    return QByteArrayView(begin, _pos);
+}
+
+QByteArrayView JsonReader::readRawString(QByteArray& buffer)
+{
+    Q_ASSERT(_pos != _end && *_pos == '"');
+
+    ++_pos;
+    const auto begin = _pos;
+
+    //Строки без экранирования возвращаем без копирования
+    while (_pos != _end && *_pos != '"' && *_pos != '\\')
+    {
+        if (static_cast<uchar>(*_pos) < 0x20)
+        {
+            error("Control character in string");
+        }
+        ++_pos;
+    }
+
+    if (_pos == _end)
+    {
+        error("Unterminated string");
+    }
+
+    if (*_pos == '"')
+    {
+        return QByteArrayView(begin, _pos++);
+    }
+
+    buffer.clear();
+    buffer.append(begin, _pos - begin);
+
+    while (true)
+    {
+        if (_pos == _end)
+        {
+            error("Unterminated string");
+        }
+
+        const auto ch = *_pos++;
+        if (ch == '"')
+        {
+            break;
+        }
+
+        if (static_cast<uchar>(ch) < 0x20)
+        {
+            error("Control character in string");
+        }
+
+        if (ch != '\\')
+        {
+            buffer.append(ch);
+
+            continue;
+        }
+
+        if (_pos == _end)
+        {
+            error("Unterminated string");
+        }
+
+        switch (*_pos++)
+        {
+        case '"': buffer.append('"'); break;
+        case '\\': buffer.append('\\'); break;
+        case '/': buffer.append('/'); break;
+        case 'b': buffer.append('\b'); break;
+        case 'f': buffer.append('\f'); break;
+        case 'n': buffer.append('\n'); break;
+        case 'r': buffer.append('\r'); break;
+        case 't': buffer.append('\t'); break;
+        case 'u':
+        {
+            const auto readCodeUnit = [this]()
+            {
+                if (_end - _pos < 4)
+                {
+                    error("Incorrect unicode escape sequence");
+                }
+
+                unsigned int result = 0;
+                const auto [ptr, ec] = std::from_chars(_pos, _pos + 4, result, 16);
+                if (ec != std::errc() || ptr != _pos + 4)
+                {
+                    error("Incorrect unicode escape sequence");
+                }
+                _pos += 4;
+
+                return static_cast<char16_t>(result);
+            };
+
+            char32_t codePoint = readCodeUnit();
+            if (QChar::isHighSurrogate(codePoint))
+            {
+                if (_end - _pos >= 6 && _pos[0] == '\\' && _pos[1] == 'u')
+                {
+                    _pos += 2;
+                    const auto low = readCodeUnit();
+                    codePoint = QChar::isLowSurrogate(low) ? QChar::surrogateToUcs4(static_cast<char16_t>(codePoint), low) : QChar::ReplacementCharacter;
+                }
+                else
+                {
+                    codePoint = QChar::ReplacementCharacter;
+                }
+            }
+            else if (QChar::isLowSurrogate(codePoint))
+            {
+                codePoint = QChar::ReplacementCharacter;
+            }
+
+            appendUtf8(buffer, codePoint);
+            break;
+        }
+        default:
+            error("Incorrect escape sequence");
+        }
+    }
+
+    return QByteArrayView(buffer);
+}
+
+QString JsonReader::path() const
+{
+    QString result(_rootPath);
+
+    for (const auto& level: _levels)
+    {
+        if (level.isArray)
+        {
+            result += QString("/[%1]").arg(level.index);
+        }
+        else
+        {
+            result += '/';
+            result += QString::fromUtf8(level.key);
+        }
+    }
+
+    return result;
+}
@@ -0,0 +1,248 @@
+//STL
+#include <cmath>
+
+//My
+#include "TradingCatCommon/numberformat.h"
+
+#include "TradingCatCommon/jsonwriter.h"
+
+using namespace TradingCatCommon;
+
+static const char HEX_DIGITS[] = "0123456789abcdef";
+
+JsonWriter::JsonWriter(QByteArray &buffer, Options options /* = Options() */)
+    : _buffer(buffer)
+    , _options(options)
+{
+    _isFirst.reserve(8);
+}
+
+void JsonWriter::beginObject()
+{
+    separator();
+
+    _buffer.append('{');
+    _isFirst.push_back(true);
+}
+
+void JsonWriter::endObject()
+{
+    Q_ASSERT(!_isFirst.empty());
+    Q_ASSERT(!_isAfterKey);
+
+    _buffer.append('}');
+    _isFirst.pop_back();
+}
+
+void JsonWriter::beginArray()
+{
+    separator();
+
+    _buffer.append('[');
+    _isFirst.push_back(true);
+}
+
+void JsonWriter::endArray()
+{
+    Q_ASSERT(!_isFirst.empty());
+    Q_ASSERT(!_isAfterKey);
+
+    _buffer.append(']');
+    _isFirst.pop_back();
+}
+
+void JsonWriter::key(QByteArrayView key)
+{
+    Q_ASSERT(!_isFirst.empty());
+    Q_ASSERT(!_isAfterKey);
+
+    separator();
+
+    _buffer.append('"');
+    _buffer.append(key);
+    _buffer.append("\":", 2);
+
+    _isAfterKey = true;
+}
+
+void JsonWriter::value(const QString &value)
+{
+    separator();
+
+    _buffer.append('"');
+    appendEscapedString(_buffer, value);
+    _buffer.append('"');
+}
+
+void JsonWriter::value(double value)
+{
+    separator();
+
+    //QJsonDocument записывает нечисловые значения как null
+    if (!std::isfinite(value))
+    {
+        _buffer.append("null", 4);
+
+        return;
+    }
+
+    appendNumber(_buffer, value);
+}
+
+void JsonWriter::value(float value)
+{
+    separator();
+
+    if (!std::isfinite(value))
+    {
+        _buffer.append("null", 4);
+
+        return;
+    }
+
+    //Кратчайшее представление с точностью float. При чтении в float значение восстанавливается без потерь
+    appendNumber(_buffer, value);
+}
+
+void JsonWriter::value(qint64 value)
+{
+    separator();
+
+    appendNumber(_buffer, value);
+}
+
+void JsonWriter::value(int value)
+{
+    this->value(static_cast<qint64>(value));
+}
+
+void JsonWriter::value(bool value)
+{
+    separator();
+
+    if (value)
+    {
+        _buffer.append("true", 4);
+    }
+    else
+    {
+        _buffer.append("false", 5);
+    }
+}
+
+void JsonWriter::nullValue()
+{
+    separator();
+
+    _buffer.append("null", 4);
+}
+
+void JsonWriter::rawValue(QByteArrayView json)
+{
+    Q_ASSERT(!json.isEmpty());
+
+    separator();
+
+    _buffer.append(json);
+}
+
+QByteArray &JsonWriter::buffer() noexcept
+{
+    return _buffer;
+}
+
+JsonWriter::Options JsonWriter::options() const noexcept
+{
+    return _options;
+}
+
+void JsonWriter::appendEscapedString(QByteArray &buffer, QStringView str)
+{
+    const auto begin = str.begin();
+    const auto end = str.end();
+    auto it_str = begin;
+
+    while (it_str != end)
+    {
+        const char16_t u = it_str->unicode();
+
+        //Символы вне ASCII копируем в UTF-8 целыми участками
+        if (u >= 0x80)
+        {
+            auto it_end = it_str;
+            while (it_end != end && it_end->unicode() >= 0x80)
+            {
+                ++it_end;
+            }
+
+            buffer.append(QStringView(it_str, it_end).toUtf8());
+            it_str = it_end;
+
+            continue;
+        }
+
+        if (u >= 0x20 && u != u'"' && u != u'\\')
+        {
+            buffer.append(static_cast<char>(u));
+            ++it_str;
+
+            continue;
+        }
+
+        buffer.append('\\');
+        switch (u)
+        {
+        case u'"':
+            buffer.append('"');
+            break;
+        case u'\\':
+            buffer.append('\\');
+            break;
+        case u'\b':
+            buffer.append('b');
+            break;
+        case u'\f':
+            buffer.append('f');
+            break;
+        case u'\n':
+            buffer.append('n');
+            break;
+        case u'\r':
+            buffer.append('r');
+            break;
+        case u'\t':
+            buffer.append('t');
+            break;
+        default:
+            buffer.append("u00", 3);
+            buffer.append(HEX_DIGITS[u >> 4]);
+            buffer.append(HEX_DIGITS[u & 0xf]);
+        }
+
+        ++it_str;
+    }
+}
+
+void JsonWriter::separator()
+{
+    if (_isAfterKey)
+    {
+        _isAfterKey = false;
+
+        return;
+    }
+
+    if (_isFirst.empty())
+    {
+        return;
+    }
+
+    if (_isFirst.back())
+    {
+        _isFirst.back() = false;
+    }
+    else
+    {
+        _buffer.append(',');
+    }
+}
@@ -5,6 +5,8 @@
 //My
 #include <Common/common.h>
 
+#include "TradingCatCommon/numberformat.h"
+
 #include "TradingCatCommon/kline.h"
 
 using namespace TradingCatCommon;
@@ -269,18 +271,71 @@ const QString &KLine::toString() const
             .arg(id.toString())
             .arg(QDateTime::fromMSecsSinceEpoch(openTime).toString(DATETIME_FORMAT))
             .arg(QDateTime::fromMSecsSinceEpoch(closeTime).toString(DATETIME_FORMAT))
-            .arg(high)
-            .arg(open)
-            .arg(close)
-            .arg(low)
-            .arg(volume)
-            .arg(quoteAssetVolume);
+            .arg(generalNumberToString(high))
+            .arg(generalNumberToString(open))
+            .arg(generalNumberToString(close))
+            .arg(generalNumberToString(low))
+            .arg(generalNumberToString(volume))
+            .arg(generalNumberToString(quoteAssetVolume));
     }
 
     return _data.value();
 }
 
 
+QByteArray KLine::serialized(SerializedFormat format, const std::function<QByteArray()>& make) const
+{
+    switch (format)
+    {
+    case SerializedFormat::JSON: return _json.get(make);
+    case SerializedFormat::BINARY: return _binary.get(make);
+    default:
+        Q_ASSERT(false);
+    }
+
+    return _json.get(make);
+}
+
+SerializedCache::SerializedCache(const SerializedCache &cache) noexcept
+{
+    Q_UNUSED(cache);
+}
+
+SerializedCache &SerializedCache::operator=(const SerializedCache &cache) noexcept
+{
+    //Новые данные должны сериализоваться заново
+    if (this != &cache)
+    {
+        clear();
+    }
+
+    return *this;
+}
+
+QByteArray SerializedCache::get(const std::function<QByteArray()>& make) const
+{
+    auto data = _data.load(std::memory_order_acquire);
+    if (data)
+    {
+        return *data;
+    }
+
+    //Несколько потоков могут сформировать значение одновременно. Сохраняется первое, остальные удаляются
+    auto newData = std::make_shared<const QByteArray>(make());
+    if (_data.compare_exchange_strong(data, newData, std::memory_order_acq_rel, std::memory_order_acquire))
+    {
+        return *newData;
+    }
+
+    return *data;
+}
+
+void SerializedCache::clear() noexcept
+{
+    //Буфер освобождается вместе с последней ссылкой. Потоки, уже получившие значение, продолжают работать с ним
+    _data.store(nullptr, std::memory_order_release);
+}
+
 QString TradingCatCommon::klineTypesToString(const KLineTypes &types)
 {
     QStringList result;
@@ -0,0 +1,209 @@
+//STL
+#include <algorithm>
+
+#include "TradingCatCommon/klinescache.h"
+
+using namespace TradingCatCommon;
+
+size_t KLinesCache::SeriesKeyHash::operator()(const SeriesKey& key) const noexcept
+{
+    return std::hash<StockExchangeID>()(key.stockExchangeId) ^ (std::hash<KLineID>()(key.klineId) << 1);
+}
+
+KLinesCache::KLinesCache(qsizetype maxKLines, qsizetype maxSeries)
+    : _maxKLines(maxKLines)
+    , _maxSeries(maxSeries)
+{
+    Q_ASSERT(_maxKLines > 0);
+    Q_ASSERT(_maxSeries > 0);
+}
+
+void KLinesCache::addKLines(const StockExchangeID& stockExchangeId, const PKLinesList& klines)
+{
+    Q_ASSERT(!stockExchangeId.isEmpty());
+    Q_CHECK_PTR(klines);
+
+    for (const auto& kline: *klines)
+    {
+        auto& series = this->series({stockExchangeId, kline->id});
+
+        series.klines.insert_or_assign(kline->closeTime, kline);
+
+        //Свеча после пропуска начинает новый интервал полных данных
+        mergeCovered(series, {kline->closeTime, kline->closeTime}, static_cast<qint64>(kline->id.type));
+
+        trim(series);
+    }
+}
+
+void KLinesCache::addHistory(const StockExchangeID& stockExchangeId, const KLineID& klineId, qint64 start, const PKLinesList& klines)
+{
+    Q_ASSERT(!stockExchangeId.isEmpty());
+    Q_ASSERT(!klineId.isEmpty());
+    Q_CHECK_PTR(klines);
+
+    if (klines->empty())
+    {
+        return;
+    }
+
+    auto& series = this->series({stockExchangeId, klineId});
+
+    qint64 lastCloseTime = start;
+    for (const auto& kline: *klines)
+    {
+        series.klines.insert_or_assign(kline->closeTime, kline);
+        lastCloseTime = std::max(lastCloseTime, kline->closeTime);
+    }
+
+    //Свечи, закрывшиеся после последней полученной, сервер мог еще не опубликовать
+    mergeCovered(series, {start, lastCloseTime}, static_cast<qint64>(klineId.type));
+
+    trim(series);
+}
+
+std::optional<KLinesCache::Range> KLinesCache::missingRange(const StockExchangeID& stockExchangeId, const KLineID& klineId,
+                                                            qint64 start, qint64 end, qint64 now) const
+{
+    Q_ASSERT(start <= end);
+
+    const auto it_series = _series.find({stockExchangeId, klineId});
+    if (it_series == _series.end() || !it_series->second.covered.has_value())
+    {
+        return Range{start, end};
+    }
+
+    const auto& covered = it_series->second.covered.value();
+    const auto period = static_cast<qint64>(klineId.type);
+
+    //Нет пропуска в конце интервала, если следующая за полными данными свеча закроется позже now (или конца интервала)
+    const bool isEndCovered = covered.end + period > std::min(end, now);
+    const bool isStartCovered = covered.start <= start;
+
+    if (isStartCovered && isEndCovered)
+    {
+        return std::nullopt;
+    }
+
+    if (isStartCovered && covered.end >= start)
+    {
+        return Range{covered.end + 1, end};
+    }
+
+    if (isEndCovered && covered.start <= end)
+    {
+        return Range{start, covered.start - 1};
+    }
+
+    return Range{start, end};
+}
+
+PKLinesList KLinesCache::getKLines(const StockExchangeID& stockExchangeId, const KLineID& klineId, qint64 start, qint64 end)
+{
+    Q_ASSERT(start <= end);
+
+    auto result = std::make_shared<KLinesList>();
+
+    const auto it_series = _series.find({stockExchangeId, klineId});
+    if (it_series == _series.end())
+    {
+        return result;
+    }
+
+    auto& series = this->series(it_series->first);
+
+    //Порядок как в ответе сервера - от новых свечей к старым
+    const auto it_klinesBegin = series.klines.lower_bound(start);
+    for (auto it_klines = series.klines.upper_bound(end); it_klines != it_klinesBegin; )
+    {
+        --it_klines;
+        result->push_back(it_klines->second);
+    }
+
+    return result;
+}
+
+void KLinesCache::clear()
+{
+    _series.clear();
+    _usage.clear();
+}
+
+KLinesCache::Series& KLinesCache::series(const SeriesKey& key)
+{
+    auto it_series = _series.find(key);
+    if (it_series != _series.end())
+    {
+        auto& series = it_series->second;
+        _usage.splice(_usage.begin(), _usage, series.usage);
+
+        return series;
+    }
+
+    //Удаляем серию, к которой дольше всего не обращались
+    if (static_cast<qsizetype>(_series.size()) >= _maxSeries)
+    {
+        _series.erase(_usage.back());
+        _usage.pop_back();
+    }
+
+    _usage.push_front(key);
+
+    auto& series = _series[key];
+    series.usage = _usage.begin();
+
+    return series;
+}
+
+void KLinesCache::mergeCovered(Series& series, const Range& range, qint64 period)
+{
+    Q_ASSERT(range.start <= range.end);
+    Q_ASSERT(period > 0);
+
+    if (!series.covered.has_value())
+    {
+        series.covered = range;
+
+        return;
+    }
+
+    auto& covered = series.covered.value();
+
+    //Интервалы пересекаются или соседние свечи попадают в разные интервалы
+    if (range.start <= covered.end + period && range.end + period >= covered.start)
+    {
+        covered.start = std::min(covered.start, range.start);
+        covered.end = std::max(covered.end, range.end);
+
+        return;
+    }
+
+    if (range.end > covered.end)
+    {
+        covered = range;
+    }
+}
+
+void KLinesCache::trim(Series& series) const
+{
+    if (static_cast<qsizetype>(series.klines.size()) <= _maxKLines)
+    {
+        return;
+    }
+
+    while (static_cast<qsizetype>(series.klines.size()) > _maxKLines)
+    {
+        series.klines.erase(series.klines.begin());
+    }
+
+    //Удаленные свечи больше не входят в интервал полных данных
+    if (series.covered.has_value())
+    {
+        auto& covered = series.covered.value();
+        covered.start = std::max(covered.start, series.klines.begin()->first);
+        if (covered.start > covered.end)
+        {
+            series.covered.reset();
+        }
+    }
+}
@@ -77,6 +77,38 @@ PKLinesList KLinesDataContainer::getKLinesOnDate(const StockExchangeID &stockExc
     return result;
 }
 
+PKLinesList KLinesDataContainer::getKLinesOnDate(const StockExchangeID &stockExchangeId, const KLineID &klineId, qint64 start, qint64 end, qsizetype maxCount) const
+{
+    Q_ASSERT(!stockExchangeId.isEmpty());
+    Q_ASSERT(!klineId.isEmpty());
+    Q_ASSERT(start <= end);
+    Q_ASSERT(maxCount > 0);
+
+    const auto moneyHash = hash(stockExchangeId, klineId.symbol.name);
+    const auto& moneyData = _klinesData.at(moneyHash);
+
+    auto result = std::make_shared<KLinesList>();
+
+    QMutexLocker<QMutex> moneyDataLocker(&moneyData.mutex);
+
+    const auto& klines = moneyData.klines;
+    const auto it_klines = klines.find(klineId);
+    if (it_klines == klines.end())
+    {
+        return result;
+    }
+
+    //Свечи хранятся в порядке убывания времени, поэтому копируем только начало периода не вычисляя его размер
+    const auto& klineMap = it_klines->second;
+    const auto it_klineMapEnd = klineMap.upper_bound(start);
+    for (auto it_klineMap = klineMap.lower_bound(end); it_klineMap != it_klineMapEnd && result->size() < static_cast<size_t>(maxCount); ++it_klineMap)
+    {
+        result->push_back(it_klineMap->second);
+    }
+
+    return result;
+}
+
 const TradingCatCommon::StockExchangesIDList& KLinesDataContainer::getStockExcangeList() const noexcept
 {
     return _stockExchangesIdList;
@@ -1,6 +1,13 @@
 ///STL
 #include <vector>
 #include <algorithm>
+#include <numeric>
+#include <cmath>
+
+//Qt
+#include <QThread>
+#include <QMutexLocker>
+#include <QDebug>
 
 #include "TradingCatCommon/natr.h"
 
@@ -8,41 +15,57 @@ using namespace TradingCatCommon;
 
 static const quint64 MIN_SIZE_FOR_CALCULATE = 10u; ///< Минимальное колиесов свечей для расчета НАТРа
 static const qint64 MAX_SAVE_NATR = 1000u;  ///<Количество интервалов свечи, когда расчитанный НАТР являться актуальным
+static const qint64 RECALCULATE_NATR = 10u; ///< Количество интервалов свечи, после которого НАТР пересчитывается в фоне
+static const qint64 NATR_KLINES_COUNT = 300u; ///< Количество свечей используемых для пересчета НАТРа
+static const quint32 SCHEDULE_BATCH_SIZE = 256u; ///< Количество серий в одной пачке пересчета
+static const quint64 SCHEDULE_INTERVAL = 5u * 1000u; ///< Интервал просмотра таблицы НАТРов (мсек)
 
-Natr::Natr(const TradingCatCommon::PKLinesList &klines)
+///////////////////////////////////////////////////////////////////////////////
+///     class Natr
+///
+void Natr::reset(const StockExchangeID &stockExchangeId, const KLineID &klineId)
 {
-    calculate(klines);
+    Q_ASSERT(!stockExchangeId.isEmpty());
+    Q_ASSERT(!klineId.isEmpty());
+
+    _stockExchangeId = stockExchangeId;
+    _klineId = klineId;
+
+    clear();
 }
 
-void Natr::clear()
+void Natr::clear() noexcept
 {
-    _close.reset();
-    _volume.reset();
+    _close.store(std::numeric_limits<double>::quiet_NaN(), std::memory_order_relaxed);
+    _volume.store(std::numeric_limits<double>::quiet_NaN(), std::memory_order_relaxed);
 }
 
-void Natr::calculate(const TradingCatCommon::PKLinesList &klines)
+bool Natr::calculate(const TradingCatCommon::PKLinesList& klines)
 {
     if (klines->size() <= MIN_SIZE_FOR_CALCULATE)
     {
-        return;
+        return false;
     }
 
-    if (_klineID.isEmpty())
-    {
-        _klineID = (*klines->begin())->id;
-    }
-    else
+    Q_ASSERT(_klineId == (*klines->begin())->id);
+
+    qint64 old = 0;
+    for (const auto& kline: *klines)
     {
-        Q_ASSERT(_klineID == (*klines->begin())->id);
+        old = std::max(old, kline->closeTime);
     }
 
-    for (const auto& kline: *klines)
+    //Значения разных расчетов не должны смешиваться
+    QMutexLocker<QMutex> calculateLocker(&_calculateMutex);
+
+    if (old < _old.load(std::memory_order_relaxed))
     {
-        _old = std::max(_old, kline->closeTime);
+        return false;
     }
 
     //Delta
-    {       
+    double closeValue = std::numeric_limits<double>::quiet_NaN();
+    {
         std::vector<double> close;
         close.resize(klines->size());
         std::transform(klines->begin(), klines->end(), close.begin(),
@@ -55,12 +78,13 @@ void Natr::calculate(const TradingCatCommon::PKLinesList &klines)
 
         const auto ignoreCount = close.size() / 10;
 
-        const auto closeSumm = std::accumulate(std::next(close.begin(), ignoreCount), std::prev(close.end(), ignoreCount), 0.0f);
+        const auto closeSumm = std::accumulate(std::next(close.begin(), ignoreCount), std::prev(close.end(), ignoreCount), 0.0);
 
-        _close = closeSumm / (close.size() - (ignoreCount * 2));
+        closeValue = closeSumm / (close.size() - (ignoreCount * 2));
     }
 
     //Volume
+    double volumeValue = std::numeric_limits<double>::quiet_NaN();
     {
         std::vector<double> volume;
         volume.reserve(klines->size());
@@ -79,72 +103,174 @@ void Natr::calculate(const TradingCatCommon::PKLinesList &klines)
 
             const auto ignoreCount = volume.size() / 10;
 
-            const auto volumeSumm = std::accumulate(std::next(volume.begin(), ignoreCount), std::prev(volume.end(), ignoreCount), 0.0f);
+            const auto volumeSumm = std::accumulate(std::next(volume.begin(), ignoreCount), std::prev(volume.end(), ignoreCount), 0.0);
 
-            _volume = volumeSumm / (volume.size() - (ignoreCount * 2));
+            volumeValue = volumeSumm / (volume.size() - (ignoreCount * 2));
         }
     }
 
-    qDebug() << QString("KLine ID %1 update natr value successully. New value: close price: %2 volume: %3")
-                    .arg((*klines->begin())->id.toString())
-                    .arg(_close.value_or(0))
-                    .arg(_volume.value_or(0));
+    _close.store(closeValue, std::memory_order_relaxed);
+    _volume.store(volumeValue, std::memory_order_relaxed);
+    _old.store(old, std::memory_order_release);
+    _insufficientData.store(0, std::memory_order_relaxed);
+
+    return true;
+}
+
+void Natr::setInsufficientData(qint64 currentDateTime) noexcept
+{
+    _insufficientData.store(currentDateTime, std::memory_order_relaxed);
+}
+
+qint64 Natr::oldNatr() const noexcept
+{
+    return _old.load(std::memory_order_acquire);
+}
+
+bool Natr::isExpired(qint64 currentDateTime) const noexcept
+{
+    return (currentDateTime - oldNatr()) > static_cast<qint64>(_klineId.type) * MAX_SAVE_NATR;
+}
+
+bool Natr::isStale(qint64 currentDateTime) const noexcept
+{
+    const auto recalculateInterval = static_cast<qint64>(_klineId.type) * RECALCULATE_NATR;
+
+    //Серия с недостаточным количеством свечей не запрашивается заново при каждом просмотре таблицы
+    if ((currentDateTime - _insufficientData.load(std::memory_order_relaxed)) <= recalculateInterval)
+    {
+        return false;
+    }
+
+    return (currentDateTime - oldNatr()) > recalculateInterval;
+}
+
+bool Natr::trySchedule() noexcept
+{
+    bool expected = false;
+
+    return _isScheduled.compare_exchange_strong(expected, true, std::memory_order_acq_rel);
 }
 
-const QDateTime &Natr::oldNatr() const noexcept
+void Natr::finishSchedule() noexcept
 {
-    return _old;
+    _isScheduled.store(false, std::memory_order_release);
 }
 
-std::optional<double> Natr::close() noexcept
+std::optional<double> Natr::close() const noexcept
 {
-    if (_close.has_value() && _old.msecsTo(QDateTime::currentDateTime()) > static_cast<qint64>(_klineID.type) * MAX_SAVE_NATR)
+    const auto close = _close.load(std::memory_order_relaxed);
+    if (std::isnan(close))
     {
-        _close.reset();
+        return std::nullopt;
     }
 
-    return _close;
+    return close;
 }
 
-std::optional<double> Natr::volume() noexcept
+std::optional<double> Natr::volume() const noexcept
 {
-    if (_volume.has_value() && _old.msecsTo(QDateTime::currentDateTime()) > static_cast<qint64>(_klineID.type) * MAX_SAVE_NATR)
+    const auto volume = _volume.load(std::memory_order_relaxed);
+    if (std::isnan(volume))
     {
-        _volume.reset();
+        return std::nullopt;
     }
 
-    return _volume;
+    return volume;
+}
+
+const StockExchangeID &Natr::stockExchangeId() const noexcept
+{
+    return _stockExchangeId;
+}
+
+const KLineID &Natr::klineId() const noexcept
+{
+    return _klineId;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 ///     class Natrs
 ///
+Natrs::Natrs(quint32 maxSeriesCount /* = 100000u */)
+    : _maxSeriesCount(maxSeriesCount)
+    , _table(std::make_unique<Natr[]>(maxSeriesCount))
+{
+    Q_ASSERT(_maxSeriesCount != 0);
+}
 
-Natr& Natrs::getNatr(const StockExchangeID &stockExchangeId, const KLineID &klineId)
+std::optional<Natrs::SeriesId> Natrs::seriesId(const StockExchangeID &stockExchangeId, const KLineID &klineId)
 {
     Q_ASSERT(!stockExchangeId.isEmpty());
     Q_ASSERT(!klineId.isEmpty());
 
-    auto it_natrsMap = _natrsMap.find(stockExchangeId);
-    if (it_natrsMap == _natrsMap.end())
+    QMutexLocker<QMutex> registerLocker(&_registerMutex);
+
+    auto& klineSeriesMap = _seriesMap[stockExchangeId];
+
+    const auto it_klineSeriesMap = klineSeriesMap.find(klineId);
+    if (it_klineSeriesMap != klineSeriesMap.end())
+    {
+        return it_klineSeriesMap->second;
+    }
+
+    const auto id = _count.load(std::memory_order_relaxed);
+
+    //Таблица выделена сразу и не расширяется, новые серии не регистрируются
+    if (id >= _maxSeriesCount)
     {
-        auto p_klineNatrsMap = std::make_unique<KLineNatrsMap>();
-        auto p_natr = std::make_unique<Natr>();
-        p_klineNatrsMap->emplace(klineId, std::move(p_natr));
+        qWarning() << QString("StockExchange ID: %1 KLine ID: %2. NATR table is full (%3 series). Series is not registered")
+                          .arg(stockExchangeId.toString())
+                          .arg(klineId.toString())
+                          .arg(_maxSeriesCount);
 
-        it_natrsMap =  _natrsMap.emplace(stockExchangeId, std::move(p_klineNatrsMap)).first;
+        return std::nullopt;
     }
 
-    auto& klineNatrsMap = it_natrsMap ->second;
+    _table[id].reset(stockExchangeId, klineId);
+    klineSeriesMap.emplace(klineId, id);
+
+    _count.store(id + 1, std::memory_order_release);
+
+    return id;
+}
+
+std::optional<Natrs::SeriesId> Natrs::findSeriesId(const StockExchangeID &stockExchangeId, const KLineID &klineId) const
+{
+    QMutexLocker<QMutex> registerLocker(&_registerMutex);
 
-    auto it_klineNatrsMap = klineNatrsMap->find(klineId);
-    if (it_klineNatrsMap == klineNatrsMap->end())
+    const auto it_seriesMap = _seriesMap.find(stockExchangeId);
+    if (it_seriesMap == _seriesMap.end())
     {
-        auto p_natr = std::make_unique<Natr>();
-        it_klineNatrsMap = klineNatrsMap->emplace(klineId, std::move(p_natr)).first;
+        return std::nullopt;
     }
 
-    return *it_klineNatrsMap->second;
+    const auto it_klineSeriesMap = it_seriesMap->second.find(klineId);
+    if (it_klineSeriesMap == it_seriesMap->second.end())
+    {
+        return std::nullopt;
+    }
+
+    return it_klineSeriesMap->second;
+}
+
+const Natr &Natrs::natr(SeriesId id) const noexcept
+{
+    Q_ASSERT(id < _count.load(std::memory_order_acquire));
+
+    return _table[id];
+}
+
+Natr &Natrs::natr(SeriesId id) noexcept
+{
+    Q_ASSERT(id < _count.load(std::memory_order_acquire));
+
+    return _table[id];
+}
+
+quint32 Natrs::count() const noexcept
+{
+    return _count.load(std::memory_order_acquire);
 }
 
 void Natrs::calculateNatr(const StockExchangeID &stockExchangeId, const PKLinesList &klines)
@@ -157,11 +283,153 @@ void Natrs::calculateNatr(const StockExchangeID &stockExchangeId, const PKLinesL
         return;
     }
 
-    auto& natr = getNatr(stockExchangeId, (*klines->begin())->id);
-    natr.calculate(klines);
+    const auto id = seriesId(stockExchangeId, (*klines->begin())->id);
+    if (!id.has_value())
+    {
+        return;
+    }
+
+    natr(id.value()).calculate(klines);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///     class NatrsScheduler
+///
+NatrsScheduler::NatrsScheduler(Natrs &natrs, const TradingData &tradingData, QObject *parent /* = nullptr */)
+    : QObject{parent}
+    , _natrs(natrs)
+    , _tradingData(tradingData)
+{
+}
+
+NatrsScheduler::~NatrsScheduler()
+{
+    stop();
+}
+
+void NatrsScheduler::start()
+{
+    Q_ASSERT(!_isStarted);
+
+    _timer = std::make_unique<QTimer>();
+
+    QObject::connect(_timer.get(), SIGNAL(timeout()), SLOT(schedule()));
+
+    _timer->start(SCHEDULE_INTERVAL);
+
+    _isStarted = true;
+}
+
+void NatrsScheduler::stop()
+{
+    if (!_isStarted)
+    {
+        return;
+    }
+
+    _timer.reset();
+
+    for (auto& worker: _workers)
+    {
+        worker.wait();
+    }
+    _workers.clear();
+
+    _isStarted = false;
+
+    emit finished();
+}
+
+void NatrsScheduler::schedule()
+{
+    //Убираем завершенные пересчеты
+    _workers.remove_if(
+        [](const auto& worker)
+        {
+            return worker.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+        });
+
+    const auto maxWorkers = static_cast<std::size_t>(std::max(1, QThread::idealThreadCount()));
+    if (_workers.size() >= maxWorkers)
+    {
+        return;
+    }
+
+    const auto count = _natrs.count();
+    if (count == 0)
+    {
+        return;
+    }
+
+    const auto currentDateTime = QDateTime::currentDateTime().toMSecsSinceEpoch();
+
+    SeriesIdList batch;
+    batch.reserve(SCHEDULE_BATCH_SIZE);
+
+    //Просматриваем таблицу по кругу, начиная с места остановки прошлого просмотра
+    for (quint32 i = 0; i < count && _workers.size() < maxWorkers; ++i)
+    {
+        const auto id = (_nextSeriesId + i) % count;
+        auto& natr = _natrs.natr(id);
+
+        if (natr.isExpired(currentDateTime))
+        {
+            natr.clear();
+        }
+
+        //Серия из медленной пачки прошлого просмотра еще пересчитывается - повторный расчет ждал бы ее на _calculateMutex
+        if (!natr.isStale(currentDateTime) || !natr.trySchedule())
+        {
+            continue;
+        }
+
+        batch.push_back(id);
+        if (batch.size() >= SCHEDULE_BATCH_SIZE)
+        {
+            _nextSeriesId = (id + 1) % count;
+            _workers.emplace_back(std::async(std::launch::async, &NatrsScheduler::recalculate, std::ref(_natrs), std::cref(_tradingData), std::move(batch), currentDateTime));
+
+            batch = SeriesIdList();
+            batch.reserve(SCHEDULE_BATCH_SIZE);
+        }
+    }
+
+    if (batch.empty())
+    {
+        return;
+    }
+
+    if (_workers.size() < maxWorkers)
+    {
+        _nextSeriesId = (batch.back() + 1) % count;
+        _workers.emplace_back(std::async(std::launch::async, &NatrsScheduler::recalculate, std::ref(_natrs), std::cref(_tradingData), std::move(batch), currentDateTime));
+
+        return;
+    }
+
+    //Пачка не запущена - серии будут поставлены в очередь при следующем просмотре
+    for (const auto id: batch)
+    {
+        _natrs.natr(id).finishSchedule();
+    }
 }
 
-const QDateTime &Natrs::oldNatr(const StockExchangeID &stockExchangeId, const KLineID &klineId)
+void NatrsScheduler::recalculate(Natrs &natrs, const TradingData &tradingData, SeriesIdList batch, qint64 currentDateTime)
 {
-    return getNatr(stockExchangeId, klineId).oldNatr();
+    for (const auto id: batch)
+    {
+        auto& natr = natrs.natr(id);
+        const auto interval = static_cast<qint64>(natr.klineId().type);
+
+        const auto klines = tradingData.getKLinesOnDate(natr.stockExchangeId(),
+                                                        natr.klineId(),
+                                                        currentDateTime - interval * NATR_KLINES_COUNT,
+                                                        currentDateTime + interval / 2);
+        if (!natr.calculate(klines) && klines->size() <= MIN_SIZE_FOR_CALCULATE)
+        {
+            natr.setInsufficientData(currentDateTime);
+        }
+
+        natr.finishSchedule();
+    }
 }
@@ -0,0 +1,130 @@
+//STL
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+
+#include "TradingCatCommon/numberformat.h"
+
+using namespace TradingCatCommon;
+
+static const qsizetype NUMBER_BUFFER_SIZE = 64; ///< Достаточно для любого числа в кратчайшем представлении
+static const int MAX_FIXED_PRECISION = 17;      ///< Наибольшее количество знаков после точки для формата с фиксированной точкой
+static const int MAX_GENERAL_PRECISION = 17;    ///< Наибольшее количество значащих цифр. Достаточно для восстановления любого double
+
+template <typename TFunction>
+static void appendChars(QByteArray& buffer, TFunction toChars)
+{
+    char str[NUMBER_BUFFER_SIZE];
+    const auto [ptr, ec] = toChars(str, str + NUMBER_BUFFER_SIZE);
+
+    Q_ASSERT(ec == std::errc());
+
+    buffer.append(str, ptr - str);
+}
+
+void TradingCatCommon::appendNumber(QByteArray &buffer, double value)
+{
+    appendChars(buffer, [value](char* first, char* last) { return std::to_chars(first, last, value); });
+}
+
+void TradingCatCommon::appendNumber(QByteArray &buffer, float value)
+{
+    appendChars(buffer, [value](char* first, char* last) { return std::to_chars(first, last, value); });
+}
+
+void TradingCatCommon::appendNumber(QByteArray &buffer, qint64 value)
+{
+    appendChars(buffer, [value](char* first, char* last) { return std::to_chars(first, last, value); });
+}
+
+void TradingCatCommon::appendFixedNumber(QByteArray &buffer, double value, int precision)
+{
+    Q_ASSERT(precision >= 0);
+
+    //Большие числа в формате с фиксированной точкой не помещаются в буфер
+    if (!std::isfinite(value) || std::abs(value) >= 1e20)
+    {
+        appendNumber(buffer, value);
+
+        return;
+    }
+
+    const auto fixedPrecision = std::min(precision, MAX_FIXED_PRECISION);
+    appendChars(buffer, [value, fixedPrecision](char* first, char* last) { return std::to_chars(first, last, value, std::chars_format::fixed, fixedPrecision); });
+}
+
+void TradingCatCommon::appendGeneralNumber(QByteArray &buffer, double value, int precision)
+{
+    Q_ASSERT(precision > 0);
+
+    const auto generalPrecision = std::clamp(precision, 1, MAX_GENERAL_PRECISION);
+    appendChars(buffer, [value, generalPrecision](char* first, char* last) { return std::to_chars(first, last, value, std::chars_format::general, generalPrecision); });
+}
+
+QString TradingCatCommon::numberToString(double value)
+{
+    QByteArray result;
+    appendNumber(result, value);
+
+    return QString::fromLatin1(result);
+}
+
+QString TradingCatCommon::numberToString(float value)
+{
+    QByteArray result;
+    appendNumber(result, value);
+
+    return QString::fromLatin1(result);
+}
+
+QString TradingCatCommon::numberToString(qint64 value)
+{
+    QByteArray result;
+    appendNumber(result, value);
+
+    return QString::fromLatin1(result);
+}
+
+QString TradingCatCommon::fixedNumberToString(double value, int precision /* = 6 */)
+{
+    QByteArray result;
+    appendFixedNumber(result, value, precision);
+
+    return QString::fromLatin1(result);
+}
+
+QString TradingCatCommon::generalNumberToString(double value, int precision /* = 6 */)
+{
+    QByteArray result;
+    appendGeneralNumber(result, value, precision);
+
+    return QString::fromLatin1(result);
+}
+
+std::optional<double> TradingCatCommon::parseDouble(QByteArrayView str) noexcept
+{
+    const auto last = str.data() + str.size();
+
+    double result = 0.0;
+    const auto [ptr, ec] = std::from_chars(str.data(), last, result);
+    if (ec != std::errc() || ptr != last || str.isEmpty())
+    {
+        return std::nullopt;
+    }
+
+    return result;
+}
+
+std::optional<qint64> TradingCatCommon::parseInt64(QByteArrayView str) noexcept
+{
+    const auto last = str.data() + str.size();
+
+    qint64 result = 0;
+    const auto [ptr, ec] = std::from_chars(str.data(), last, result);
+    if (ec != std::errc() || ptr != last || str.isEmpty())
+    {
+        return std::nullopt;
+    }
+
+    return result;
+}
@@ -0,0 +1,249 @@
+//Qt
+#include <QMutex>
+#include <QMutexLocker>
+
+//My
+#include "TradingCatCommon/appserverprotocol.h"
+#include "TradingCatCommon/jsonwriter.h"
+#include "TradingCatCommon/transmitdata.h"
+#include "TradingCatCommon/websocket.h"
+
+#include "TradingCatCommon/pushchannel.h"
+
+using namespace TradingCatCommon;
+
+Q_GLOBAL_STATIC(QMutex, pushEventsMutex);
+
+Q_GLOBAL_STATIC_WITH_ARGS(const QString, PUSH_EVENT_DETECT, ("Detect"));
+Q_GLOBAL_STATIC_WITH_ARGS(const QString, PUSH_EVENT_KLINES, ("KLines"));
+Q_GLOBAL_STATIC_WITH_ARGS(const QString, PUSH_EVENT_LOST, ("Lost"));
+
+/*!
+    Формирует кадр WebSocket с событием: {"Cursor":N,"Type":"...","Data":{...}}
+        Тип записывается перед данными, чтобы клиент мог разбирать данные потоково
+    @param cursor - курсор события
+    @param type - тип события
+    @param data - данные события в формате JSON. Пустой массив - событие без данных
+    @return кадр WebSocket
+*/
+static QByteArray makeEventFrame(quint64 cursor, PushEventType type, const QByteArray& data)
+{
+    QByteArray message;
+    JsonWriter writer(message);
+
+    writer.beginObject();
+    writer.keyValue("Cursor", static_cast<qint64>(cursor));
+    writer.keyValue("Type", pushEventTypeToString(type));
+    if (!data.isEmpty())
+    {
+        writer.key("Data");
+        writer.rawValue(data);
+    }
+    writer.endObject();
+
+    return makeWebSocketFrame(WebSocketOpCode::TEXT, message);
+}
+
+QString TradingCatCommon::pushEventTypeToString(PushEventType type)
+{
+    switch (type)
+    {
+    case PushEventType::DETECT: return *PUSH_EVENT_DETECT;
+    case PushEventType::KLINES: return *PUSH_EVENT_KLINES;
+    case PushEventType::LOST: return *PUSH_EVENT_LOST;
+    default:
+        Q_ASSERT(false);
+    }
+
+    return QString();
+}
+
+std::optional<PushEventType> TradingCatCommon::stringToPushEventType(QStringView type)
+{
+    if (type == *PUSH_EVENT_DETECT)
+    {
+        return PushEventType::DETECT;
+    }
+    if (type == *PUSH_EVENT_KLINES)
+    {
+        return PushEventType::KLINES;
+    }
+    if (type == *PUSH_EVENT_LOST)
+    {
+        return PushEventType::LOST;
+    }
+
+    return std::nullopt;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///     The PushChannel class
+///
+PushChannel::PushChannel(quint64 capacity /* = 10000 */, QObject *parent /* = nullptr */)
+    : QObject{parent}
+    , _capacity(capacity)
+{
+    Q_ASSERT(_capacity > 0);
+}
+
+quint64 PushChannel::cursor() const
+{
+    QMutexLocker<QMutex> pushEventsLocker(pushEventsMutex);
+
+    return _lastCursor;
+}
+
+bool PushChannel::isSession(qint64 sessionId) const
+{
+    QMutexLocker<QMutex> pushEventsLocker(pushEventsMutex);
+
+    return _sessions.contains(sessionId);
+}
+
+void PushChannel::openSession(qint64 sessionId)
+{
+    Q_ASSERT(sessionId != 0);
+
+    QMutexLocker<QMutex> pushEventsLocker(pushEventsMutex);
+
+    _sessions.insert(sessionId);
+}
+
+void PushChannel::closeSession(qint64 sessionId)
+{
+    {
+        QMutexLocker<QMutex> pushEventsLocker(pushEventsMutex);
+
+        if (_sessions.erase(sessionId) == 0)
+        {
+            return;
+        }
+    }
+
+    emit sessionClosed(sessionId);
+}
+
+PushChannel::Events PushChannel::eventsAfter(quint64 cursor, qint64 sessionId, bool isKLines, qint64 maxBytes) const
+{
+    Events result;
+
+    QMutexLocker<QMutex> pushEventsLocker(pushEventsMutex);
+
+    //ИД сессии - единственное подтверждение права на события, поэтому после закрытия сессии события не передаются
+    if (!_sessions.contains(sessionId))
+    {
+        result.isClosed = true;
+        result.cursor = cursor;
+
+        return result;
+    }
+
+    //Курсор клиента больше последнего - журнал создан заново после перезапуска сервера
+    if (cursor > _lastCursor)
+    {
+        result.isLost = true;
+        cursor = 0;
+    }
+
+    //Курсоры событий журнала идут подряд, поэтому позиция события вычисляется без поиска
+    const auto firstCursor = _events.empty() ? _lastCursor + 1 : _events.front().cursor;
+    if (cursor + 1 < firstCursor)
+    {
+        result.isLost = true;
+        cursor = firstCursor - 1;
+    }
+
+    result.cursor = cursor;
+    if (cursor == _lastCursor)
+    {
+        return result;
+    }
+
+    qint64 size = 0;
+    for (auto events_it = _events.begin() + static_cast<qsizetype>(cursor + 1 - firstCursor); events_it != _events.end(); ++events_it)
+    {
+        const auto& event = *events_it;
+
+        const bool isMatch = event.type == PushEventType::KLINES ? isKLines : event.sessionId == sessionId;
+        if (isMatch)
+        {
+            if (!result.frames.empty() && size + event.frame->size() > maxBytes)
+            {
+                break;
+            }
+
+            size += event.frame->size();
+            result.frames.push_back(event.frame);
+        }
+
+        result.cursor = event.cursor;
+    }
+
+    return result;
+}
+
+QByteArray PushChannel::lostFrame(quint64 cursor)
+{
+    return makeEventFrame(cursor, PushEventType::LOST, QByteArray());
+}
+
+void PushChannel::klineDetect(qint64 sessionId, const Detector::PKLineDetectData &detectData)
+{
+    Q_CHECK_PTR(detectData);
+
+    Detector::KLinesDetectedList klinesDetectedList;
+    klinesDetectedList.detected.push_back(detectData);
+
+    QByteArray data;
+    JsonWriter writer(data);
+    DetectAnswer(klinesDetectedList, QString()).writeJson(writer);
+
+    addEvent(PushEventType::DETECT, sessionId, data);
+}
+
+void PushChannel::addKLines(const StockExchangeID &stockExchangeId, const PKLinesList &klines)
+{
+    Q_CHECK_PTR(klines);
+
+    if (klines->empty())
+    {
+        return;
+    }
+
+    QByteArray data;
+    JsonWriter writer(data);
+
+    writer.beginObject();
+    writer.key("KLines");
+    KLinesArrayJson(klines).writeJson(writer);
+    writer.key("StockExchangeID");
+    StockExchangeIDJson(stockExchangeId).writeJson(writer);
+    writer.endObject();
+
+    addEvent(PushEventType::KLINES, 0, data);
+}
+
+void PushChannel::addEvent(PushEventType type, qint64 sessionId, const QByteArray &data)
+{
+    quint64 cursor = 0;
+
+    {
+        QMutexLocker<QMutex> pushEventsLocker(pushEventsMutex);
+
+        cursor = ++_lastCursor;
+
+        Event event;
+        event.cursor = cursor;
+        event.sessionId = sessionId;
+        event.type = type;
+        event.frame = std::make_shared<const QByteArray>(makeEventFrame(cursor, type, data));
+
+        _events.emplace_back(std::move(event));
+        while (_events.size() > _capacity)
+        {
+            _events.pop_front();
+        }
+    }
+
+    emit eventsAvailable(cursor);
+}
@@ -0,0 +1,398 @@
+//Qt
+#include <QRandomGenerator>
+
+//My
+#include <Common/parser.h>
+
+#include "TradingCatCommon/appserverprotocol.h"
+#include "TradingCatCommon/jsonreader.h"
+#include "TradingCatCommon/pushchannel.h"
+#include "TradingCatCommon/transmitdata.h"
+
+#include "TradingCatCommon/pushclient.h"
+
+using namespace TradingCatCommon;
+using namespace Common;
+
+static const qsizetype MAX_HANDSHAKE_SIZE = 16 * 1024;
+static const qint64 MAX_MESSAGE_SIZE = 64 * 1024 * 1024;
+
+PushClient::PushClient(const HTTPClientConfig& config, qint64 sessionId, bool isKLines, QObject* parent /* = nullptr */)
+    : QObject{parent}
+    , _config(config)
+    , _sessionId(sessionId)
+    , _isKLines(isKLines)
+{
+    Q_ASSERT(_config.isCheck());
+    Q_ASSERT(_sessionId != 0);
+
+    qRegisterMetaType<TradingCatCommon::StockExchangeID>("TradingCatCommon::StockExchangeID");
+    qRegisterMetaType<TradingCatCommon::PKLinesList>("TradingCatCommon::PKLinesList");
+    qRegisterMetaType<TradingCatCommon::Detector::PKLineDetectData>("TradingCatCommon::Detector::PKLineDetectData");
+}
+
+PushClient::~PushClient()
+{
+    stop();
+}
+
+quint64 PushClient::cursor() const noexcept
+{
+    return _cursor;
+}
+
+void PushClient::start()
+{
+    Q_ASSERT(!_isStarted);
+
+    _reconnectTimer = new QTimer();
+    _reconnectTimer->setSingleShot(true);
+
+    connect(_reconnectTimer, SIGNAL(timeout()), SLOT(reconnect()));
+
+    _isStarted = true;
+
+    reconnect();
+}
+
+void PushClient::stop()
+{
+    if (!_isStarted)
+    {
+        return;
+    }
+
+    if (_socket != nullptr)
+    {
+        _socket->disconnect(this);
+        if (_socket->state() == QAbstractSocket::ConnectedState && _isUpgraded)
+        {
+            _socket->write(makeWebSocketFrame(WebSocketOpCode::CLOSE, QByteArray::fromHex("03e8"), true)); //1000 - нормальное закрытие
+            _socket->flush();
+        }
+        _socket->abort();
+        _socket->deleteLater();
+        _socket = nullptr;
+    }
+
+    delete _reconnectTimer;
+    _reconnectTimer = nullptr;
+
+    _frameReader.reset();
+    _isUpgraded = false;
+
+    _isStarted = false;
+}
+
+void PushClient::reconnect()
+{
+    Q_ASSERT(_isStarted);
+    Q_ASSERT(_socket == nullptr);
+
+    _handshake.clear();
+    _isUpgraded = false;
+    _frameReader = std::make_unique<WebSocketFrameReader>(MAX_MESSAGE_SIZE);
+
+    _socket = new QTcpSocket(this);
+
+    connect(_socket, SIGNAL(connected()), SLOT(connected()));
+    connect(_socket, SIGNAL(readyRead()), SLOT(readyRead()));
+    connect(_socket, SIGNAL(disconnected()), SLOT(disconnected()));
+    connect(_socket, SIGNAL(errorOccurred(QAbstractSocket::SocketError)), SLOT(errorOccurred(QAbstractSocket::SocketError)));
+
+    _socket->connectToHost(_config.address, _config.port);
+}
+
+void PushClient::connected()
+{
+    Q_CHECK_PTR(_socket);
+
+    QByteArray nonce(16, Qt::Uninitialized);
+    QRandomGenerator::global()->fillRange(reinterpret_cast<quint32*>(nonce.data()), nonce.size() / sizeof(quint32));
+    _key = nonce.toBase64();
+
+    //Курсор передается при каждом подключении, поэтому после разрыва сервер досылает пропущенные события
+    PushQuery query(_sessionId, _cursor, _isKLines);
+
+    QByteArray request;
+    request += QString("GET %1?%2 HTTP/1.1\r\n").arg(query.path()).arg(query.query().toString(QUrl::FullyEncoded)).toUtf8();
+    request += QString("Host: %1:%2\r\n").arg(_config.address.toString()).arg(_config.port).toUtf8();
+    request += "Upgrade: websocket\r\n";
+    request += "Connection: Upgrade\r\n";
+    request += "Sec-WebSocket-Key: " + _key + "\r\n";
+    request += "Sec-WebSocket-Version: 13\r\n";
+    request += "\r\n";
+
+    _socket->write(request);
+}
+
+void PushClient::readyRead()
+{
+    Q_CHECK_PTR(_socket);
+    Q_CHECK_PTR(_frameReader);
+
+    const auto data = _socket->readAll();
+
+    if (!_isUpgraded)
+    {
+        _handshake += data;
+
+        const auto result = parseHandshake();
+        if (result.has_value())
+        {
+            restart(result.value());
+
+            return;
+        }
+
+        if (!_isUpgraded)
+        {
+            return;
+        }
+    }
+    else
+    {
+        _frameReader->add(data);
+    }
+
+    while (_socket != nullptr)
+    {
+        const auto frame = _frameReader->next();
+        if (!frame.has_value())
+        {
+            if (_frameReader->isError())
+            {
+                restart(QString("Incorrect WebSocket frame: %1").arg(_frameReader->errorString()));
+            }
+
+            return;
+        }
+
+        switch (frame->opCode)
+        {
+        case WebSocketOpCode::TEXT:
+        {
+            const auto result = parseMessage(frame->payload);
+            if (result.has_value())
+            {
+                emit sendLogMsg(TDBLoger::MSG_CODE::WARNING_CODE, QString("Push client: error parse message: %1. Skip").arg(result.value()));
+            }
+            break;
+        }
+        case WebSocketOpCode::PING:
+            _socket->write(makeWebSocketFrame(WebSocketOpCode::PONG, frame->payload, true));
+            break;
+        case WebSocketOpCode::CLOSE:
+            restart("Server closed WebSocket connection");
+            return;
+        default:
+            break;
+        }
+    }
+}
+
+PushClient::ParseResult PushClient::parseHandshake()
+{
+    const auto headEnd = _handshake.indexOf("\r\n\r\n");
+    if (headEnd == -1)
+    {
+        if (_handshake.size() > MAX_HANDSHAKE_SIZE)
+        {
+            return QString("WebSocket handshake answer too large");
+        }
+
+        return std::nullopt;
+    }
+
+    const auto lines = _handshake.left(headEnd).split('\n');
+    const auto status = lines.front().trimmed().split(' ');
+    if (status.size() < 2 || status[1] != "101")
+    {
+        return QString("Server refused WebSocket connection: %1").arg(QString::fromUtf8(lines.front().trimmed()));
+    }
+
+    QByteArray accept;
+    for (qsizetype i = 1; i < lines.size(); ++i)
+    {
+        const auto& line = lines[i];
+        const auto pos = line.indexOf(':');
+        if (pos != -1 && line.left(pos).trimmed().toLower() == "sec-websocket-accept")
+        {
+            accept = line.mid(pos + 1).trimmed();
+        }
+    }
+
+    if (accept != webSocketAcceptKey(_key))
+    {
+        return QString("Incorrect Sec-WebSocket-Accept value");
+    }
+
+    _isUpgraded = true;
+    _reconnectDelay = 0;
+
+    //Сервер мог отправить события вместе с ответом
+    _frameReader->add(_handshake.mid(headEnd + 4));
+    _handshake.clear();
+
+    emit sendLogMsg(TDBLoger::MSG_CODE::INFORMATION_CODE, QString("Push client: connected to %1:%2. Cursor: %3")
+                                                              .arg(_config.address.toString())
+                                                              .arg(_config.port)
+                                                              .arg(_cursor));
+
+    emit opened();
+
+    return std::nullopt;
+}
+
+PushClient::ParseResult PushClient::parseMessage(const QByteArray& message)
+{
+    try
+    {
+        JsonReader reader(message);
+
+        quint64 cursor = 0;
+        std::optional<PushEventType> type;
+
+        reader.beginObject();
+        while (reader.nextKey())
+        {
+            const auto key = reader.key();
+            if (key == "Cursor")
+            {
+                cursor = static_cast<quint64>(reader.readInt64());
+            }
+            else if (key == "Type")
+            {
+                type = stringToPushEventType(reader.readString());
+                if (!type.has_value())
+                {
+                    reader.error("Unknown event type");
+                }
+            }
+            else if (key == "Data" && type == PushEventType::DETECT)
+            {
+                DetectAnswer answer(reader);
+                if (answer.isError())
+                {
+                    return answer.errorString();
+                }
+
+                for (const auto& detectData: answer.klinesDetectedList().detected)
+                {
+                    emit klineDetect(detectData);
+                }
+            }
+            else if (key == "Data" && type == PushEventType::KLINES)
+            {
+                std::optional<StockExchangeID> stockExchangeId;
+                PKLinesList klinesList;
+
+                reader.beginObject();
+                while (reader.nextKey())
+                {
+                    const auto dataKey = reader.key();
+                    if (dataKey == "KLines")
+                    {
+                        KLinesArrayJson klines(reader);
+                        if (klines.isError())
+                        {
+                            return klines.errorString();
+                        }
+                        klinesList = klines.klinesList();
+                    }
+                    else if (dataKey == "StockExchangeID")
+                    {
+                        StockExchangeIDJson stockExchangeIdJson(reader);
+                        if (stockExchangeIdJson.isError())
+                        {
+                            return stockExchangeIdJson.errorString();
+                        }
+                        stockExchangeId = stockExchangeIdJson.stockExchangeId();
+                    }
+                    else
+                    {
+                        reader.skipValue();
+                    }
+                }
+
+                if (!stockExchangeId.has_value() || !klinesList || klinesList->empty())
+                {
+                    reader.error("Event KLines must contain stock exchange ID and not empty klines list");
+                }
+
+                emit newKLines(stockExchangeId.value(), klinesList);
+            }
+            else
+            {
+                reader.skipValue();
+            }
+        }
+        reader.end();
+
+        if (type == PushEventType::LOST)
+        {
+            emit sendLogMsg(TDBLoger::MSG_CODE::WARNING_CODE, QString("Push client: events after %1 lost").arg(cursor));
+            emit eventsLost();
+
+            return std::nullopt;
+        }
+
+        if (cursor != 0)
+        {
+            _cursor = cursor;
+        }
+    }
+    catch (const ParseException& err)
+    {
+        return QString(err.what());
+    }
+
+    return std::nullopt;
+}
+
+void PushClient::disconnected()
+{
+    restart("Connection closed");
+}
+
+void PushClient::errorOccurred(QAbstractSocket::SocketError socketError)
+{
+    Q_UNUSED(socketError);
+    Q_CHECK_PTR(_socket);
+
+    restart(_socket->errorString());
+}
+
+void PushClient::restart(const QString& msg)
+{
+    if (_socket == nullptr)
+    {
+        return;
+    }
+
+    //После перезапуска сервера соединения всех клиентов разрываются одновременно. Задержки случайны,
+    //поэтому клиенты переподключаются не все сразу. Первая задержка берется в диапазоне [base, base * 3]
+    _reconnectDelay = HTTPClient::decorrelatedJitter(_config.retryBaseDelay, _config.retryMaxDelay,
+                                                     _reconnectDelay > 0 ? _reconnectDelay : _config.retryBaseDelay);
+
+    emit sendLogMsg(TDBLoger::MSG_CODE::WARNING_CODE, QString("Push client: %1. Reconnect after %2 ms. Cursor: %3")
+                                                          .arg(msg)
+                                                          .arg(_reconnectDelay)
+                                                          .arg(_cursor));
+
+    //Метод может вызываться из обработчиков сигналов сокета, поэтому удаляем его отложенно
+    _socket->disconnect(this);
+    _socket->abort();
+    _socket->deleteLater();
+    _socket = nullptr;
+
+    const bool isUpgraded = _isUpgraded;
+    _isUpgraded = false;
+
+    _reconnectTimer->start(_reconnectDelay);
+
+    if (isUpgraded)
+    {
+        emit closed();
+    }
+}
@@ -0,0 +1,290 @@
+//STL
+#include <algorithm>
+#include <bit>
+
+//My
+#include "TradingCatCommon/numberformat.h"
+
+#include "TradingCatCommon/servermetrics.h"
+
+using namespace TradingCatCommon;
+
+/*!
+    Добавляет заголовок метрики в формате Prometheus
+    @param buffer - буфер
+    @param name - название метрики
+    @param type - тип метрики
+    @param help - описание метрики
+*/
+static void appendHeader(QByteArray& buffer, const char* name, const char* type, const char* help)
+{
+    buffer.append("# HELP ").append(name).append(' ').append(help).append('\n');
+    buffer.append("# TYPE ").append(name).append(' ').append(type).append('\n');
+}
+
+/*!
+    Добавляет значение метрики в формате Prometheus
+    @param buffer - буфер
+    @param name - название метрики
+    @param labels - метки метрики в формате name="value". Пустой массив - без меток
+    @param value - значение
+*/
+static void appendValue(QByteArray& buffer, const char* name, const QByteArray& labels, qint64 value)
+{
+    buffer.append(name);
+    if (!labels.isEmpty())
+    {
+        buffer.append('{').append(labels).append('}');
+    }
+    buffer.append(' ');
+    appendNumber(buffer, value);
+    buffer.append('\n');
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///     The LatencyHistogram class
+///
+size_t LatencyHistogram::bucketIndex(quint64 value) noexcept
+{
+    if (value < SUB_BUCKET_COUNT)
+    {
+        return static_cast<size_t>(value);
+    }
+
+    const auto msb = std::bit_width(value) - 1;
+    if (msb > MAX_VALUE_BITS)
+    {
+        return BUCKET_COUNT - 1;
+    }
+
+    //Старший бит определяет степень двойки, следующие SUB_BUCKET_BITS бит - интервал внутри нее
+    const auto subBucket = (value >> (msb - SUB_BUCKET_BITS)) & (SUB_BUCKET_COUNT - 1);
+
+    return static_cast<size_t>((msb - SUB_BUCKET_BITS + 1) * SUB_BUCKET_COUNT + subBucket);
+}
+
+quint64 LatencyHistogram::upperBound(size_t index) noexcept
+{
+    Q_ASSERT(index < BUCKET_COUNT);
+
+    if (index < SUB_BUCKET_COUNT)
+    {
+        return index;
+    }
+
+    const auto msb = static_cast<int>(index / SUB_BUCKET_COUNT) + SUB_BUCKET_BITS - 1;
+    const auto subBucket = index % SUB_BUCKET_COUNT;
+
+    return ((SUB_BUCKET_COUNT + subBucket + 1) << (msb - SUB_BUCKET_BITS)) - 1;
+}
+
+void LatencyHistogram::add(quint64 value) noexcept
+{
+    auto& bucket = _counts[bucketIndex(value)];
+
+    //Пишет только поток-владелец, поэтому read-modify-write не требуется
+    bucket.store(bucket.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    _sum.store(_sum.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+    _count.store(_count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+void LatencyHistogram::addTo(Snapshot& snapshot) const noexcept
+{
+    for (size_t i = 0; i < BUCKET_COUNT; ++i)
+    {
+        snapshot.counts[i] += _counts[i].load(std::memory_order_relaxed);
+    }
+    snapshot.sum += _sum.load(std::memory_order_relaxed);
+    snapshot.count += _count.load(std::memory_order_relaxed);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///     The ThreadMetrics class
+///
+ServerMetrics::ThreadMetrics::ThreadMetrics(const ServerMetrics& server, size_t routesCount)
+    : _server(server)
+    , _routes(std::make_unique<RouteMetrics[]>(routesCount))
+    , _routesCount(routesCount)
+{
+}
+
+const ServerMetrics &ServerMetrics::ThreadMetrics::server() const noexcept
+{
+    return _server;
+}
+
+void ServerMetrics::ThreadMetrics::addRequest(size_t route, quint16 code, qint64 received, qint64 sent, quint64 latency) noexcept
+{
+    Q_ASSERT(route < _routesCount);
+
+    auto& routeMetrics = _routes[route];
+    routeMetrics.requests.add(1);
+    routeMetrics.received.add(received);
+    routeMetrics.sent.add(sent);
+    if (code >= 400)
+    {
+        routeMetrics.errors.add(1);
+    }
+    routeMetrics.latency.add(latency);
+
+    _codes[std::min<size_t>(code, CODES_COUNT - 1)].add(1);
+}
+
+void ServerMetrics::ThreadMetrics::addSent(size_t route, qint64 sent) noexcept
+{
+    Q_ASSERT(route < _routesCount);
+
+    _routes[route].sent.add(sent);
+}
+
+void ServerMetrics::ThreadMetrics::addConnections(qint64 delta) noexcept
+{
+    _connections.add(delta);
+}
+
+void ServerMetrics::ThreadMetrics::addWebSockets(qint64 delta) noexcept
+{
+    _webSockets.add(delta);
+}
+
+void ServerMetrics::ThreadMetrics::addPaused(qint64 delta) noexcept
+{
+    _paused.add(delta);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///     The ServerMetrics class
+///
+ServerMetrics::ServerMetrics(const QStringList& routes, size_t threadsCount)
+    : _routes(routes)
+{
+    Q_ASSERT(!_routes.isEmpty());
+
+    _threads.reserve(threadsCount);
+    for (size_t i = 0; i < threadsCount; ++i)
+    {
+        _threads.emplace_back(std::make_unique<ThreadMetrics>(*this, static_cast<size_t>(_routes.size())));
+    }
+}
+
+ServerMetrics::ThreadMetrics& ServerMetrics::threadMetrics(size_t thread)
+{
+    Q_ASSERT(thread < _threads.size());
+
+    return *_threads[thread];
+}
+
+QByteArray ServerMetrics::toPrometheus() const
+{
+    //Верхние границы интервалов гистограммы в секундах одинаковы для всех маршрутов
+    static const auto bucketsLabels = []()
+    {
+        std::array<QByteArray, LatencyHistogram::BUCKET_COUNT> result;
+        for (size_t i = 0; i < LatencyHistogram::BUCKET_COUNT; ++i)
+        {
+            appendFixedNumber(result[i], static_cast<double>(LatencyHistogram::upperBound(i)) / 1000000.0, 6);
+        }
+
+        return result;
+    }();
+
+    const auto routesCount = static_cast<size_t>(_routes.size());
+
+    //Суммируем блоки потоков
+    std::vector<qint64> requests(routesCount), received(routesCount), sent(routesCount), errors(routesCount);
+    std::vector<LatencyHistogram::Snapshot> latency(routesCount);
+    std::array<qint64, ThreadMetrics::CODES_COUNT> codes = {};
+    qint64 connections = 0;
+    qint64 webSockets = 0;
+    qint64 paused = 0;
+
+    for (const auto& thread: _threads)
+    {
+        for (size_t route = 0; route < routesCount; ++route)
+        {
+            const auto& routeMetrics = thread->_routes[route];
+            requests[route] += routeMetrics.requests.get();
+            received[route] += routeMetrics.received.get();
+            sent[route] += routeMetrics.sent.get();
+            errors[route] += routeMetrics.errors.get();
+            routeMetrics.latency.addTo(latency[route]);
+        }
+
+        for (size_t code = 0; code < ThreadMetrics::CODES_COUNT; ++code)
+        {
+            codes[code] += thread->_codes[code].get();
+        }
+
+        connections += thread->_connections.get();
+        webSockets += thread->_webSockets.get();
+        paused += thread->_paused.get();
+    }
+
+    std::vector<QByteArray> routesLabels;
+    routesLabels.reserve(routesCount);
+    for (const auto& route: _routes)
+    {
+        routesLabels.emplace_back(QByteArray("route=\"").append(route.toUtf8()).append('"'));
+    }
+
+    QByteArray result;
+    result.reserve(static_cast<qsizetype>(routesCount * (LatencyHistogram::BUCKET_COUNT + 10) * 80));
+
+    const auto appendRoutes = [&result, &routesLabels](const char* name, const char* type, const char* help, const std::vector<qint64>& values)
+    {
+        appendHeader(result, name, type, help);
+        for (size_t route = 0; route < values.size(); ++route)
+        {
+            appendValue(result, name, routesLabels[route], values[route]);
+        }
+    };
+
+    appendRoutes("tradingcat_http_requests_total", "counter", "Total HTTP requests", requests);
+    appendRoutes("tradingcat_http_errors_total", "counter", "Total HTTP answers with error code", errors);
+    appendRoutes("tradingcat_http_received_bytes_total", "counter", "Total bytes received", received);
+    appendRoutes("tradingcat_http_sent_bytes_total", "counter", "Total bytes sent", sent);
+
+    appendHeader(result, "tradingcat_http_request_duration_seconds", "histogram", "HTTP request latency from the first byte received to the answer sent");
+    for (size_t route = 0; route < routesCount; ++route)
+    {
+        const auto& histogram = latency[route];
+        const auto& routeLabel = routesLabels[route];
+
+        //Последний интервал не ограничен сверху и учитывается только в +Inf
+        quint64 cumulative = 0;
+        for (size_t i = 0; i + 1 < LatencyHistogram::BUCKET_COUNT; ++i)
+        {
+            cumulative += histogram.counts[i];
+            appendValue(result, "tradingcat_http_request_duration_seconds_bucket",
+                        QByteArray(routeLabel).append(",le=\"").append(bucketsLabels[i]).append('"'), static_cast<qint64>(cumulative));
+        }
+        appendValue(result, "tradingcat_http_request_duration_seconds_bucket",
+                    QByteArray(routeLabel).append(",le=\"+Inf\""), static_cast<qint64>(histogram.count));
+
+        result.append("tradingcat_http_request_duration_seconds_sum{").append(routeLabel).append("} ");
+        appendNumber(result, static_cast<double>(histogram.sum) / 1000000.0);
+        result.append('\n');
+
+        appendValue(result, "tradingcat_http_request_duration_seconds_count", routeLabel, static_cast<qint64>(histogram.count));
+    }
+
+    appendHeader(result, "tradingcat_http_responses_total", "counter", "Total HTTP answers by code");
+    for (size_t code = 0; code < ThreadMetrics::CODES_COUNT; ++code)
+    {
+        if (codes[code] != 0)
+        {
+            appendValue(result, "tradingcat_http_responses_total", QByteArray("code=\"").append(QByteArray::number(static_cast<qulonglong>(code))).append('"'), codes[code]);
+        }
+    }
+
+    appendHeader(result, "tradingcat_http_connections", "gauge", "Open connections");
+    appendValue(result, "tradingcat_http_connections", QByteArray(), connections);
+
+    appendHeader(result, "tradingcat_http_websocket_connections", "gauge", "Open WebSocket push connections");
+    appendValue(result, "tradingcat_http_websocket_connections", QByteArray(), webSockets);
+
+    appendHeader(result, "tradingcat_http_paused_connections", "gauge", "Connections waiting for the client to read pending answers");
+    appendValue(result, "tradingcat_http_paused_connections", QByteArray(), paused);
+
+    return result;
+}
@@ -1,3 +1,7 @@
+//STL
+#include <atomic>
+#include <utility>
+
 //QT
 #include <QFile>
 #include <QProcess>
@@ -8,6 +12,7 @@
 
 //My
 #include "TradingCatCommon/httpanswer.h"
+#include "TradingCatCommon/jsonwriter.h"
 #include "TradingCatCommon/transmitdata.h"
 
 #include "TradingCatCommon/socketthread.h"
@@ -17,12 +22,64 @@ using namespace Common;
 
 static const quint64 TIMEOUT_RECEIVE_DATA = 30 * 1000;
 static const quint64 TIMEOUT_TRANSMIT_DATA = 30 * 1000;
+static const qint64 READ_BUFFER_SIZE = 64 * 1024;   ///< Размер буфера чтения сокета. Непрочитанные данные сверх него остаются в буфере ядра
+static const quint64 WEBSOCKET_PING_INTERVAL = 30 * 1000;  ///< Интервал проверки простаивающего соединения WebSocket
+static const qsizetype STREAM_BATCH_SIZE = 1000;    ///< Количество свечей, которое выбирается из хранилища за один раз при передаче ответа частями
+
+static std::atomic<qint64> totalPendingWriteBytes = 0; ///< Объем ответов всех соединений сервера, ожидающих передачи
+
+Q_GLOBAL_STATIC_WITH_ARGS(const QString, METRICS_PATH, ("/metrics"));
+Q_GLOBAL_STATIC_WITH_ARGS(const QString, METRICS_CONTENT_TYPE, ("text/plain; version=0.0.4; charset=utf-8"));
+
+/*!
+    Возвращает ключ варианта ответа в кеше сериализованных ответов
+    @param path - путь запроса
+    @param format - формат ответа
+    @return ключ варианта
+*/
+static QString answerVariant(const QString& path, PackageFormat format)
+{
+    return QString("%1?format=%2").arg(path).arg(static_cast<int>(format));
+}
 
-SocketThread::SocketThread(quint64 id, const HTTPServerConfig &serverConfig, const TradingCatCommon::TradingData& data, QObject *parent /* = nullptr */)
+///////////////////////////////////////////////////////////////////////////////
+///     The SocketThread::KLinesStream struct - состояние ответа, передаваемого частями
+///
+struct SocketThread::KLinesStream
+{
+    KLinesStream(const StockExchangeID& stockExchangeIdValue, const KLineID& klineIdValue, qint64 startValue, qint64 endValue)
+        : stockExchangeId(stockExchangeIdValue)
+        , klineId(klineIdValue)
+        , start(startValue)
+        , end(endValue)
+    {
+    }
+
+    const StockExchangeID stockExchangeId;  ///< ИД биржи
+    const KLineID klineId;                  ///< ИД свечи
+    const qint64 start = 0;                 ///< Время начала периода (мсек epoch)
+    qint64 end = 0;                         ///< Время конца еще не переданной части периода (мсек epoch)
+
+    QByteArray buffer;                      ///< Данные очередной части ответа
+    JsonWriter writer{buffer};              ///< Запись JSON. Состояние сохраняется между частями ответа
+    std::unique_ptr<StreamCompressor> compressor;   ///< Сжатие частей ответа. nullptr - ответ не сжимается
+
+    size_t metricsRoute = 0;                ///< Номер маршрута запроса в метриках
+    qint64 received = 0;                    ///< Размер запроса
+    qint64 sent = 0;                        ///< Объем переданного ответа
+    std::chrono::steady_clock::time_point requestStart;   ///< Время приема первого байта запроса
+};
+
+SocketThread::SocketThread(quint64 id, const HTTPServerConfig &serverConfig, const TradingCatCommon::TradingData& data,
+                           AdmissionControl* admissionControl /* = nullptr */, PushChannel* pushChannel /* = nullptr */,
+                           ServerMetrics::ThreadMetrics* metrics /* = nullptr */, QObject *parent /* = nullptr */)
     : QObject(parent)
     , _id(id)
     , _serverConfig(serverConfig)
     , _data(data)
+    , _admissionControl(admissionControl)
+    , _pushChannel(pushChannel)
+    , _metrics(metrics)
 {
 }
 
@@ -38,29 +95,48 @@ quint64 SocketThread::id() const noexcept
 
 void SocketThread::stop()
 {
-
+    finishSocket();
 }
 
 void SocketThread::startSocket(qintptr handle)
 {
     _isFirstPacket = true;
+    _isClosing = false;
+    _isReadPaused = false;
+    _requestsCount = 0;
+    _pendingWriteBytes = 0;
+    _isWebSocket = false;
+    _pushSessionId = 0;
+    _pushCursor = 0;
+    _isPushKLines = false;
+    _handle = handle;
+    _metricsRoute = metricsRoute(ServiceRoute::OTHER);
+    _requestStart = std::chrono::steady_clock::now();
 
     //Создаем сокет
-    _tcpSocket = new QTcpSocket();
+    _tcpSocket = new QTcpSocket(this);
     _tcpSocket->setSocketDescriptor(handle);
+    _tcpSocket->setReadBufferSize(READ_BUFFER_SIZE); //пока чтение приостановлено, клиента сдерживает TCP
+    _clientAddress = _tcpSocket->peerAddress().toString();
 
     QObject::connect(_tcpSocket, SIGNAL(readyRead()), this, SLOT(readyRead()));  //пришли новые данные
+    QObject::connect(_tcpSocket, SIGNAL(bytesWritten(qint64)), this, SLOT(bytesWritten(qint64)));  //данные переданы в сеть
     QObject::connect(_tcpSocket, SIGNAL(errorOccurred(QAbstractSocket::SocketError)),
                      this, SLOT(errorOccurred(QAbstractSocket::SocketError)));  //ошибка соединения
 
     //Создаем ватчдог
-    _watchDog = new QTimer();
+    _watchDog = new QTimer(this);
     _watchDog->setSingleShot(true);
 
     QObject::connect(_watchDog, SIGNAL(timeout()), this, SLOT(timeout()));  //таймаут соединения
 
     _request = new HTTPRequest(); //Класс приемник данных;
 
+    if (_metrics != nullptr)
+    {
+        _metrics->addConnections(1);
+    }
+
     emit sendLogMsg(Common::TDBLoger::MSG_CODE::INFORMATION_CODE,
                     QString("%1 Incomming connect. Client: %2:%3")
                         .arg(handle)
@@ -70,50 +146,292 @@ void SocketThread::startSocket(qintptr handle)
    _watchDog->start(TIMEOUT_RECEIVE_DATA); //запускаем WatchDog
 }
 
+void SocketThread::rejectSocket(qintptr handle, quint16 code, const QByteArray& msg)
+{
+    startSocket(handle);
+
+    _isClosing = true;
+    sendAnswer(code, msg);
+}
+
+const QHash<QString, SocketThread::Route>& SocketThread::routes()
+{
+    //Объекты запросов создаются только для получения путей, один раз за время работы сервера
+    static const QHash<QString, Route> routes = []()
+    {
+        QHash<QString, Route> result;
+
+        //Номер маршрута в метриках - порядок добавления
+        const auto addRoute = [&result](const QString& path, RouteHandler handler, RequestClass requestClass)
+        {
+            result.insert(path, Route{handler, requestClass, static_cast<size_t>(result.size())});
+        };
+
+        addRoute(ServerStatusQuery().path(), &SocketThread::serverStatus, RequestClass::STATUS);
+        addRoute(StockExchangesQuery().path(), &SocketThread::stockExchangeList, RequestClass::LIST);
+        addRoute(KLinesListQuery().path(), &SocketThread::klineList, RequestClass::LIST);
+        addRoute(KLineNewQuery().path(), &SocketThread::klineNew, RequestClass::DETECT);
+        addRoute(KLineHistoryQuery().path(), &SocketThread::klineHistory, RequestClass::HISTORY);
+
+        return result;
+    }();
+
+    return routes;
+}
+
+const SocketThread::Route* SocketThread::findRoute(const QString& path)
+{
+    const auto& routes = SocketThread::routes();
+    const auto routes_it = routes.find(path);
+
+    return routes_it != routes.end() ? &routes_it.value() : nullptr;
+}
+
+size_t SocketThread::metricsRoute(ServiceRoute route)
+{
+    return static_cast<size_t>(routes().size()) + static_cast<size_t>(route);
+}
+
+QStringList SocketThread::metricsRoutes()
+{
+    const auto& routes = SocketThread::routes();
+
+    QStringList result(routes.size() + 3);
+    for (auto routes_it = routes.begin(); routes_it != routes.end(); ++routes_it)
+    {
+        result[routes_it.value().metricsRoute] = routes_it.key();
+    }
+    result[metricsRoute(ServiceRoute::PUSH)] = PushQuery().path();
+    result[metricsRoute(ServiceRoute::METRICS)] = *METRICS_PATH;
+    result[metricsRoute(ServiceRoute::OTHER)] = "other";
+
+    return result;
+}
+
 void SocketThread::parseResource()
 {
     const auto& resource = _request->resurce();
-    const auto path = resource.path();
+
+    //HTTPRequest отбрасывает начальный '/' ресурса, а пути маршрутов начинаются с него
+    auto path = resource.path();
+    if (!path.startsWith('/'))
+    {
+        path.prepend('/');
+    }
+
+    //Подписка на события не является обычным запросом: соединение переходит в режим WebSocket
+    static const auto pushPath = PushQuery().path();
+    if (path == pushPath)
+    {
+        _metricsRoute = metricsRoute(ServiceRoute::PUSH);
+        upgradeWebSocket(QUrlQuery(resource.query()));
+
+        return;
+    }
+
+    if (path == *METRICS_PATH && _metrics != nullptr)
+    {
+        _metricsRoute = metricsRoute(ServiceRoute::METRICS);
+        if (admitRequest(_clientAddress, RequestClass::STATUS))
+        {
+            sendAnswer(200, metrics(), *METRICS_CONTENT_TYPE);
+        }
+
+        return;
+    }
+
+    const auto route = findRoute(path);
+    if (route == nullptr)
+    {
+        sendAnswer(404, QString("%1 not found\n\r").arg(path).toUtf8());
+
+        return;
+    }
+
+    _metricsRoute = route->metricsRoute;
+
+    if (!admitRequest(_clientAddress, route->requestClass))
+    {
+        return;
+    }
+
+    //Параметры запроса разбираются только для найденного и допущенного маршрута
     const auto query = QUrlQuery(resource.query());
-    if (path == ServerStatusQuery().path())
+    const auto format = acceptToPackageFormat(_request->header("Accept"));
+    const auto& contentType = packageFormatToContentType(format);
+    auto encoding = _serverConfig.compressionMode != CompressionMode::NONE ? _request->acceptEncoding() : ContentEncoding::IDENTITY;
+
+    const auto answer = (this->*route->handler)(query, format, encoding);
+
+    //Обработчик создал поток - ответ передается частями
+    if (_stream)
     {
-        sendAnswer(200, serverStatus().toUtf8());
+        startStream(contentType, encoding);
+
+        return;
     }
-    else if (path == StockExchangesQuery().path())
+
+    //Ответ с ETag можно проверить повторно: клиент, у которого уже есть этот ответ, получает 304 без тела
+    if (!_answerETag.isEmpty())
     {
-        sendAnswer(200, stockExchangeList().toUtf8());
+        const auto eTag = std::exchange(_answerETag, QString());
+        if (isNotModified(eTag))
+        {
+            sendAnswer(304, QByteArray(), contentType, ContentEncoding::IDENTITY, {{"ETag", eTag}});
+
+            return;
+        }
+
+        sendAnswer(200, answer, contentType, encoding, {{"ETag", eTag}});
+
+        return;
     }
-    else if (path == KLinesListQuery().path())
+
+    sendAnswer(200, answer, contentType, encoding);
+}
+
+bool SocketThread::admitRequest(const QString& client, RequestClass requestClass)
+{
+    if (_admissionControl == nullptr)
     {
-        sendAnswer(200, klineList(query).toUtf8());
+        return true;
     }
-    else if (path == KLineNewQuery().path())
+
+    const auto load = static_cast<double>(totalPendingWriteBytes.load(std::memory_order_relaxed)) / static_cast<double>(_serverConfig.maxPendingWriteBytes);
+    const auto decision = _admissionControl->admit(client, requestClass, load);
+    if (decision.isAdmitted())
     {
-        sendAnswer(200, klineNew(query).toUtf8());
+        return true;
     }
-    else if (path == KLineHistoryQuery().path())
+
+    sendAnswer(decision.code, decision.code == 429 ? "Too Many Requests" : "Service Unavailable", *JSON_CONTENT_TYPE, ContentEncoding::IDENTITY,
+               {{"Retry-After", QString::number(decision.retryAfter)}});
+
+    return false;
+}
+
+QByteArray SocketThread::encodeAnswer(const QByteArray& answer, ContentEncoding& encoding) const
+{
+    if (encoding == ContentEncoding::IDENTITY || answer.size() < _serverConfig.compressionThreshold)
     {
-        sendAnswer(200, klineHistory(query).toUtf8());
+        encoding = ContentEncoding::IDENTITY;
+
+        return answer;
     }
-    else
+
+    auto compressedAnswer = compressData(answer, encoding, _serverConfig.compressionLevel);
+    if (compressedAnswer.isEmpty())
     {
-        sendAnswer(404, QString("%1 not found\n\r").arg(path).toUtf8());
+        encoding = ContentEncoding::IDENTITY;
+
+        return answer;
+    }
+
+    return compressedAnswer;
+}
+
+QByteArray SocketThread::cachedAnswer(const StockExchangeID& stockExchangeId, const QString& variant, const TradingData::AnswerMaker& make, ContentEncoding& encoding)
+{
+    const auto answer = _data.cachedAnswer(stockExchangeId, variant, make, &_answerETag);
+
+    //Клиент уже получил этот ответ - сжимать и передавать его не нужно
+    if (isNotModified(_answerETag))
+    {
+        encoding = ContentEncoding::IDENTITY;
+
+        return QByteArray();
+    }
+
+    if (_serverConfig.compressionMode != CompressionMode::CACHED ||
+        encoding == ContentEncoding::IDENTITY ||
+        answer->size() < _serverConfig.compressionThreshold)
+    {
+        return encodeAnswer(*answer, encoding);
+    }
+
+    //Сжатый вариант хранится в кеше рядом с исходным и сбрасывается вместе с ним
+    const auto compressedAnswer = _data.cachedAnswer(stockExchangeId, QString("%1&encoding=%2").arg(variant).arg(contentEncodingToString(encoding)),
+        [this, &answer, encoding]()
+        {
+            return compressData(*answer, encoding, _serverConfig.compressionLevel);
+        });
+
+    if (compressedAnswer->isEmpty())
+    {
+        encoding = ContentEncoding::IDENTITY;
+
+        return *answer;
+    }
+
+    return *compressedAnswer;
+}
+
+bool SocketThread::isNotModified(const QString& eTag) const
+{
+    Q_CHECK_PTR(_request);
+
+    const auto ifNoneMatch = _request->header("If-None-Match");
+    if (ifNoneMatch.isEmpty() || eTag.isEmpty())
+    {
+        return false;
+    }
+
+    //If-None-Match сравнивается слабым сравнением: префикс W/ не учитывается
+    const auto opaqueTag = [](QStringView tag)
+    {
+        return tag.startsWith(QLatin1String("W/")) ? tag.mid(2) : tag;
+    };
+
+    for (const auto& tag: QStringView(ifNoneMatch).split(','))
+    {
+        const auto trimmedTag = tag.trimmed();
+        if (trimmedTag == QLatin1String("*") || opaqueTag(trimmedTag) == opaqueTag(eTag))
+        {
+            return true;
+        }
     }
+
+    return false;
 }
 
-void SocketThread::sendAnswer(quint16 code, const QByteArray& msg)
+void SocketThread::sendAnswer(quint16 code, const QByteArray& msg, const QString& contentType /* = *JSON_CONTENT_TYPE */,
+                              ContentEncoding encoding /* = ContentEncoding::IDENTITY */, const QHash<QString, QString>& headers /* = {} */)
 {
     Q_CHECK_PTR(_tcpSocket);
 
+    //Ответы, ожидающие передачи медленным клиентам, не должны исчерпать память сервера
+    if (code == 200 && totalPendingWriteBytes.load(std::memory_order_relaxed) + msg.size() > _serverConfig.maxPendingWriteBytes)
+    {
+        emit sendLogMsg(TDBLoger::MSG_CODE::WARNING_CODE,
+                        QString("%1 Server write buffers limit exceeded: %2 B. Answer rejected").arg(_handle).arg(_serverConfig.maxPendingWriteBytes));
+
+        _isClosing = true;
+        sendAnswer(503, "Service Unavailable");
+
+        return;
+    }
+
     HTTPAnswer answer(code);
-    answer.addBody(msg);
+    answer.addHeader("Content-Type", contentType);
+    answer.addBody(msg, encoding);
+    for (auto headers_it = headers.begin(); headers_it != headers.end(); ++headers_it)
+    {
+        answer.addHeader(headers_it.key(), headers_it.value());
+    }
+
+    addConnectionHeaders(answer);
 
-    const auto  sendBytes = _tcpSocket->write(answer.getAnswer());
-    if (!_tcpSocket->waitForBytesWritten(TIMEOUT_TRANSMIT_DATA))  //ждем записи данных в буфер
+    //Запись не блокирует поток: ответ остается в буфере сокета и передается по мере готовности сети.
+    //Если соединение не постоянное - оно закрывается в bytesWritten() после передачи всего ответа
+    const auto data = answer.getAnswer();
+    writeData(data);
+
+    if (_metrics != nullptr)
     {
-        const auto msg = QString("Data transmitting timeout. Transmit: %1 bytes").arg(sendBytes);
+        const auto latency = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - _requestStart).count();
+        const auto received = _request != nullptr ? (_request->isGetHeader() ? static_cast<qint64>(_request->expectedSize()) : _request->size()) : 0;
 
-        emit sendLogMsg(TDBLoger::MSG_CODE::WARNING_CODE, QString("%1 %2").arg(_handle).arg(msg));
+        _metrics->addRequest(_metricsRoute, code, received, data.size(), static_cast<quint64>(latency));
     }
 
 /*    emit sendLogMsg(code == 200 ? TDBLoger::MSG_CODE::INFORMATION_CODE : TDBLoger::MSG_CODE::WARNING_CODE,
@@ -125,24 +443,523 @@ void SocketThread::sendAnswer(quint16 code, const QByteArray& msg)
                         .arg(code == 200 ? "" : QString(". Message: %1").arg(msg)));
 */
 
-    finishSocket();
+    if (_isClosing && _tcpSocket->bytesToWrite() == 0)
+    {
+        finishSocket();
+
+        return;
+    }
+
+    restartWatchDog();
+}
+
+void SocketThread::addConnectionHeaders(HTTPAnswer& answer)
+{
+    //Соединение остается открытым для следующих запросов, если клиент не запросил закрытие
+    //и не исчерпан лимит запросов на одно соединение
+    const bool isKeepAlive = !_isClosing && _request != nullptr && _request->isKeepAlive() &&
+                             ++_requestsCount < _serverConfig.keepAliveMaxRequests;
+    _isClosing = !isKeepAlive;
+    if (isKeepAlive)
+    {
+        answer.addHeader("Connection", "keep-alive");
+        answer.addHeader("Keep-Alive", QString("timeout=%1, max=%2")
+                                           .arg(_serverConfig.keepAliveTimeout / 1000)
+                                           .arg(_serverConfig.keepAliveMaxRequests - _requestsCount));
+    }
+    else
+    {
+        answer.addHeader("Connection", "close");
+    }
+}
+
+void SocketThread::startStream(const QString& contentType, ContentEncoding encoding)
+{
+    Q_CHECK_PTR(_tcpSocket);
+    Q_CHECK_PTR(_request);
+    Q_CHECK_PTR(_stream);
+
+    //Передача частями ограничивает только объем ответа соединения, общий лимит проверяется один раз перед началом
+    if (totalPendingWriteBytes.load(std::memory_order_relaxed) >= _serverConfig.maxPendingWriteBytes)
+    {
+        _stream.reset();
+
+        emit sendLogMsg(TDBLoger::MSG_CODE::WARNING_CODE,
+                        QString("%1 Server write buffers limit exceeded: %2 B. Answer rejected").arg(_handle).arg(_serverConfig.maxPendingWriteBytes));
+
+        _isClosing = true;
+        sendAnswer(503, "Service Unavailable");
+
+        return;
+    }
+
+    if (encoding != ContentEncoding::IDENTITY)
+    {
+        _stream->compressor = std::make_unique<StreamCompressor>(encoding, _serverConfig.compressionLevel);
+        if (_stream->compressor->isError())
+        {
+            _stream->compressor.reset();
+            encoding = ContentEncoding::IDENTITY;
+        }
+    }
+
+    HTTPAnswer answer(200);
+    answer.addHeader("Content-Type", contentType);
+    answer.addHeader("Transfer-Encoding", "chunked");
+    answer.addBody(QByteArray(), encoding);
+    addConnectionHeaders(answer);
+
+    const auto head = answer.getAnswer();
+    writeData(head);
+
+    //Следующий запрос соединения может быть принят до завершения передачи, поэтому данные для метрик сохраняем в потоке
+    _stream->metricsRoute = _metricsRoute;
+    _stream->received = static_cast<qint64>(_request->expectedSize());
+    _stream->sent = head.size();
+    _stream->requestStart = _requestStart;
+
+    auto& writer = _stream->writer;
+    writer.beginObject();
+    writer.key("Data");
+    writer.beginArray();
+
+    streamNext();
+}
+
+void SocketThread::streamNext()
+{
+    Q_CHECK_PTR(_tcpSocket);
+    Q_CHECK_PTR(_stream);
+
+    auto& stream = *_stream;
+    bool isFinish = false;
+
+    //В памяти находится не больше одной выборки свечей и непереданные данные соединения
+    while (!isFinish && _tcpSocket->bytesToWrite() < _serverConfig.writeHighWatermark)
+    {
+        const auto klines = _data.getKLinesOnDate(stream.stockExchangeId, stream.klineId, stream.start, stream.end, STREAM_BATCH_SIZE);
+        for (const auto& kline: *klines)
+        {
+            KLineJson(kline).writeJson(stream.writer);
+        }
+
+        //Свечи выбираются от новых к старым, следующая выборка заканчивается перед самой старой переданной свечей
+        isFinish = klines->size() < static_cast<size_t>(STREAM_BATCH_SIZE) || klines->back()->closeTime <= stream.start;
+        if (!isFinish)
+        {
+            stream.end = klines->back()->closeTime - 1;
+        }
+        else
+        {
+            stream.writer.endArray();
+            stream.writer.key("Status");
+            StatusAnswer(StatusAnswer::ErrorCode::OK).writeJson(stream.writer);
+            stream.writer.endObject();
+            stream.buffer.append("\n\r", 2);
+        }
+
+        if (!writeStreamChunk(isFinish))
+        {
+            return;
+        }
+    }
+
+    if (!isFinish)
+    {
+        restartWatchDog();
+
+        return;
+    }
+
+    if (_metrics != nullptr)
+    {
+        const auto latency = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - stream.requestStart).count();
+
+        _metrics->addRequest(stream.metricsRoute, 200, stream.received, stream.sent, static_cast<quint64>(latency));
+    }
+
+    _stream.reset();
+
+    if (_isClosing && _tcpSocket->bytesToWrite() == 0)
+    {
+        finishSocket();
+
+        return;
+    }
+
+    restartWatchDog();
+}
+
+bool SocketThread::writeStreamChunk(bool isFinish)
+{
+    Q_CHECK_PTR(_stream);
+
+    auto& stream = *_stream;
+
+    QByteArray data;
+    if (stream.compressor)
+    {
+        data = stream.compressor->compress(stream.buffer, isFinish);
+        if (stream.compressor->isError())
+        {
+            //Заголовок уже передан, сообщить клиенту об ошибке можно только закрыв соединение до завершающей части
+            emit sendLogMsg(TDBLoger::MSG_CODE::WARNING_CODE, QString("%1 Error compressing chunked answer").arg(_handle));
+
+            finishSocket();
+
+            return false;
+        }
+    }
+    else
+    {
+        data = stream.buffer;
+    }
+
+    //Буфер сохраняет выделенную память для следующей части
+    stream.buffer.resize(0);
+
+    //Пустая часть означает конец ответа, поэтому пустые данные не передаем
+    if (!data.isEmpty())
+    {
+        const auto chunk = HTTPAnswer::chunk(data);
+        writeData(chunk);
+        stream.sent += chunk.size();
+    }
+
+    if (isFinish)
+    {
+        const auto lastChunk = HTTPAnswer::chunk(QByteArray());
+        writeData(lastChunk);
+        stream.sent += lastChunk.size();
+    }
+
+    return true;
+}
+
+void SocketThread::writeData(const QByteArray& data)
+{
+    Q_CHECK_PTR(_tcpSocket);
+
+    _pendingWriteBytes += data.size();
+    totalPendingWriteBytes.fetch_add(data.size(), std::memory_order_relaxed);
+
+    _tcpSocket->write(data);
+}
+
+void SocketThread::restartWatchDog()
+{
+    Q_CHECK_PTR(_watchDog);
+    Q_CHECK_PTR(_request);
+
+    if (_tcpSocket->bytesToWrite() > 0)
+    {
+        //Прием данных от клиента не продлевает таймаут передачи: клиент, который отправляет запросы
+        //и не забирает ответы, должен закрываться по таймауту
+        if (!_isTransmitTimeout || !_watchDog->isActive())
+        {
+            _isTransmitTimeout = true;
+            _watchDog->start(TIMEOUT_TRANSMIT_DATA);
+        }
+
+        return;
+    }
+
+    _isTransmitTimeout = false;
+
+    if (_isWebSocket)
+    {
+        //Соединение WebSocket не ограничено по времени простоя, периодически проверяем что клиент доступен
+        _watchDog->start(WEBSOCKET_PING_INTERVAL);
+    }
+    else if (_request->size() > 0)
+    {
+        _watchDog->start(TIMEOUT_RECEIVE_DATA);
+    }
+    else
+    {
+        _watchDog->start(_serverConfig.keepAliveTimeout);
+    }
+}
+
+void SocketThread::upgradeWebSocket(const QUrlQuery& query)
+{
+    Q_CHECK_PTR(_request);
+
+    if (_pushChannel == nullptr)
+    {
+        sendAnswer(404, QString("%1 not found\n\r").arg(_request->resurce().path()).toUtf8());
+
+        return;
+    }
+
+    const auto upgrade = _request->headerView(QLatin1String("Upgrade"));
+    const auto key = _request->header("Sec-WebSocket-Key").toLatin1();
+    if (QLatin1String(upgrade.data(), upgrade.size()).compare(QLatin1String("websocket"), Qt::CaseInsensitive) != 0 || key.isEmpty())
+    {
+        _isClosing = true;
+        sendAnswer(426, "WebSocket upgrade required");
+
+        return;
+    }
+
+    if (_request->header("Sec-WebSocket-Version") != "13")
+    {
+        _isClosing = true;
+        sendAnswer(426, "Unsupported WebSocket version. Expected: 13");
+
+        return;
+    }
+
+    PushQuery queryData(query);
+    if (queryData.isError())
+    {
+        _isClosing = true;
+        sendAnswer(400, QString("Incorrect request. %1").arg(queryData.errorString()).toUtf8());
+
+        return;
+    }
+
+    //ИД сессии приходит от клиента, поэтому бюджет подписки считается по адресу клиента, как у остальных запросов
+    if (!admitRequest(_clientAddress, RequestClass::DETECT))
+    {
+        return;
+    }
+
+    //События сессии получает только клиент, знающий ИД открытой сессии
+    if (!_pushChannel->isSession(queryData.sessionId()))
+    {
+        _isClosing = true;
+        sendAnswer(403, QString("Session %1 is not open").arg(queryData.sessionId()).toUtf8());
+
+        return;
+    }
+
+    HTTPAnswer answer(101);
+    answer.addHeader("Upgrade", "websocket");
+    answer.addHeader("Connection", "Upgrade");
+    answer.addHeader("Sec-WebSocket-Accept", QString::fromLatin1(webSocketAcceptKey(key)));
+
+    writeData(answer.getAnswer());
+
+    _isWebSocket = true;
+    if (_metrics != nullptr)
+    {
+        _metrics->addRequest(_metricsRoute, 101, static_cast<qint64>(_request->expectedSize()), 0,
+                             static_cast<quint64>(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - _requestStart).count()));
+        _metrics->addWebSockets(1);
+    }
+
+    _webSocketReader = std::make_unique<WebSocketFrameReader>();
+    _pushSessionId = queryData.sessionId();
+    _pushCursor = queryData.cursor() != 0 ? queryData.cursor() : _pushChannel->cursor(); //новый клиент получает только новые события
+    _isPushKLines = queryData.isKLines();
+
+    //Клиент мог отправить кадры сразу после запроса
+    const auto tail = _request->takeTail();
+
+    delete _request;
+    _request = new HTTPRequest();
+
+    emit sendLogMsg(TDBLoger::MSG_CODE::INFORMATION_CODE,
+                    QString("%1 WebSocket push channel opened. Session: %2. Cursor: %3").arg(_handle).arg(_pushSessionId).arg(_pushCursor));
+
+    //Канал рассылки работает в другом потоке, события забираются в потоке соединения
+    QObject::connect(_pushChannel, SIGNAL(eventsAvailable(quint64)), this, SLOT(pushEvents()));
+    QObject::connect(_pushChannel, SIGNAL(sessionClosed(qint64)), this, SLOT(pushEvents()));
+
+    if (!tail.isEmpty())
+    {
+        readWebSocket(tail);
+    }
+
+    //Передаем события, накопленные после курсора клиента
+    pushEvents();
+}
+
+void SocketThread::readWebSocket(const QByteArray& data)
+{
+    Q_CHECK_PTR(_webSocketReader);
+
+    _webSocketReader->add(data);
+
+    while (_tcpSocket != nullptr && !_isClosing)
+    {
+        //Клиент не забирает ответы на PING - следующие кадры не читаем до освобождения буфера записи,
+        //непрочитанные данные остаются в буфере сокета
+        if (_tcpSocket->bytesToWrite() >= _serverConfig.writeHighWatermark)
+        {
+            _isReadPaused = true;
+            if (_metrics != nullptr)
+            {
+                _metrics->addPaused(1);
+            }
+
+            break;
+        }
+
+        const auto frame = _webSocketReader->next();
+        if (!frame.has_value())
+        {
+            if (_webSocketReader->isError())
+            {
+                emit sendLogMsg(TDBLoger::MSG_CODE::WARNING_CODE,
+                                QString("%1 Incorrect WebSocket frame: %2").arg(_handle).arg(_webSocketReader->errorString()));
+
+                //1002 - ошибка протокола
+                _isClosing = true;
+                writeData(makeWebSocketFrame(WebSocketOpCode::CLOSE, QByteArray::fromHex("03ea")));
+            }
+
+            break;
+        }
+
+        switch (frame->opCode)
+        {
+        case WebSocketOpCode::PING:
+            writeData(makeWebSocketFrame(WebSocketOpCode::PONG, frame->payload));
+            break;
+        case WebSocketOpCode::CLOSE:
+            //Отвечаем тем же кодом закрытия и закрываем соединение после передачи
+            _isClosing = true;
+            writeData(makeWebSocketFrame(WebSocketOpCode::CLOSE, frame->payload.left(2)));
+            break;
+        default:
+            //Клиент только получает события, данные от клиента не ожидаются
+            break;
+        }
+    }
+
+    if (_tcpSocket == nullptr)
+    {
+        return;
+    }
+
+    if (_isClosing && _tcpSocket->bytesToWrite() == 0)
+    {
+        finishSocket();
+
+        return;
+    }
+
+    restartWatchDog();
+}
+
+void SocketThread::pushEvents()
+{
+    Q_CHECK_PTR(_pushChannel);
+
+    if (_tcpSocket == nullptr || !_isWebSocket || _isClosing)
+    {
+        return;
+    }
+
+    //Очередь передачи соединения ограничена буфером записи. Медленный клиент отстает по курсору,
+    //а события остаются в журнале канала
+    bool isWrite = false;
+    while (_tcpSocket->bytesToWrite() < _serverConfig.writeHighWatermark &&
+           totalPendingWriteBytes.load(std::memory_order_relaxed) < _serverConfig.maxPendingWriteBytes)
+    {
+        const auto events = _pushChannel->eventsAfter(_pushCursor, _pushSessionId, _isPushKLines,
+                                                      _serverConfig.writeHighWatermark - _tcpSocket->bytesToWrite());
+        if (events.isClosed)
+        {
+            emit sendLogMsg(TDBLoger::MSG_CODE::INFORMATION_CODE,
+                            QString("%1 WebSocket push channel closed. Session %2 is not open").arg(_handle).arg(_pushSessionId));
+
+            //1008 - нарушение политики: сессия закрыта, права на события больше нет
+            _isClosing = true;
+            writeData(makeWebSocketFrame(WebSocketOpCode::CLOSE, QByteArray::fromHex("03f0")));
+            restartWatchDog(); //соединение закрывается в bytesWritten() после передачи кадра
+
+            return;
+        }
+
+        if (events.isLost)
+        {
+            emit sendLogMsg(TDBLoger::MSG_CODE::WARNING_CODE,
+                            QString("%1 WebSocket client is too slow. Events after %2 lost").arg(_handle).arg(_pushCursor));
+
+            writeData(PushChannel::lostFrame(_pushCursor));
+            isWrite = true;
+        }
+
+        for (const auto& frame: events.frames)
+        {
+            writeData(*frame);
+            isWrite = true;
+
+            if (_metrics != nullptr)
+            {
+                _metrics->addSent(metricsRoute(ServiceRoute::PUSH), frame->size());
+            }
+        }
+
+        if (events.cursor == _pushCursor)
+        {
+            break;
+        }
+
+        _pushCursor = events.cursor;
+    }
+
+    if (isWrite)
+    {
+        restartWatchDog();
+    }
 }
 
 void SocketThread::finishSocket()
 {
+    if (_tcpSocket == nullptr)
+    {
+        return;
+    }
+
+    //Непереданные данные больше не учитываются в общем объеме
+    totalPendingWriteBytes.fetch_sub(_pendingWriteBytes, std::memory_order_relaxed);
+    _pendingWriteBytes = 0;
+
     //вызываем дисконнект
+    _tcpSocket->disconnect(this);
     if (_tcpSocket->isOpen())
     {
         _tcpSocket->disconnectFromHost();
     }
 
-    delete _tcpSocket;
+    //Метод может вызываться из обработчиков сигналов сокета и таймера, поэтому удаляем их отложенно
+    _tcpSocket->deleteLater();
     _tcpSocket = nullptr;
 
     delete _request;
     _request = nullptr;
 
-    delete _watchDog;
+    _stream.reset();
+
+    if (_isWebSocket)
+    {
+        QObject::disconnect(_pushChannel, nullptr, this, nullptr);
+
+        _webSocketReader.reset();
+        _isWebSocket = false;
+
+        if (_metrics != nullptr)
+        {
+            _metrics->addWebSockets(-1);
+        }
+    }
+
+    if (_metrics != nullptr)
+    {
+        _metrics->addConnections(-1);
+        if (_isReadPaused)
+        {
+            _metrics->addPaused(-1);
+        }
+    }
+    _isReadPaused = false;
+
+    _watchDog->stop();
+    _watchDog->deleteLater();
     _watchDog = nullptr;
 
     //Сообщаем о завершении
@@ -151,41 +968,200 @@ void SocketThread::finishSocket()
 
 void SocketThread::readyRead()
 {
-     //перезапускаем WatchDog
-    _watchDog->stop();
+    //Соединение закрывается после передачи ответа. Остальные данные игнорируем
+    if (_isClosing)
+    {
+        _tcpSocket->readAll();
+
+        return;
+    }
+
+    //Клиент не успевает забирать ответы. Новые запросы не читаем до освобождения буфера записи
+    //или до завершения передачи ответа частями
+    if (_isReadPaused || _stream)
+    {
+        return;
+    }
+
+    if (_isWebSocket)
+    {
+        readWebSocket(_tcpSocket->readAll());
+
+        return;
+    }
 
-    //считываем пришедшие данные
+    //считываем пришедшие данные. Заголовок запроса может прийти в нескольких фрагментах
+    if (_request->size() == 0)
+    {
+        _requestStart = std::chrono::steady_clock::now();
+    }
     _request->add(_tcpSocket->readAll());
-    if (_isFirstPacket)
+    _isFirstPacket = false;
+
+    processRequests();
+}
+
+void SocketThread::processRequests()
+{
+    //Обрабатываем все полностью принятые запросы. Клиент может отправить следующий запрос не дожидаясь ответа (pipelining),
+    //ответы отправляются в порядке поступления запросов
+    while (_tcpSocket != nullptr && !_isClosing && !_isWebSocket && !_stream)
     {
-        _isFirstPacket = false;
+        if (_request->isError())
+        {
+            _isClosing = true;
+            sendAnswer(_request->errorCode(), QString("Incorrect request. %1").arg(_request->errorMsg()).toUtf8());
+
+            return;
+        }
 
-        if (!_request->isGetHeader())
+        if (!_request->isComplite())
         {
+            break;
+        }
 
-            sendAnswer(_request->errorCode(), QString("Incorrect request. %1").arg(_request->errorMsg()).toUtf8());
+        if (_tcpSocket->bytesToWrite() >= _serverConfig.writeHighWatermark)
+        {
+            _isReadPaused = true;
+            if (_metrics != nullptr)
+            {
+                _metrics->addPaused(1);
+            }
 
+            break;
+        }
+
+        parseResource();
+
+        if (_tcpSocket == nullptr || _isClosing || _isWebSocket)
+        {
             return;
         }
+
+        //Данные следующего запроса уже могли быть приняты
+        const auto tail = _request->takeTail();
+
+        delete _request;
+        _request = new HTTPRequest();
+        _metricsRoute = metricsRoute(ServiceRoute::OTHER);
+        _requestStart = std::chrono::steady_clock::now();
+
+        if (!tail.isEmpty())
+        {
+            _request->add(tail);
+        }
     }
 
-    //если пришли все данные
-    if (_request->isComplite())
+    if (_tcpSocket != nullptr)
     {
-        if (_request->errorCode() != 200)
-        {
-            sendAnswer(_request->errorCode(), _request->errorMsg().toUtf8());
+        restartWatchDog();
+    }
+}
+
+void SocketThread::bytesWritten(qint64 bytes)
+{
+    _pendingWriteBytes -= bytes;
+    totalPendingWriteBytes.fetch_sub(bytes, std::memory_order_relaxed);
 
+    const auto bytesToWrite = _tcpSocket->bytesToWrite();
+
+    //Клиент забирает данные - продлеваем таймаут передачи
+    if (bytesToWrite > 0)
+    {
+        _isTransmitTimeout = true;
+        _watchDog->start(TIMEOUT_TRANSMIT_DATA);
+    }
+
+    //Клиент забрал достаточно данных ответа, передаваемого частями - передаем следующие части.
+    //После завершения ответа продолжаем обработку запросов
+    if (_stream && bytesToWrite <= _serverConfig.writeLowWatermark)
+    {
+        streamNext();
+
+        if (_tcpSocket == nullptr || _stream)
+        {
             return;
         }
 
-        parseResource();
+        processRequests();
+
+        if (_tcpSocket != nullptr && !_isReadPaused && !_stream && _tcpSocket->bytesAvailable() > 0)
+        {
+            readyRead();
+        }
+
+        return;
+    }
+
+    //Клиент WebSocket забрал достаточно данных - передаем следующие события
+    if (_isWebSocket && !_isClosing && bytesToWrite <= _serverConfig.writeLowWatermark)
+    {
+        //Возобновляем чтение кадров, приостановленное из-за переполнения буфера записи
+        if (_isReadPaused)
+        {
+            _isReadPaused = false;
+            if (_metrics != nullptr)
+            {
+                _metrics->addPaused(-1);
+            }
+
+            readWebSocket(_tcpSocket->readAll());
+
+            if (_tcpSocket == nullptr || _isClosing)
+            {
+                return;
+            }
+        }
+
+        pushEvents();
+        restartWatchDog();
+
+        return;
+    }
+
+    //Клиент забрал достаточно данных - возобновляем обработку запросов
+    if (_isReadPaused && bytesToWrite <= _serverConfig.writeLowWatermark)
+    {
+        _isReadPaused = false;
+        if (_metrics != nullptr)
+        {
+            _metrics->addPaused(-1);
+        }
+
+        processRequests();
+
+        if (_tcpSocket != nullptr && !_isReadPaused && _tcpSocket->bytesAvailable() > 0)
+        {
+            readyRead();
+        }
+
+        return;
+    }
+
+    if (bytesToWrite > 0)
+    {
+        return;
     }
+
+    if (_isClosing)
+    {
+        finishSocket();
+
+        return;
+    }
+
+    restartWatchDog();
 }
 
 void SocketThread::errorOccurred(QAbstractSocket::SocketError socketError)
 {
-    Q_UNUSED(socketError);
+    //Клиент закрыл постоянное соединение между запросами - штатная ситуация
+    if (socketError == QAbstractSocket::RemoteHostClosedError && (_isWebSocket || (_request->size() == 0 && _tcpSocket->bytesToWrite() == 0)))
+    {
+        finishSocket();
+
+        return;
+    }
 
     emit sendLogMsg(TDBLoger::MSG_CODE::WARNING_CODE,
                     QString("%1 Socket error: %2. Expected to receive: %3 B. Reseived: %4")
@@ -194,72 +1170,136 @@ void SocketThread::errorOccurred(QAbstractSocket::SocketError socketError)
                         .arg(_request->expectedSize())
                         .arg(_request->size()));
 
-    stop();
+    finishSocket();
 }
 
 
 void SocketThread::timeout()
 {
+    if (_tcpSocket->bytesToWrite() > 0)
+    {
+        emit sendLogMsg(TDBLoger::MSG_CODE::WARNING_CODE,
+                        QString("%1 Data transmitting timeout. Not transmitted: %2 B").arg(_handle).arg(_tcpSocket->bytesToWrite()));
+
+        finishSocket();
+
+        return;
+    }
+
+    //Соединение WebSocket простаивает - проверяем доступность клиента. Если клиент недоступен,
+    //ping не будет передан и соединение закроется по таймауту передачи
+    if (_isWebSocket)
+    {
+        writeData(makeWebSocketFrame(WebSocketOpCode::PING, QByteArrayView()));
+        restartWatchDog();
+
+        return;
+    }
+
+    //Постоянное соединение простаивает между запросами
+    if (_request->size() == 0 && !_isFirstPacket)
+    {
+        finishSocket();
+
+        return;
+    }
+
     const auto msg = QString("Data receiving timeout");
 
     emit sendLogMsg(TDBLoger::MSG_CODE::WARNING_CODE, QString("%1 %2").arg(_handle).arg(msg));
 
+    _isClosing = true;
     sendAnswer(524, msg.toUtf8()); //timeout
 }
 
-QString SocketThread::serverStatus() const
+QByteArray SocketThread::serverStatus(const QUrlQuery& query, PackageFormat format, ContentEncoding& encoding)
 {
+    Q_UNUSED(query);
+
     const auto currDateTime = QDateTime::currentDateTime();
     const auto appName = QString("%1 (Total money: %2)")
                              .arg(_serverConfig.name.isEmpty() ? QCoreApplication::applicationName() : _serverConfig.name)
                              .arg(_data.moneyCount());
     ServerStatusJson statusJson(appName, QCoreApplication::applicationVersion(), currDateTime, _serverConfig.startDateTime.secsTo(currDateTime));
 
-    return Package(statusJson).toJson();
+    return encodeAnswer(Package(statusJson).toByteArray(format), encoding);
 }
 
-QString SocketThread::stockExchangeList() const
+QByteArray SocketThread::stockExchangeList(const QUrlQuery& query, PackageFormat format, ContentEncoding& encoding)
 {
-    return Package(_data.getStockExchangeList()).toJson();
+    Q_UNUSED(query);
+
+    //Список бирж не изменяется во время работы, поэтому ответ формируется один раз для каждого формата
+    return cachedAnswer(StockExchangeID(), answerVariant(StockExchangesQuery().path(), format),
+        [this, format]()
+        {
+            return Package(_data.getStockExchangeList()).toByteArray(format);
+        }, encoding);
 }
 
-QString SocketThread::klineList(const QUrlQuery& query) const
+QByteArray SocketThread::klineList(const QUrlQuery& query, PackageFormat format, ContentEncoding& encoding)
 {
     KLinesListQuery queryData(query);
 
     if (queryData.isError())
     {
-        return Package(StatusJson::ErrorCode::BAD_REQUEST, queryData.errorString()).toJson();
+        return encodeAnswer(Package(StatusAnswer::ErrorCode::BAD_REQUEST, queryData.errorString()).toByteArray(format), encoding);
     }
 
-    return Package(_data.getKLineList(queryData.stockExchageId())).toJson();
+    const auto& stockExchangeId = queryData.stockExchageId();
+
+    //Не кешируем ответы для неизвестных бирж, чтобы произвольные запросы не увеличивали кеш
+    if (!_data.stockExcangesIdList().contains(stockExchangeId))
+    {
+        return encodeAnswer(Package(StatusAnswer::ErrorCode::NOT_FOUND, QString("Unknown stock exchange: %1").arg(stockExchangeId.name)).toByteArray(format), encoding);
+    }
+
+    //Ответ перестраивается только после обновления списка свечей биржи
+    return cachedAnswer(stockExchangeId, answerVariant(KLinesListQuery().path(), format),
+        [this, &stockExchangeId, format]()
+        {
+            return Package(_data.getKLineList(stockExchangeId)).toByteArray(format);
+        }, encoding);
 }
 
-QString SocketThread::klineNew(const QUrlQuery& query) const
+QByteArray SocketThread::klineNew(const QUrlQuery& query, PackageFormat format, ContentEncoding& encoding)
 {
-    // KLineNewQuery queryData(query);
-
-    // if (queryData.isError())
-    // {
-    //     return Package(StatusJson::ErrorCode::BAD_REQUEST, queryData.errorString()).toJson();
-    // }
+    Q_UNUSED(query);
 
-    // return Package(_data.getNewKLine(queryData.lastGetId(), queryData.maxCount(), queryData.types())).toJson();
+    //Хранилище не поддерживает выборку новых свечей по курсору - новые свечи рассылаются через PushQuery
+    return encodeAnswer(Package(StatusAnswer::ErrorCode::NOT_FOUND, "New klines are not available by polling. Use push channel").toByteArray(format), encoding);
 }
 
-QString SocketThread::klineHistory(const QUrlQuery& query) const
+QByteArray SocketThread::klineHistory(const QUrlQuery& query, PackageFormat format, ContentEncoding& encoding)
 {
     KLineHistoryQuery queryData(query);
 
     if (queryData.isError())
     {
-        return Package(StatusJson::ErrorCode::BAD_REQUEST, queryData.errorString()).toJson();
+        return encodeAnswer(Package(StatusAnswer::ErrorCode::BAD_REQUEST, queryData.errorString()).toByteArray(format), encoding);
     }
 
-    return Package(_data.getKLinesOnDate(queryData.stockExchangeID(), queryData.klineID(), queryData.start(), queryData.end())).toJson();
-}
+    //Свечи в JSON записываются независимо друг от друга, поэтому ответ передается частями по мере выборки из хранилища.
+    //Двоичный и колоночный форматы требуют данных обо всем списке до начала записи и формируются целиком
+    if (format == PackageFormat::JSON)
+    {
+        _stream = std::make_unique<KLinesStream>(queryData.stockExchangeID(), queryData.klineID(), queryData.start(), queryData.end());
 
+        return QByteArray();
+    }
 
+    return encodeAnswer(Package(_data.getKLinesOnDate(queryData.stockExchangeID(), queryData.klineID(), queryData.start(), queryData.end())).toByteArray(format), encoding);
+}
 
+QByteArray SocketThread::metrics() const
+{
+    Q_CHECK_PTR(_metrics);
+
+    auto result = _metrics->server().toPrometheus();
 
+    result.append("# HELP tradingcat_http_pending_write_bytes Answers waiting to be sent to clients\n");
+    result.append("# TYPE tradingcat_http_pending_write_bytes gauge\n");
+    result.append("tradingcat_http_pending_write_bytes ").append(QByteArray::number(totalPendingWriteBytes.load(std::memory_order_relaxed))).append('\n');
 
+    return result;
+}
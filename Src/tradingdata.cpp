@@ -2,6 +2,8 @@
 #include <QMutex>
 #include <QMutexLocker>
 
+#include "TradingCatCommon/transmitdata.h"
+
 #include "TradingCatCommon/tradingdata.h"
 
 using namespace TradingCatCommon;
@@ -9,6 +11,7 @@ using namespace Common;
 
 Q_GLOBAL_STATIC(QMutex, klinesIDListMutex);
 Q_GLOBAL_STATIC(QMutex, moneyListingMutex);
+Q_GLOBAL_STATIC(QMutex, answersCacheMutex);
 
 TradingData::TradingData(const TradingCatCommon::StockExchangesIDList& stockExcangesIdList, QObject* parent /* = nullptr */)
     : QObject{parent}
@@ -21,6 +24,7 @@ TradingData::TradingData(const TradingCatCommon::StockExchangesIDList& stockExca
     for (const auto& stockExcangesId: _stockExcangesIdList)
     {
         _klinesIdList.emplace(stockExcangesId, std::make_shared<KLinesIDList>());
+        _klinesIdListVersion.emplace(stockExcangesId, 0);
     }
 }
 
@@ -66,6 +70,16 @@ TradingCatCommon::PKLinesList TradingData::getKLinesOnDate(const StockExchangeID
     return _dataKLine->getKLinesOnDate(stockExchangeID, klineID, start, end);
 }
 
+TradingCatCommon::PKLinesList TradingData::getKLinesOnDate(const StockExchangeID &stockExchangeID, const KLineID &klineID, qint64 start, qint64 end, qsizetype maxCount) const
+{
+    Q_ASSERT(!stockExchangeID.isEmpty());
+    Q_ASSERT(!klineID.isEmpty());
+    Q_ASSERT(start <= end);
+    Q_ASSERT(maxCount > 0);
+
+    return _dataKLine->getKLinesOnDate(stockExchangeID, klineID, start, end, maxCount);
+}
+
 qsizetype TradingData::moneyCount() const noexcept
 {
     return _dataKLine->moneyCount();
@@ -103,6 +117,67 @@ const PKLinesIDList &TradingData::getKLinesIDList(const StockExchangeID &stockEx
     return it_klinesIdList->second;
 }
 
+quint64 TradingData::klinesIDListVersion(const StockExchangeID &stockExchangeID) const
+{
+    QMutexLocker<QMutex> klinesIDListLocker(klinesIDListMutex);
+
+    const auto it_klinesIdListVersion = _klinesIdListVersion.find(stockExchangeID);
+    if (it_klinesIdListVersion == _klinesIdListVersion.end())
+    {
+        return 0;
+    }
+
+    return it_klinesIdListVersion->second;
+}
+
+TradingData::PAnswer TradingData::cachedAnswer(const StockExchangeID &stockExchangeID, const QString &variant, const AnswerMaker &make,
+                                               QString* eTag /* = nullptr */) const
+{
+    Q_ASSERT(!variant.isEmpty());
+    Q_ASSERT(make);
+
+    //Версию получаем до формирования ответа, чтобы ответ по устаревшим данным не попал в кеш как актуальный
+    const auto version = klinesIDListVersion(stockExchangeID);
+
+    {
+        QMutexLocker<QMutex> answersCacheLocker(answersCacheMutex);
+
+        const auto it_answersCache = _answersCache.find(stockExchangeID);
+        if (it_answersCache != _answersCache.end())
+        {
+            const auto it_answer = it_answersCache->second.find(variant);
+            if (it_answer != it_answersCache->second.end() && it_answer->version == version)
+            {
+                if (eTag != nullptr)
+                {
+                    //ETag вычисляется при первом запросе и хранится вместе с ответом
+                    if (it_answer->eTag.isEmpty())
+                    {
+                        it_answer->eTag = answerETag(*it_answer->answer);
+                    }
+                    *eTag = it_answer->eTag;
+                }
+
+                return it_answer->answer;
+            }
+        }
+    }
+
+    auto answer = std::make_shared<const QByteArray>(make());
+    const auto answerTag = eTag != nullptr ? answerETag(*answer) : QString();
+    if (eTag != nullptr)
+    {
+        *eTag = answerTag;
+    }
+
+    //Если пока формировался ответ список обновился - запись с устаревшей версией не будет выдана при следующем запросе
+    QMutexLocker<QMutex> answersCacheLocker(answersCacheMutex);
+
+    _answersCache[stockExchangeID].insert(variant, {version, answer, answerTag});
+
+    return answer;
+}
+
 const StockExchangesIDList &TradingData::stockExcangesIdList() const noexcept
 {
     return _stockExcangesIdList;
@@ -138,10 +213,22 @@ void TradingData::getKLinesID(const StockExchangeID& stockExchangeId, const PKLi
     auto& stokExchangeKLinesId = _klinesIdList.at(stockExchangeId);
 
     Q_CHECK_PTR(stokExchangeKLinesId);
+    Q_CHECK_PTR(klinesId);
 
-    stokExchangeKLinesId.reset();
+    //Биржа периодически присылает список целиком. Версия увеличивается только при изменении содержимого,
+    //иначе сбрасывались бы кеш ответов и ETag, сохраненные клиентами
+    if (*stokExchangeKLinesId != *klinesId)
+    {
+        stokExchangeKLinesId.reset();
 
-    stokExchangeKLinesId = klinesId;
+        stokExchangeKLinesId = klinesId;
+
+        ++_klinesIdListVersion[stockExchangeId];
+
+        QMutexLocker<QMutex> answersCacheLocker(answersCacheMutex);
+
+        _answersCache.erase(stockExchangeId);
+    }
 
     if (!_isSendStarted)
     {
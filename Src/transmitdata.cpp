@@ -1,7 +1,12 @@
 //STL
 #include <cfloat>
+#include <limits>
+#include <algorithm>
+#include <vector>
 
 //Qt
+#include <QtEndian>
+#include <QCryptographicHash>
 
 //My
 #include "TradingCatCommon/kline.h"
@@ -11,6 +16,251 @@
 using namespace TradingCatCommon;
 using namespace Common;
 
+///////////////////////////////////////////////////////////////////////////////
+///     Binary format
+///
+PackageFormat TradingCatCommon::acceptToPackageFormat(const QString &accept)
+{
+    bool isBinary = false;
+    bool isColumnar = false;
+
+    //Accept: type/subtype;param=value;q=0.9, ... Параметры могут разделяться пробелами и быть в кавычках
+    for (const auto& mediaRange: QStringView(accept).split(u','))
+    {
+        const auto parts = mediaRange.split(u';');
+        const auto mediaType = parts.front().trimmed();
+
+        QStringView layout;
+        bool isRejected = false;
+        for (qsizetype i = 1; i < parts.size(); ++i)
+        {
+            const auto param = parts[i].trimmed();
+            const auto pos = param.indexOf(u'=');
+            if (pos == -1)
+            {
+                continue;
+            }
+
+            const auto name = param.left(pos).trimmed();
+            auto value = param.mid(pos + 1).trimmed();
+            if (value.size() >= 2 && value.startsWith(u'"') && value.endsWith(u'"'))
+            {
+                value = value.mid(1, value.size() - 2);
+            }
+
+            if (name.compare(u"layout", Qt::CaseInsensitive) == 0)
+            {
+                layout = value;
+            }
+            else if (name.compare(u"q", Qt::CaseInsensitive) == 0)
+            {
+                //q=0 - клиент явно отказывается от этого типа
+                bool ok = false;
+                isRejected = value.toDouble(&ok) <= 0.0 && ok;
+            }
+        }
+
+        if (isRejected)
+        {
+            continue;
+        }
+
+        if (mediaType.compare(*BINARY_CONTENT_TYPE, Qt::CaseInsensitive) == 0)
+        {
+            isBinary = true;
+        }
+        else if (mediaType.compare(*JSON_CONTENT_TYPE, Qt::CaseInsensitive) == 0 && layout.compare(u"columnar", Qt::CaseInsensitive) == 0)
+        {
+            isColumnar = true;
+        }
+    }
+
+    if (isBinary)
+    {
+        return PackageFormat::BINARY;
+    }
+
+    if (isColumnar)
+    {
+        return PackageFormat::JSON_COLUMNAR;
+    }
+
+    return PackageFormat::JSON;
+}
+
+const QString &TradingCatCommon::packageFormatToContentType(PackageFormat format)
+{
+    switch (format)
+    {
+    case PackageFormat::BINARY: return *BINARY_CONTENT_TYPE;
+    case PackageFormat::JSON_COLUMNAR: return *COLUMNAR_JSON_CONTENT_TYPE;
+    case PackageFormat::JSON:
+    default:
+        break;
+    }
+
+    return *JSON_CONTENT_TYPE;
+}
+
+QString TradingCatCommon::answerETag(const QByteArray& answer)
+{
+    return QString("W/\"%1\"").arg(QString::fromLatin1(QCryptographicHash::hash(answer, QCryptographicHash::Sha1).toHex()));
+}
+
+void TradingCatCommon::initBinaryStream(QDataStream &stream)
+{
+    stream.setVersion(QDataStream::Qt_6_0);
+    stream.setByteOrder(QDataStream::LittleEndian);
+    stream.setFloatingPointPrecision(QDataStream::SinglePrecision);
+}
+
+void TradingCatCommon::checkBinaryStream(const QDataStream &stream, const QString &path)
+{
+    if (stream.status() != QDataStream::Ok)
+    {
+        throw ParseException(QString("Incorrect binary value of [%1]: unexpected end of data or corrupted data").arg(path));
+    }
+}
+
+void TradingCatCommon::checkBinaryCount(const QDataStream &stream, quint32 count, qint64 minElementSize, const QString &path)
+{
+    Q_ASSERT(minElementSize > 0);
+
+    const auto device = stream.device();
+    if (device == nullptr)
+    {
+        return;
+    }
+
+    if (static_cast<qint64>(count) > device->bytesAvailable() / minElementSize)
+    {
+        throw ParseException(QString("Incorrect binary value of [%1]: array size %2 exceeds the remaining data").arg(path).arg(count));
+    }
+}
+
+void TradingCatCommon::writeBinaryString(QDataStream &stream, const QString &str)
+{
+    stream << str.toUtf8();
+}
+
+QString TradingCatCommon::readBinaryString(QDataStream &stream)
+{
+    QByteArray str;
+    stream >> str;
+
+    return QString::fromUtf8(str);
+}
+
+bool TradingCatCommon::isBinaryPackage(const QByteArray &data) noexcept
+{
+    if (data.size() < BINARY_PACKAGE_HEADER_SIZE)
+    {
+        return false;
+    }
+
+    return qFromLittleEndian<quint32>(data.constData()) == BINARY_PACKAGE_MAGIC;
+}
+
+QByteArray TradingCatCommon::makeBinaryPackage(const QByteArray &payload)
+{
+    QByteArray result;
+    result.reserve(BINARY_PACKAGE_HEADER_SIZE + payload.size());
+
+    {
+        QDataStream stream(&result, QIODevice::WriteOnly);
+        initBinaryStream(stream);
+
+        stream << BINARY_PACKAGE_MAGIC << BINARY_PACKAGE_VERSION << static_cast<quint32>(payload.size());
+    }
+
+    result += payload;
+
+    return result;
+}
+
+QByteArray TradingCatCommon::readBinaryPackage(const QByteArray &data)
+{
+    if (!isBinaryPackage(data))
+    {
+        throw ParseException("Incorrect binary package: signature not found");
+    }
+
+    QDataStream stream(data);
+    initBinaryStream(stream);
+
+    quint32 magic = 0;
+    quint16 version = 0;
+    quint32 length = 0;
+    stream >> magic >> version >> length;
+
+    checkBinaryStream(stream, "Header");
+
+    if (version != BINARY_PACKAGE_VERSION)
+    {
+        throw ParseException(QString("Unsupported binary package version: %1. Expected: %2").arg(version).arg(BINARY_PACKAGE_VERSION));
+    }
+
+    if (static_cast<qsizetype>(length) != data.size() - BINARY_PACKAGE_HEADER_SIZE)
+    {
+        throw ParseException(QString("Incorrect binary package length: %1. Received: %2").arg(length).arg(data.size() - BINARY_PACKAGE_HEADER_SIZE));
+    }
+
+    return data.sliced(BINARY_PACKAGE_HEADER_SIZE);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///     Columnar KLines
+///
+static void readColumn(const QJsonObject& json, const QString& key, std::vector<float>& column)
+{
+    const auto arrayJson = JSONReadMapToArray(json, key, QString("KLines/%1").arg(key));
+
+    column.reserve(arrayJson.size());
+    for (const auto& value: arrayJson)
+    {
+        if (!value.isDouble())
+        {
+            throw ParseException(QString("Incorrect value of KLines/%1: number expected").arg(key));
+        }
+
+        column.push_back(static_cast<float>(value.toDouble()));
+    }
+}
+
+static void readColumn(const QJsonObject& json, const QString& key, std::vector<qint64>& column)
+{
+    const auto arrayJson = JSONReadMapToArray(json, key, QString("KLines/%1").arg(key));
+
+    column.reserve(arrayJson.size());
+    for (const auto& value: arrayJson)
+    {
+        if (!value.isDouble())
+        {
+            throw ParseException(QString("Incorrect value of KLines/%1: number expected").arg(key));
+        }
+
+        column.push_back(value.toInteger());
+    }
+}
+
+static void readColumn(JsonReader& reader, std::vector<float>& column)
+{
+    reader.beginArray();
+    while (reader.nextElement())
+    {
+        column.push_back(reader.readFloat());
+    }
+}
+
+static void readColumn(JsonReader& reader, std::vector<qint64>& column)
+{
+    reader.beginArray();
+    while (reader.nextElement())
+    {
+        column.push_back(reader.readInt64());
+    }
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 ///     Status
 ///
@@ -60,6 +310,55 @@ StatusAnswer::StatusAnswer(const QJsonObject &json)
     }
 }
 
+StatusAnswer::StatusAnswer(QDataStream &stream)
+{
+    quint16 codeNum = static_cast<quint16>(ErrorCode::UNDEFINED);
+    stream >> codeNum;
+
+    _code = intToErrorCode(codeNum);
+    if (_code != ErrorCode::OK)
+    {
+        _msg = readBinaryString(stream);
+    }
+
+    checkBinaryStream(stream, "Root/Status");
+}
+
+StatusAnswer::StatusAnswer(JsonReader &reader)
+{
+    quint16 codeNum = static_cast<quint16>(ErrorCode::UNDEFINED);
+    QString msg;
+
+    reader.beginObject();
+    while (reader.nextKey())
+    {
+        const auto key = reader.key();
+        if (key == "Code")
+        {
+            const auto code = reader.readInt64();
+            if (code < 0 || code > std::numeric_limits<quint16>::max())
+            {
+                reader.error(QString("Incorrect status code: %1").arg(code));
+            }
+            codeNum = static_cast<quint16>(code);
+        }
+        else if (key == "Msg")
+        {
+            msg = reader.readString();
+        }
+        else
+        {
+            reader.skipValue();
+        }
+    }
+
+    _code = intToErrorCode(codeNum);
+    if (_code != ErrorCode::OK)
+    {
+        _msg = msg;
+    }
+}
+
 StatusAnswer::StatusAnswer(ErrorCode code, const QString &msg /* = QString() */)
     : _code(code)
     , _msg(msg.isEmpty() ? errorCodeToStr(_code) : msg)
@@ -80,6 +379,30 @@ QJsonObject StatusAnswer::toJson() const
     return result;
 }
 
+void StatusAnswer::writeJson(JsonWriter &writer) const
+{
+    writer.beginObject();
+
+    writer.keyValue("Code", static_cast<int>(_code));
+
+    if (_code != ErrorCode::OK)
+    {
+        writer.keyValue("Msg", _msg);
+    }
+
+    writer.endObject();
+}
+
+void StatusAnswer::toBinary(QDataStream &stream) const
+{
+    stream << static_cast<quint16>(_code);
+
+    if (_code != ErrorCode::OK)
+    {
+        writeBinaryString(stream, _msg);
+    }
+}
+
 StatusAnswer::operator bool() const
 {
     return _code == ErrorCode::OK;
@@ -117,6 +440,48 @@ KLineIDJson::KLineIDJson(const QJsonValue &json)
     _klineId = KLineID(symbol, type);
 }
 
+KLineIDJson::KLineIDJson(QDataStream &stream)
+{
+    const auto symbol = readBinaryString(stream);
+
+    qint64 type = static_cast<qint64>(KLineType::UNDEFINED);
+    stream >> type;
+
+    _klineId = KLineID(symbol, static_cast<KLineType>(type));
+}
+
+KLineIDJson::KLineIDJson(JsonReader &reader)
+{
+    QString symbol;
+    auto type = KLineType::UNDEFINED;
+
+    reader.beginObject();
+    while (reader.nextKey())
+    {
+        const auto key = reader.key();
+        if (key == "Symbol")
+        {
+            symbol = reader.readString();
+        }
+        else if (key == "Type")
+        {
+            type = stringToKLineType(reader.readString());
+        }
+        else
+        {
+            reader.skipValue();
+        }
+    }
+
+    _klineId = KLineID(symbol, type);
+}
+
+void KLineIDJson::toBinary(QDataStream &stream) const
+{
+    writeBinaryString(stream, _klineId.symbol.name);
+    stream << static_cast<qint64>(_klineId.type);
+}
+
 QJsonObject KLineIDJson::toJson() const
 {
     QJsonObject result;
@@ -127,6 +492,16 @@ QJsonObject KLineIDJson::toJson() const
     return result;
 }
 
+void KLineIDJson::writeJson(JsonWriter &writer) const
+{
+    writer.beginObject();
+
+    writer.keyValue("Symbol", _klineId.symbol.name);
+    writer.keyValue("Type", KLineTypeToString(_klineId.type));
+
+    writer.endObject();
+}
+
 bool KLineIDJson::isError() const noexcept
 {
     return !_errorString.isEmpty();
@@ -158,6 +533,36 @@ StockExchangeIDJson::StockExchangeIDJson(const QJsonValue &json)
     _stockExchangeId = StockExchangeID(name);
 }
 
+StockExchangeIDJson::StockExchangeIDJson(QDataStream &stream)
+{
+    _stockExchangeId = StockExchangeID(readBinaryString(stream));
+}
+
+StockExchangeIDJson::StockExchangeIDJson(JsonReader &reader)
+{
+    QString name;
+
+    reader.beginObject();
+    while (reader.nextKey())
+    {
+        if (reader.key() == "Name")
+        {
+            name = reader.readString();
+        }
+        else
+        {
+            reader.skipValue();
+        }
+    }
+
+    _stockExchangeId = StockExchangeID(name);
+}
+
+void StockExchangeIDJson::toBinary(QDataStream &stream) const
+{
+    writeBinaryString(stream, _stockExchangeId.name);
+}
+
 QJsonObject StockExchangeIDJson::toJson() const
 {
     QJsonObject result;
@@ -167,6 +572,15 @@ QJsonObject StockExchangeIDJson::toJson() const
     return result;
 }
 
+void StockExchangeIDJson::writeJson(JsonWriter &writer) const
+{
+    writer.beginObject();
+
+    writer.keyValue("Name", _stockExchangeId.name);
+
+    writer.endObject();
+}
+
 const StockExchangeID &StockExchangeIDJson::stockExchangeId() const noexcept
 {
     return _stockExchangeId;
@@ -257,6 +671,42 @@ StockExchangesIDArrayJson::StockExchangesIDArrayJson(const QJsonValue &json)
     }
 }
 
+StockExchangesIDArrayJson::StockExchangesIDArrayJson(QDataStream &stream)
+{
+    try
+    {
+        quint32 count = 0;
+        stream >> count;
+
+        checkBinaryStream(stream, "StockExchangesIDList");
+        checkBinaryCount(stream, count, BINARY_STRING_MIN_SIZE, "StockExchangesIDList");
+
+        for (quint32 i = 0; i < count; ++i)
+        {
+            StockExchangeIDJson stockExchangeID(stream);
+
+            checkBinaryStream(stream, "StockExchangesIDList/[]");
+
+            _stockExchangesIDList.insert(stockExchangeID.stockExchangeId());
+        }
+    }
+    catch (const ParseException& err)
+    {
+        _errorString = err.what();
+
+        _stockExchangesIDList.clear();
+    }
+}
+
+StockExchangesIDArrayJson::StockExchangesIDArrayJson(JsonReader &reader)
+{
+    reader.beginArray();
+    while (reader.nextElement())
+    {
+        _stockExchangesIDList.insert(StockExchangeIDJson(reader).stockExchangeId());
+    }
+}
+
 StockExchangesIDArrayJson::StockExchangesIDArrayJson(const StockExchangesIDList &stockExchangesIDList)
     : _stockExchangesIDList(stockExchangesIDList)
 {
@@ -275,6 +725,28 @@ QJsonArray StockExchangesIDArrayJson::toJson() const
     return result;
 }
 
+void StockExchangesIDArrayJson::writeJson(JsonWriter &writer) const
+{
+    writer.beginArray();
+
+    for (const auto& stockExchangeId: _stockExchangesIDList)
+    {
+        StockExchangeIDJson(stockExchangeId).writeJson(writer);
+    }
+
+    writer.endArray();
+}
+
+void StockExchangesIDArrayJson::toBinary(QDataStream &stream) const
+{
+    stream << static_cast<quint32>(_stockExchangesIDList.size());
+
+    for (const auto& stockExchangeId: _stockExchangesIDList)
+    {
+        StockExchangeIDJson(stockExchangeId).toBinary(stream);
+    }
+}
+
 StockExchangesIDList StockExchangesIDArrayJson::stockExchagesIDList() const
 {
     return _stockExchangesIDList;
@@ -330,6 +802,125 @@ KLineJson::KLineJson(const QJsonValue &json)
     }
 }
 
+KLineJson::KLineJson(QDataStream &stream, const KLineID &klineId)
+{
+    try
+    {
+        _kline = std::make_shared<KLine>();
+
+        stream >> _kline->openTime
+               >> _kline->closeTime
+               >> _kline->open
+               >> _kline->high
+               >> _kline->low
+               >> _kline->close
+               >> _kline->volume
+               >> _kline->quoteAssetVolume;
+
+        checkBinaryStream(stream, "KLine");
+
+        _kline->id = klineId;
+
+        if (!_kline->check())
+        {
+            throw ParseException(QString("Incorrect value: %1").arg(_kline->toString()));
+        }
+    }
+    catch (const ParseException& err)
+    {
+        _errorString = err.what();
+    }
+}
+
+KLineJson::KLineJson(JsonReader &reader)
+{
+    _kline = std::make_shared<KLine>();
+    _kline->openTime = 0;
+    _kline->closeTime = 0;
+
+    reader.beginObject();
+    while (reader.nextKey())
+    {
+        const auto key = reader.key();
+        if (key == "C")
+        {
+            _kline->close = reader.readFloat();
+        }
+        else if (key == "CT")
+        {
+            _kline->closeTime = reader.readInt64();
+        }
+        else if (key == "H")
+        {
+            _kline->high = reader.readFloat();
+        }
+        else if (key == "ID")
+        {
+            _kline->id = KLineIDJson(reader).klineId();
+        }
+        else if (key == "L")
+        {
+            _kline->low = reader.readFloat();
+        }
+        else if (key == "O")
+        {
+            _kline->open = reader.readFloat();
+        }
+        else if (key == "OT")
+        {
+            _kline->openTime = reader.readInt64();
+        }
+        else if (key == "QAV")
+        {
+            _kline->quoteAssetVolume = reader.readFloat();
+        }
+        else if (key == "V")
+        {
+            _kline->volume = reader.readFloat();
+        }
+        else
+        {
+            reader.skipValue();
+        }
+    }
+
+    if (!_kline->check())
+    {
+        reader.error(QString("Incorrect KLine value: %1").arg(_kline->toString()));
+    }
+}
+
+void KLineJson::toBinary(QDataStream &stream) const
+{
+    //Свеча сериализуется один раз и переиспользуется во всех ответах, в которые она входит.
+    //Параметры потока совпадают, т.к. все двоичные пакеты инициализируются initBinaryStream()
+    const auto data = _kline->serialized(KLine::SerializedFormat::BINARY,
+        [this]()
+        {
+            QByteArray result;
+            QDataStream stream(&result, QIODevice::WriteOnly);
+            initBinaryStream(stream);
+
+            toBinaryData(stream);
+
+            return result;
+        });
+
+    stream.writeRawData(data.constData(), data.size());
+}
+
+void KLineJson::toBinaryData(QDataStream &stream) const
+{
+    stream << static_cast<qint64>(_kline->openTime)
+           << static_cast<qint64>(_kline->closeTime)
+           << _kline->open
+           << _kline->high
+           << _kline->low
+           << _kline->close
+           << _kline->volume
+           << _kline->quoteAssetVolume;
+}
+
 QJsonObject KLineJson::toJson() const
 {
     QJsonObject klineJson;
@@ -347,6 +938,40 @@ QJsonObject KLineJson::toJson() const
     return klineJson;
 }
 
+void KLineJson::writeJson(JsonWriter &writer) const
+{
+    //Свеча сериализуется один раз и переиспользуется во всех ответах, в которые она входит
+    writer.rawValue(_kline->serialized(KLine::SerializedFormat::JSON,
+        [this]()
+        {
+            QByteArray result;
+            JsonWriter klineWriter(result);
+
+            writeJsonData(klineWriter);
+
+            return result;
+        }));
+}
+
+void KLineJson::writeJsonData(JsonWriter &writer) const
+{
+    //Порядок ключей совпадает с порядком в QJsonObject
+    writer.beginObject();
+
+    writer.keyValue("C", _kline->close);
+    writer.keyValue("CT", static_cast<qint64>(_kline->closeTime));
+    writer.keyValue("H", _kline->high);
+    writer.key("ID");
+    KLineIDJson(_kline->id).writeJson(writer);
+    writer.keyValue("L", _kline->low);
+    writer.keyValue("O", _kline->open);
+    writer.keyValue("OT", static_cast<qint64>(_kline->openTime));
+    writer.keyValue("QAV", _kline->quoteAssetVolume);
+    writer.keyValue("V", _kline->volume);
+
+    writer.endObject();
+}
+
 bool KLineJson::isError() const noexcept
 {
     return !_errorString.isEmpty();
@@ -375,10 +1000,17 @@ KLinesArrayJson::KLinesArrayJson(const QJsonValue &json)
 {
     try
     {
-        const auto klinesListJson = JSONReadArray(json, "KLine");
-
         _klinesList = std::make_shared<KLinesList>();
 
+        if (json.isObject())
+        {
+            fromColumnarJson(json.toObject());
+
+            return;
+        }
+
+        const auto klinesListJson = JSONReadArray(json, "KLine");
+
         for (const auto& klineJson: klinesListJson)
         {
             KLineJson kline(klineJson);
@@ -396,6 +1028,85 @@ KLinesArrayJson::KLinesArrayJson(const QJsonValue &json)
     }
 }
 
+KLinesArrayJson::KLinesArrayJson(QDataStream &stream)
+{
+    try
+    {
+        quint32 count = 0;
+        stream >> count;
+
+        checkBinaryStream(stream, "KLines");
+        checkBinaryCount(stream, count, BINARY_KLINE_MIN_SIZE, "KLines");
+
+        _klinesList = std::make_shared<KLinesList>();
+
+        //ИД свечи передается только для первой свечи и при его изменении
+        KLineID klineId;
+        for (quint32 i = 0; i < count; ++i)
+        {
+            bool isNewId = false;
+            stream >> isNewId;
+
+            if (isNewId)
+            {
+                klineId = KLineIDJson(stream).klineId();
+            }
+
+            checkBinaryStream(stream, "KLines/[]/ID");
+
+            KLineJson kline(stream, klineId);
+            if (kline.isError())
+            {
+                throw ParseException(QString("Incorrect KLine: %1").arg(kline.errorString()));
+            }
+
+            _klinesList->emplace_back(kline.kline());
+        }
+    }
+    catch (const ParseException& err)
+    {
+        _errorString = err.what();
+    }
+}
+
+KLinesArrayJson::KLinesArrayJson(JsonReader &reader)
+{
+    _klinesList = std::make_shared<KLinesList>();
+
+    if (reader.nextValueType() == JsonReader::ValueType::OBJECT)
+    {
+        fromColumnarJson(reader);
+
+        return;
+    }
+
+    reader.beginArray();
+    while (reader.nextElement())
+    {
+        _klinesList->emplace_back(KLineJson(reader).kline());
+    }
+}
+
+void KLinesArrayJson::toBinary(QDataStream &stream) const
+{
+    stream << static_cast<quint32>(_klinesList->size());
+
+    const KLineID* lastKLineId = nullptr;
+    for (const auto& kline: *_klinesList)
+    {
+        const bool isNewId = lastKLineId == nullptr || *lastKLineId != kline->id;
+
+        stream << isNewId;
+        if (isNewId)
+        {
+            KLineIDJson(kline->id).toBinary(stream);
+            lastKLineId = &kline->id;
+        }
+
+        KLineJson(kline).toBinary(stream);
+    }
+}
+
 QJsonArray KLinesArrayJson::toJson() const
 {
     QJsonArray result;
@@ -408,6 +1119,243 @@ QJsonArray KLinesArrayJson::toJson() const
     return result;
 }
 
+void KLinesArrayJson::writeJson(JsonWriter &writer) const
+{
+    if (writer.options().testFlag(JsonWriter::Option::COLUMNAR_KLINES) && isColumnarAvailable())
+    {
+        writeColumnarJson(writer);
+
+        return;
+    }
+
+    writer.beginArray();
+
+    for (const auto& kline: *_klinesList)
+    {
+        KLineJson(kline).writeJson(writer);
+    }
+
+    writer.endArray();
+}
+
+struct KLinesArrayJson::Columns
+{
+    KLineID klineId;                        ///< ИД серии
+    std::vector<qint64> closeTime;          ///< Разности времени закрытия с предыдущей свечей
+    std::vector<qint64> duration;           ///< Длительность свечей. Один элемент - общая длительность для всех свечей
+    std::vector<float> open;
+    std::vector<float> high;
+    std::vector<float> low;
+    std::vector<float> close;
+    std::vector<float> volume;
+    std::vector<float> quoteAssetVolume;
+};
+
+bool KLinesArrayJson::isColumnarAvailable() const
+{
+    if (_klinesList->empty())
+    {
+        return false;
+    }
+
+    const auto& klineId = _klinesList->front()->id;
+
+    return std::all_of(_klinesList->begin(), _klinesList->end(),
+        [&klineId](const auto& kline)
+        {
+            return kline->id == klineId;
+        });
+}
+
+void KLinesArrayJson::writeColumnarJson(JsonWriter &writer) const
+{
+    Q_ASSERT(isColumnarAvailable());
+
+    const auto writeColumn = [this, &writer](QByteArrayView key, float KLine::* field)
+    {
+        writer.key(key);
+        writer.beginArray();
+        for (const auto& kline: *_klinesList)
+        {
+            writer.value((*kline).*field);
+        }
+        writer.endArray();
+    };
+
+    const auto& firstKLine = _klinesList->front();
+    const auto duration = firstKLine->closeTime - firstKLine->openTime;
+    const bool isSameDuration = std::all_of(_klinesList->begin(), _klinesList->end(),
+        [duration](const auto& kline)
+        {
+            return kline->closeTime - kline->openTime == duration;
+        });
+
+    writer.beginObject();
+
+    writeColumn("C", &KLine::close);
+
+    writer.key("CT");
+    writer.beginArray();
+    qint64 lastCloseTime = 0;
+    for (const auto& kline: *_klinesList)
+    {
+        writer.value(static_cast<qint64>(kline->closeTime - lastCloseTime));
+        lastCloseTime = kline->closeTime;
+    }
+    writer.endArray();
+
+    writer.key("DT");
+    if (isSameDuration)
+    {
+        writer.value(static_cast<qint64>(duration));
+    }
+    else
+    {
+        writer.beginArray();
+        for (const auto& kline: *_klinesList)
+        {
+            writer.value(static_cast<qint64>(kline->closeTime - kline->openTime));
+        }
+        writer.endArray();
+    }
+
+    writeColumn("H", &KLine::high);
+
+    writer.key("ID");
+    KLineIDJson(firstKLine->id).writeJson(writer);
+
+    writeColumn("L", &KLine::low);
+    writeColumn("O", &KLine::open);
+    writeColumn("QAV", &KLine::quoteAssetVolume);
+    writeColumn("V", &KLine::volume);
+
+    writer.endObject();
+}
+
+void KLinesArrayJson::fromColumnarJson(const QJsonObject &json)
+{
+    Columns columns;
+
+    columns.klineId = KLineIDJson(JSONReadMapToMap(json, "ID", "KLines/ID")).klineId();
+
+    readColumn(json, "CT", columns.closeTime);
+    readColumn(json, "O", columns.open);
+    readColumn(json, "H", columns.high);
+    readColumn(json, "L", columns.low);
+    readColumn(json, "C", columns.close);
+    readColumn(json, "V", columns.volume);
+    readColumn(json, "QAV", columns.quoteAssetVolume);
+
+    const auto durationJson = json["DT"];
+    if (durationJson.isDouble())
+    {
+        columns.duration.push_back(durationJson.toInteger());
+    }
+    else
+    {
+        readColumn(json, "DT", columns.duration);
+    }
+
+    fromColumns(columns);
+}
+
+void KLinesArrayJson::fromColumnarJson(JsonReader &reader)
+{
+    Columns columns;
+
+    reader.beginObject();
+    while (reader.nextKey())
+    {
+        const auto key = reader.key();
+        if (key == "C")
+        {
+            readColumn(reader, columns.close);
+        }
+        else if (key == "CT")
+        {
+            readColumn(reader, columns.closeTime);
+        }
+        else if (key == "DT")
+        {
+            if (reader.nextValueType() == JsonReader::ValueType::NUMBER)
+            {
+                columns.duration.push_back(reader.readInt64());
+            }
+            else
+            {
+                readColumn(reader, columns.duration);
+            }
+        }
+        else if (key == "H")
+        {
+            readColumn(reader, columns.high);
+        }
+        else if (key == "ID")
+        {
+            columns.klineId = KLineIDJson(reader).klineId();
+        }
+        else if (key == "L")
+        {
+            readColumn(reader, columns.low);
+        }
+        else if (key == "O")
+        {
+            readColumn(reader, columns.open);
+        }
+        else if (key == "QAV")
+        {
+            readColumn(reader, columns.quoteAssetVolume);
+        }
+        else if (key == "V")
+        {
+            readColumn(reader, columns.volume);
+        }
+        else
+        {
+            reader.skipValue();
+        }
+    }
+
+    fromColumns(columns);
+}
+
+void KLinesArrayJson::fromColumns(const Columns &columns)
+{
+    const auto count = columns.closeTime.size();
+
+    if (columns.open.size() != count || columns.high.size() != count || columns.low.size() != count ||
+        columns.close.size() != count || columns.volume.size() != count || columns.quoteAssetVolume.size() != count ||
+        (columns.duration.size() != 1 && columns.duration.size() != count))
+    {
+        throw ParseException(QString("Incorrect columnar KLines: columns have different sizes"));
+    }
+
+    qint64 closeTime = 0;
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        auto kline = std::make_shared<KLine>();
+
+        closeTime += columns.closeTime[i];
+
+        kline->id = columns.klineId;
+        kline->closeTime = closeTime;
+        kline->openTime = closeTime - (columns.duration.size() == 1 ? columns.duration[0] : columns.duration[i]);
+        kline->open = columns.open[i];
+        kline->high = columns.high[i];
+        kline->low = columns.low[i];
+        kline->close = columns.close[i];
+        kline->volume = columns.volume[i];
+        kline->quoteAssetVolume = columns.quoteAssetVolume[i];
+
+        if (!kline->check())
+        {
+            throw ParseException(QString("Incorrect KLine: Incorrect value: %1").arg(kline->toString()));
+        }
+
+        _klinesList->emplace_back(std::move(kline));
+    }
+}
+
 const PKLinesList &KLinesArrayJson::klinesList() const noexcept
 {
     return _klinesList;
@@ -1,3 +1,6 @@
+//STL
+#include <algorithm>
+
 //Qt
 #include <QTimer>
 
@@ -5,15 +8,27 @@
 
 using namespace TradingCatCommon;
 
-static const quint64 SEND_TIMEOUT = 1u; //10s
-static const quint64 RETRY_SEND_TIMEOUT = 10000u; //10s
-static const quint64 SEND_UPDATE_INTERVAL = 20u * 1000u; //10s
+static const qint64 MIN_UPDATE_INTERVAL = 1000;           ///< Интервал запросов новых свечей, пока сервер их отдает (мсек)
+static const qint64 MAX_UPDATE_BACKOFF = 20 * 1000;        ///< Максимальный интервал повтора запроса, если свечи не опубликованы (мсек)
+static const qint64 DEFAULT_PUBLISH_LAG = 5 * 1000;        ///< Начальная оценка задержки публикации свечей после закрытия (мсек)
+static const qint64 HISTORY_KLINES_COUNT = 60;             ///< Количество свечей в окне истории, запрашиваемой при обнаружении
+static const qint64 HISTORY_END_OFFSET = 60 * 1000;        ///< Запас конца окна истории относительно текущего времени (мсек)
+static const qsizetype KLINES_CACHE_SIZE = 2 * HISTORY_KLINES_COUNT; ///< Количество свечей одной серии в кеше
+static const qsizetype KLINES_CACHE_SERIES = 4096;         ///< Количество серий в кеше
+
+size_t UserCore::HistoryRequestKeyHash::operator()(const HistoryRequestKey& key) const noexcept
+{
+    return std::hash<StockExchangeID>()(key.stockExchangeId) ^
+           (std::hash<KLineID>()(key.klineId) << 1) ^
+           (std::hash<qint64>()(key.end) << 2);
+}
 
 
 UserCore::UserCore(const HTTPClientConfig& httpClientConfig, const TradingCatCommon::KLineTypes& types /* = {TradingCatCommon::KLineType::MIN1} */, QObject* parent /* = nullptr */)
     : QObject{parent}
     , _httpClientConfig(httpClientConfig)\
     , _types(types)
+    , _klinesCache(KLINES_CACHE_SIZE, KLINES_CACHE_SERIES)
 {
     Q_ASSERT(_httpClientConfig.isCheck());
     Q_ASSERT(!_types.empty());
@@ -59,6 +74,7 @@ void UserCore::start()
             SLOT(orderDetectDetector(const TradingCatCommon::Detector::POrderDetectData&)));
 
     _httpClient = new HTTPClient(_httpClientConfig);
+    _httpClient->setAnswersCache(_answersCache);
 
     connect(_httpClient, SIGNAL(stockExchangeList(const TradingCatCommon::StockExchangesIDList&, quint64)),
             SLOT(stockExchangeListHTTPClient(const TradingCatCommon::StockExchangesIDList&, quint64)));
@@ -69,6 +85,9 @@ void UserCore::start()
     connect(_httpClient, SIGNAL(klineNew(const TradingCatCommon::StockExchangeID&, const TradingCatCommon::PKLinesList&, quint64)),
             SLOT(klineNewHTTPClient(const TradingCatCommon::StockExchangeID&, const TradingCatCommon::PKLinesList&, quint64)));
 
+    connect(_httpClient, SIGNAL(klineNewReceived(qsizetype, qint64, quint64)),
+            SLOT(klineNewReceivedHTTPClient(qsizetype, qint64, quint64)));
+
     connect(_httpClient, SIGNAL(orderBookNew(const TradingCatCommon::StockExchangeID&, const TradingCatCommon::POrderBooksList&, quint64)),
             SLOT(orderBookNewHTTPClient(const TradingCatCommon::StockExchangeID&, const TradingCatCommon::POrderBooksList&, quint64)));
 
@@ -96,12 +115,23 @@ void UserCore::stop()
         return;
     }
 
+    delete _pushClient;
+    _pushClient = nullptr;
+    _isPushOpened = false;
+
     delete _updateTimer;
     _updateTimer = nullptr;
 
     delete _detector;
     _detector = nullptr;
 
+    //Ответы на запросы остановленного клиента не придут
+    _detectKLine.clear();
+    _historyRequests.clear();
+    _klineListRequests.clear();
+
+    _answersCache = _httpClient->answersCache();
+
     delete _httpClient;
     _httpClient = nullptr;
 
@@ -139,11 +169,38 @@ void UserCore::getServerStatus(qint64 userId)
 
 void UserCore::klineDetectDetector(const TradingCatCommon::Detector::PKLineDetectData& klineData)
 {
-    const auto curDateTime = QDateTime::currentDateTime().addSecs(60);
-    const auto startTime = curDateTime.addMSecs(-(static_cast<qint64>(klineData->klineId.type) * 60));
-    auto id = _httpClient->sendKLineHistory(klineData->stockExchangeId, klineData->klineId, startTime, curDateTime);
+    Q_CHECK_PTR(_httpClient);
+
+    //Окно выравнивается по границе свечи, поэтому все обнаружения одной серии в пределах свечи
+    //ожидают один и тот же запрос истории
+    const auto period = static_cast<qint64>(klineData->klineId.type);
+    const auto now = QDateTime::currentMSecsSinceEpoch();
+    const auto end = ((now + HISTORY_END_OFFSET) / period + 1) * period;
+    const auto start = end - period * HISTORY_KLINES_COUNT;
+    HistoryRequestKey key{klineData->stockExchangeId, klineData->klineId, end};
+
+    const auto it_historyRequests = _historyRequests.find(key);
+    if (it_historyRequests != _historyRequests.end())
+    {
+        _detectKLine.at(it_historyRequests->second).detects.push_back(klineData);
+
+        return;
+    }
+
+    //Свечи окна уже есть в кеше - запрос к серверу не нужен
+    const auto missingRange = _klinesCache.missingRange(klineData->stockExchangeId, klineData->klineId, start, end, now);
+    if (!missingRange.has_value())
+    {
+        sendKLineDetect(HistoryRequest{std::move(key), start, start, {klineData}});
+
+        return;
+    }
 
-    _detectKLine.emplace(std::move(id), klineData);
+    const auto id = _httpClient->sendKLineHistory(klineData->stockExchangeId, klineData->klineId,
+                                                  QDateTime::fromMSecsSinceEpoch(missingRange->start), QDateTime::fromMSecsSinceEpoch(missingRange->end));
+
+    _historyRequests.emplace(key, id);
+    _detectKLine.emplace(id, HistoryRequest{std::move(key), start, missingRange->start, {klineData}});
 }
 
 void UserCore::sendLogMsgHTTPClient(Common::TDBLoger::MSG_CODE category, const QString &msg)
@@ -166,68 +223,67 @@ void UserCore::stockExchangeListHTTPClient(const StockExchangesIDList &stockExch
     {
         emit sendLogMsg(Common::TDBLoger::MSG_CODE::WARNING_CODE, "The server did not report supported exchanges. Retry...");
 
-        QTimer::singleShot(RETRY_SEND_TIMEOUT, this, [this](){ _httpClient->sendStockExchangeList(); });
+        QTimer::singleShot(_httpClient->retryDelay(PackageType::STOCK_EXCHANGE_LIST), this, [this](){ _httpClient->sendStockExchangeList(); });
 
         return;
     }
 
-    _nextStockExchange = _stockExchangesMap.begin();
-
-    QTimer::singleShot(SEND_TIMEOUT, this, [this](){ _httpClient->sendKLineList(_nextStockExchange->first); });
+    //Списки свечей всех бирж запрашиваются одновременно, количество одновременных запросов ограничивает HTTP клиент
+    _klineListRequests.clear();
+    for (const auto& [stockExchangeId, klinesIdList]: _stockExchangesMap)
+    {
+        _klineListRequests.emplace(_httpClient->sendKLineList(stockExchangeId), stockExchangeId);
+    }
 }
 
 void UserCore::klineListHTTPClient(const StockExchangeID &stockExchangeId, const KLinesIDList &klineIdList, quint64 id)
 {
-    // Q_ASSERT(id != 0);
-    // Q_ASSERT(!stockExchangeId.isEmpty());
-
-    // const auto it_stockExchangeMap = _stockExchangesMap.find(stockExchangeId);
+    Q_ASSERT(id != 0);
+    Q_ASSERT(!stockExchangeId.isEmpty());
 
-    // if (it_stockExchangeMap == _stockExchangesMap.end())
-    // {
-    //     emit sendLogMsg(Common::TDBLoger::MSG_CODE::WARNING_CODE, QString("Invalid server response. Stock exchange %1 is missing from the request StockExchangeList. Retry...").arg(stockExchangeId.toString()));
+    //Ответ на запрос, отправленный до повторного получения списка бирж
+    if (_klineListRequests.erase(id) == 0)
+    {
+        return;
+    }
 
-    //     QTimer::singleShot(RETRY_SEND_TIMEOUT, this, [this](){ _httpClient->sendStockExchangeList(); });
+    const auto it_stockExchangeMap = _stockExchangesMap.find(stockExchangeId);
 
-    //     return;
-    // }
+    if (it_stockExchangeMap == _stockExchangesMap.end())
+    {
+        emit sendLogMsg(Common::TDBLoger::MSG_CODE::WARNING_CODE, QString("Invalid server response. Stock exchange %1 is missing from the request StockExchangeList. Retry...").arg(stockExchangeId.toString()));
 
-    // auto& klinesIdList = it_stockExchangeMap->second;
+        _klineListRequests.clear();
 
-    // for (const auto& klineId: klineIdList)
-    // {
-    //     klinesIdList.insert(klineId);
-    // }
+        QTimer::singleShot(_httpClient->retryDelay(PackageType::STOCK_EXCHANGE_LIST), this, [this](){ _httpClient->sendStockExchangeList(); });
 
-    // _nextStockExchange = std::next(_nextStockExchange);
+        return;
+    }
 
-    // if (_nextStockExchange != _stockExchangesMap.end())
-    // {
-    //     QTimer::singleShot(SEND_TIMEOUT, this, [this](){ _httpClient->sendKLineList(_nextStockExchange->first); });
-    // }
-    // else
-    // {
-    //     quint64 klineIdCount = 0;
-    //     for (const auto& stockExchange: _stockExchangesMap)
-    //     {
-    //         klineIdCount += stockExchange.second.size();
-    //     }
+    auto& klinesIdList = it_stockExchangeMap->second;
 
-    //     emit sendLogMsg(Common::TDBLoger::MSG_CODE::INFORMATION_CODE, QString("Stock exchange data successfully received. Total stock exchanges: %1, klines ID: %2. Start get new klines")
-    //                                                                       .arg(_stockExchangesMap.size())
-    //                                                                       .arg(klineIdCount));
+    for (const auto& klineId: klineIdList)
+    {
+        klinesIdList.insert(klineId);
+    }
 
-    //     if (!_updateTimer)
-    //     {
-    //         _updateTimer = new QTimer();
+    //Ждем списки свечей остальных бирж
+    if (!_klineListRequests.empty())
+    {
+        return;
+    }
 
-    //         connect(_updateTimer, SIGNAL(timeout()), SLOT(updateNew()));
+    quint64 klineIdCount = 0;
+    for (const auto& stockExchange: _stockExchangesMap)
+    {
+        klineIdCount += stockExchange.second.size();
+    }
 
-    //         _httpClient->sendKLineNew(_types);
+    emit sendLogMsg(Common::TDBLoger::MSG_CODE::INFORMATION_CODE, QString("Stock exchange data successfully received. Total stock exchanges: %1, klines ID: %2. Start get new klines")
+                                                                      .arg(_stockExchangesMap.size())
+                                                                      .arg(klineIdCount));
 
-    //         _updateTimer->start(SEND_UPDATE_INTERVAL);
-    //     }
-    // }
+    startUpdate();
 }
 
 void UserCore::klineNewHTTPClient(const StockExchangeID &stockExchangeId, const PKLinesList &klinesList, quint64 id)
@@ -237,15 +293,82 @@ void UserCore::klineNewHTTPClient(const StockExchangeID &stockExchangeId, const
     Q_ASSERT(id != 0);
     Q_ASSERT(!stockExchangeId.isEmpty());
 
-    const auto curDateTime = QDateTime::currentDateTime().addSecs(60);
-    quint64 index = 1;
+    addNewKLines(stockExchangeId, klinesList);
+}
+
+void UserCore::addNewKLines(const StockExchangeID &stockExchangeId, const PKLinesList &klinesList)
+{
+    Q_CHECK_PTR(_detector);
+    Q_CHECK_PTR(klinesList);
+
+    //Канал рассылки передает свечи всех типов, детектору нужны только запрашиваемые
+    auto newKLinesList = std::make_shared<KLinesList>();
+    auto& lastNewKLines = _lastNewKLines[stockExchangeId];
     for (const auto& kline: *klinesList)
     {
-        const auto& id = kline->id;
+        if (!_types.contains(kline->id.type))
+        {
+            continue;
+        }
+
+        auto& lastCloseTime = lastNewKLines[kline->id];
+        if (kline->closeTime <= lastCloseTime)
+        {
+            continue;
+        }
 
+        lastCloseTime = kline->closeTime;
+        newKLinesList->push_back(kline);
+    }
+
+    if (newKLinesList->empty())
+    {
+        return;
     }
 
-    _detector->getNewKLine(stockExchangeId, klinesList);
+    _klinesCache.addKLines(stockExchangeId, newKLinesList);
+
+    _detector->getNewKLine(stockExchangeId, newKLinesList);
+}
+
+void UserCore::sendLogMsgPushClient(Common::TDBLoger::MSG_CODE category, const QString &msg)
+{
+    emit sendLogMsg(category, QString("Push client of stock exchange server: %1").arg(msg));
+}
+
+void UserCore::newKLinesPushClient(const StockExchangeID &stockExchangeId, const PKLinesList &klinesList)
+{
+    Q_ASSERT(!stockExchangeId.isEmpty());
+
+    addNewKLines(stockExchangeId, klinesList);
+}
+
+void UserCore::openedPushClient()
+{
+    Q_CHECK_PTR(_updateTimer);
+
+    _isPushOpened = true;
+
+    //Свечи, опубликованные до подключения канала, забираем опросом. Опрос остановится, когда сервер перестанет их отдавать
+    _updateTimer->stop();
+    updateNew();
+}
+
+void UserCore::closedPushClient()
+{
+    _isPushOpened = false;
+
+    //До переподключения канала новые свечи запрашиваются опросом
+    scheduleUpdate(true);
+}
+
+void UserCore::eventsLostPushClient()
+{
+    Q_CHECK_PTR(_updateTimer);
+
+    //Потерянные события досылаются опросом с курсора последнего ответа
+    _updateTimer->stop();
+    updateNew();
 }
 
 void UserCore::klineHistoryHTTPClient(const StockExchangeID &stockExchangeId, const PKLinesList &klinesList, quint64 id)
@@ -257,15 +380,38 @@ void UserCore::klineHistoryHTTPClient(const StockExchangeID &stockExchangeId, co
     _detector->getKLineHistory(stockExchangeId, klinesList);
 
     const auto it_detectKLine = _detectKLine.find(id);
-    if (it_detectKLine != _detectKLine.end())
+    if (it_detectKLine == _detectKLine.end())
     {
-        const auto& detectklineInfo = it_detectKLine->second;
-        emit klineDetect(detectklineInfo, klinesList);
+        return;
+    }
 
-        _detectKLine.erase(it_detectKLine);
+    const auto historyRequest = std::move(it_detectKLine->second);
 
-        return;
+    _historyRequests.erase(historyRequest.key);
+    _detectKLine.erase(it_detectKLine);
+
+    //Сервер вернул только недостающую часть окна - остальные свечи берутся из кеша
+    _klinesCache.addHistory(stockExchangeId, historyRequest.key.klineId, historyRequest.requestStart, klinesList);
+
+    sendKLineDetect(historyRequest);
+}
+
+bool UserCore::sendKLineDetect(const HistoryRequest& historyRequest)
+{
+    const auto& key = historyRequest.key;
+    const auto klinesList = _klinesCache.getKLines(key.stockExchangeId, key.klineId, historyRequest.start, key.end);
+    if (klinesList->empty())
+    {
+        return false;
+    }
+
+    //Одно окно передается всем обнаружениям, ожидавшим этот запрос
+    for (const auto& detectklineInfo: historyRequest.detects)
+    {
+        emit klineDetect(detectklineInfo, klinesList);
     }
+
+    return true;
 }
 
 void UserCore::serverStatusHTTPClient(const QString &serverName, const QString &serverVersion, const QDateTime &serverTime, qint64 upTime, quint64 id)
@@ -293,19 +439,42 @@ void UserCore::errorOccurredHTTPClient(const QString &msg, TradingCatCommon::Pac
     case PackageType::STOCK_EXCHANGE_LIST:
     {
         packageTypeStr = "StockExchangeList";
-        QTimer::singleShot(RETRY_SEND_TIMEOUT, this, [this](){ _httpClient->sendStockExchangeList(); });
+        QTimer::singleShot(_httpClient->retryDelay(PackageType::STOCK_EXCHANGE_LIST), this, [this](){ _httpClient->sendStockExchangeList(); });
         break;
     }
     case PackageType::KLINE_LIST:
     {
         packageTypeStr = "KLineList";
-        QTimer::singleShot(RETRY_SEND_TIMEOUT, this, [this](){ _httpClient->sendKLineList(_nextStockExchange->first); });
+
+        //Повторяется только запрос списка свечей этой биржи, остальные запросы продолжают выполняться
+        const auto it_klineListRequests = _klineListRequests.find(id);
+        if (it_klineListRequests == _klineListRequests.end())
+        {
+            action = "Ignore..";
+
+            break;
+        }
+
+        //Запрос остается в списке выполняемых до повтора, чтобы обновление не началось без свечей этой биржи
+        QTimer::singleShot(_httpClient->retryDelay(PackageType::KLINE_LIST), this,
+            [this, id]()
+            {
+                const auto it_klineListRequests = _klineListRequests.find(id);
+                if (it_klineListRequests == _klineListRequests.end())
+                {
+                    return;
+                }
+
+                const auto stockExchangeId = it_klineListRequests->second;
+                _klineListRequests.erase(it_klineListRequests);
+                _klineListRequests.emplace(_httpClient->sendKLineList(stockExchangeId), stockExchangeId);
+            });
         break;
     }
     case PackageType::KLINE_NEW:
     {
         packageTypeStr = "KLineNew";
-        action = "Ignore..";
+        scheduleUpdate(false);
         break;
     }
     case PackageType::KLINE_HISTORY:
@@ -316,7 +485,16 @@ void UserCore::errorOccurredHTTPClient(const QString &msg, TradingCatCommon::Pac
         const auto it_deetectKLine = _detectKLine.find(id);
         if (it_deetectKLine != _detectKLine.end())
         {
+            const auto historyRequest = std::move(it_deetectKLine->second);
+
+            _historyRequests.erase(historyRequest.key);
             _detectKLine.erase(it_deetectKLine);
+
+            //Сервер не вернул недостающие свечи (например, они еще не опубликованы) - используем то, что есть в кеше
+            if (sendKLineDetect(historyRequest))
+            {
+                action = "Use cached klines..";
+            }
         }
         break;
     }  
@@ -341,6 +519,128 @@ void UserCore::errorOccurredHTTPClient(const QString &msg, TradingCatCommon::Pac
                                                                   .arg(action));
 }
 
+void UserCore::klineNewReceivedHTTPClient(qsizetype klinesCount, qint64 lastGetId, quint64 id)
+{
+    Q_ASSERT(id != 0);
+
+    const bool isAdvanced = klinesCount > 0 && lastGetId != _lastGetId;
+    _lastGetId = lastGetId;
+
+    //Первые новые свечи после ожидания публикации уточняют задержку публикации
+    if (isAdvanced && _updateBackoff != 0)
+    {
+        const auto period = updatePeriod();
+        if (_isUpdateAligned)
+        {
+            //Свечи уже были опубликованы к моменту запроса - пробуем запрашивать раньше
+            _publishLag -= _publishLag / 8;
+        }
+        else
+        {
+            //Свечи опубликованы позже ожидаемого. Время с момента закрытия - верхняя оценка задержки
+            const auto sinceClose = QDateTime::currentMSecsSinceEpoch() % period;
+            _publishLag = (3 * _publishLag + sinceClose) / 4;
+        }
+        _publishLag = std::clamp<qint64>(_publishLag, 0, period / 2);
+    }
+
+    scheduleUpdate(isAdvanced);
+}
+
+void UserCore::startUpdate()
+{
+    if (_updateTimer != nullptr)
+    {
+        return;
+    }
+
+    _updateTimer = new QTimer();
+    _updateTimer->setSingleShot(true);
+
+    connect(_updateTimer, SIGNAL(timeout()), SLOT(updateNew()));
+
+    _lastGetId = 0;
+    _publishLag = DEFAULT_PUBLISH_LAG;
+    _updateBackoff = 0;
+    _isUpdateAligned = false;
+
+    //Если задана сессия - новые свечи приходят через канал рассылки, а опрос работает только пока канал не подключен
+    if (_httpClientConfig.pushSessionId != 0)
+    {
+        _pushClient = new PushClient(_httpClientConfig, _httpClientConfig.pushSessionId, true);
+
+        connect(_pushClient, SIGNAL(newKLines(const TradingCatCommon::StockExchangeID&, const TradingCatCommon::PKLinesList&)),
+                SLOT(newKLinesPushClient(const TradingCatCommon::StockExchangeID&, const TradingCatCommon::PKLinesList&)));
+
+        connect(_pushClient, SIGNAL(opened()), SLOT(openedPushClient()));
+        connect(_pushClient, SIGNAL(closed()), SLOT(closedPushClient()));
+        connect(_pushClient, SIGNAL(eventsLost()), SLOT(eventsLostPushClient()));
+
+        connect(_pushClient, SIGNAL(sendLogMsg(Common::TDBLoger::MSG_CODE, const QString&)),
+                SLOT(sendLogMsgPushClient(Common::TDBLoger::MSG_CODE, const QString&)));
+
+        _pushClient->start();
+    }
+
+    updateNew();
+}
+
+void UserCore::scheduleUpdate(bool isAdvanced)
+{
+    if (_updateTimer == nullptr)
+    {
+        return;
+    }
+
+    //Канал рассылки подключен - опрос продолжается только пока сервер отдает свечи, пропущенные до подключения
+    if (_isPushOpened && !isAdvanced)
+    {
+        return;
+    }
+
+    //Момент публикации свечей, закрывающихся на ближайшей границе периода
+    const auto period = updatePeriod();
+    const auto now = QDateTime::currentMSecsSinceEpoch();
+    const auto untilPublish = std::max(((now - _publishLag) / period + 1) * period + _publishLag - now, MIN_UPDATE_INTERVAL);
+
+    qint64 interval = 0;
+    if (isAdvanced)
+    {
+        //Курсор движется - на сервере могут быть еще свечи
+        interval = MIN_UPDATE_INTERVAL;
+        _updateBackoff = 0;
+    }
+    else if (_updateBackoff == 0)
+    {
+        //Все новые свечи получены - ждем следующей публикации
+        interval = untilPublish;
+        _updateBackoff = MIN_UPDATE_INTERVAL;
+    }
+    else
+    {
+        //Свечи не опубликованы в ожидаемый момент - повторяем запрос, но не позже следующей публикации
+        interval = std::min(_updateBackoff, untilPublish);
+        _updateBackoff = interval == untilPublish ? MIN_UPDATE_INTERVAL : std::min(_updateBackoff * 2, MAX_UPDATE_BACKOFF);
+    }
+
+    _isUpdateAligned = interval == untilPublish;
+
+    _updateTimer->start(interval);
+}
+
+qint64 UserCore::updatePeriod() const
+{
+    Q_ASSERT(!_types.empty());
+
+    const auto it_minType = std::min_element(_types.begin(), _types.end(),
+        [](const auto& type1, const auto& type2)
+        {
+            return static_cast<qint64>(type1) < static_cast<qint64>(type2);
+        });
+
+    return static_cast<qint64>(*it_minType);
+}
+
 void UserCore::updateNew()
 {
     _httpClient->sendKLineNew(_types);
@@ -0,0 +1,194 @@
+//Qt
+#include <QCryptographicHash>
+#include <QRandomGenerator>
+
+#include "TradingCatCommon/websocket.h"
+
+using namespace TradingCatCommon;
+
+static const QByteArray WEBSOCKET_GUID = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11"; ///< GUID для расчета Sec-WebSocket-Accept (RFC 6455)
+
+static const quint8 FIN_BIT = 0x80;
+static const quint8 OPCODE_MASK = 0x0F;
+static const quint8 MASK_BIT = 0x80;
+static const quint8 LENGTH_MASK = 0x7F;
+static const quint8 LENGTH_16 = 126;    ///< Длина записана в следующих 2 байтах
+static const quint8 LENGTH_64 = 127;    ///< Длина записана в следующих 8 байтах
+static const qsizetype MASK_KEY_SIZE = 4;
+
+QByteArray TradingCatCommon::webSocketAcceptKey(const QByteArray& key)
+{
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(key);
+    hash.addData(WEBSOCKET_GUID);
+
+    return hash.result().toBase64();
+}
+
+QByteArray TradingCatCommon::makeWebSocketFrame(WebSocketOpCode opCode, QByteArrayView payload, bool isMasked /* = false */)
+{
+    const auto size = payload.size();
+
+    QByteArray frame;
+    frame.reserve(size + 14);
+
+    frame.append(static_cast<char>(FIN_BIT | static_cast<quint8>(opCode)));
+
+    const quint8 maskBit = isMasked ? MASK_BIT : 0;
+    if (size < LENGTH_16)
+    {
+        frame.append(static_cast<char>(maskBit | static_cast<quint8>(size)));
+    }
+    else if (size <= 0xFFFF)
+    {
+        frame.append(static_cast<char>(maskBit | LENGTH_16));
+        frame.append(static_cast<char>((size >> 8) & 0xFF));
+        frame.append(static_cast<char>(size & 0xFF));
+    }
+    else
+    {
+        frame.append(static_cast<char>(maskBit | LENGTH_64));
+        for (int shift = 56; shift >= 0; shift -= 8)
+        {
+            frame.append(static_cast<char>((static_cast<quint64>(size) >> shift) & 0xFF));
+        }
+    }
+
+    if (!isMasked)
+    {
+        frame.append(payload);
+
+        return frame;
+    }
+
+    const quint32 maskKey = QRandomGenerator::global()->generate();
+    char mask[MASK_KEY_SIZE];
+    for (qsizetype i = 0; i < MASK_KEY_SIZE; ++i)
+    {
+        mask[i] = static_cast<char>((maskKey >> (8 * i)) & 0xFF);
+    }
+    frame.append(mask, MASK_KEY_SIZE);
+
+    const auto payloadBegin = frame.size();
+    frame.append(payload);
+
+    auto data = frame.data() + payloadBegin;
+    for (qsizetype i = 0; i < size; ++i)
+    {
+        data[i] ^= mask[i % MASK_KEY_SIZE];
+    }
+
+    return frame;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///     The WebSocketFrameReader class
+///
+WebSocketFrameReader::WebSocketFrameReader(qint64 maxPayloadSize /* = 1024 * 1024 */)
+    : _maxPayloadSize(maxPayloadSize)
+{
+    Q_ASSERT(_maxPayloadSize > 0);
+}
+
+void WebSocketFrameReader::add(const QByteArray &data)
+{
+    if (isError())
+    {
+        return;
+    }
+
+    _buffer += data;
+}
+
+std::optional<WebSocketFrameReader::Frame> WebSocketFrameReader::next()
+{
+    if (isError() || _buffer.size() < 2)
+    {
+        return std::nullopt;
+    }
+
+    const auto data = reinterpret_cast<const quint8*>(_buffer.constData());
+
+    Frame frame;
+    frame.isFinal = (data[0] & FIN_BIT) != 0;
+    frame.opCode = static_cast<WebSocketOpCode>(data[0] & OPCODE_MASK);
+
+    const bool isMasked = (data[1] & MASK_BIT) != 0;
+    quint64 payloadSize = data[1] & LENGTH_MASK;
+    qsizetype pos = 2;
+
+    if (payloadSize == LENGTH_16)
+    {
+        if (_buffer.size() < pos + 2)
+        {
+            return std::nullopt;
+        }
+
+        payloadSize = (static_cast<quint64>(data[2]) << 8) | data[3];
+        pos += 2;
+    }
+    else if (payloadSize == LENGTH_64)
+    {
+        if (_buffer.size() < pos + 8)
+        {
+            return std::nullopt;
+        }
+
+        payloadSize = 0;
+        for (qsizetype i = 0; i < 8; ++i)
+        {
+            payloadSize = (payloadSize << 8) | data[pos + i];
+        }
+        pos += 8;
+    }
+
+    if (payloadSize > static_cast<quint64>(_maxPayloadSize))
+    {
+        _errorString = QString("WebSocket frame is too large: %1 B").arg(payloadSize);
+        _buffer.clear();
+
+        return std::nullopt;
+    }
+
+    const char* mask = nullptr;
+    if (isMasked)
+    {
+        if (_buffer.size() < pos + MASK_KEY_SIZE)
+        {
+            return std::nullopt;
+        }
+
+        mask = _buffer.constData() + pos;
+        pos += MASK_KEY_SIZE;
+    }
+
+    const auto size = static_cast<qsizetype>(payloadSize);
+    if (_buffer.size() < pos + size)
+    {
+        return std::nullopt;
+    }
+
+    frame.payload = _buffer.mid(pos, size);
+    if (mask != nullptr)
+    {
+        auto payload = frame.payload.data();
+        for (qsizetype i = 0; i < size; ++i)
+        {
+            payload[i] ^= mask[i % MASK_KEY_SIZE];
+        }
+    }
+
+    _buffer.remove(0, pos + size);
+
+    return frame;
+}
+
+bool WebSocketFrameReader::isError() const noexcept
+{
+    return !_errorString.isEmpty();
+}
+
+const QString &WebSocketFrameReader::errorString() const noexcept
+{
+    return _errorString;
+}
@@ -1,6 +1,8 @@
 INCLUDEPATH += \
     $$PWD/Headers
 
+LIBS += -lz
+
 HEADERS += \
     $$PWD/Headers/TradingCatCommon/appserverprotocol.h \
     $$PWD/Headers/TradingCatCommon/ikline.h \
@@ -8,6 +10,14 @@ HEADERS += \
     $$PWD/Headers/TradingCatCommon/symbol.h \
     $$PWD/Headers/TradingCatCommon/tradingdata.h \
     $$PWD/Headers/TradingCatCommon/transmitdata.h \
+    $$PWD/Headers/TradingCatCommon/jsonwriter.h \
+    $$PWD/Headers/TradingCatCommon/jsonreader.h \
+    $$PWD/Headers/TradingCatCommon/numberformat.h \
+    $$PWD/Headers/TradingCatCommon/httpcompression.h \
+    $$PWD/Headers/TradingCatCommon/websocket.h \
+    $$PWD/Headers/TradingCatCommon/admissioncontrol.h \
+    $$PWD/Headers/TradingCatCommon/servermetrics.h \
+    $$PWD/Headers/TradingCatCommon/pushchannel.h \
     $$PWD/Headers/TradingCatCommon/filter.h \
     $$PWD/Headers/TradingCatCommon/klinefilterdata.h \
     $$PWD/Headers/TradingCatCommon/blacklistfilterdata.h \
@@ -15,6 +25,8 @@ HEADERS += \
     $$PWD/Headers/TradingCatCommon/klinesdatacontainer.h \
     $$PWD/Headers/TradingCatCommon/stockexchange.h \
     $$PWD/Headers/TradingCatCommon/kline.h \
+    $$PWD/Headers/TradingCatCommon/natr.h \
+    $$PWD/Headers/TradingCatCommon/klinescache.h \
     $$PWD/Headers/TradingCatCommon/types.h \
     $$PWD/Headers/TradingCatCommon/detector.h \
     $$PWD/Headers/TradingCatCommon/userconfig.h \
@@ -28,6 +40,14 @@ SOURCES += \
     $$PWD/Src/tradestream.cpp \
     $$PWD/Src/tradingdata.cpp \
     $$PWD/Src/transmitdata.cpp \
+    $$PWD/Src/jsonwriter.cpp \
+    $$PWD/Src/jsonreader.cpp \
+    $$PWD/Src/numberformat.cpp \
+    $$PWD/Src/httpcompression.cpp \
+    $$PWD/Src/websocket.cpp \
+    $$PWD/Src/admissioncontrol.cpp \
+    $$PWD/Src/servermetrics.cpp \
+    $$PWD/Src/pushchannel.cpp \
     $$PWD/Src/filter.cpp \
     $$PWD/Src/klinefilterdata.cpp \
     $$PWD/Src/blacklistfilterdata.cpp \
@@ -35,5 +55,7 @@ SOURCES += \
     $$PWD/Src/klinesdatacontainer.cpp \
     $$PWD/Src/stockexchange.cpp \
     $$PWD/Src/kline.cpp \
+    $$PWD/Src/natr.cpp \
+    $$PWD/Src/klinescache.cpp \
     $$PWD/Src/detector.cpp \
     $$PWD/Src/userconfig.cpp
@@ -0,0 +1,14 @@
+#Общие настройки бенчмарков. Библиотека Common должна находиться рядом с TradingCatCommon
+QT += core network
+QT -= gui
+
+CONFIG += c++20 console release
+CONFIG -= app_bundle
+
+INCLUDEPATH += $$PWD
+
+HEADERS += \
+    $$PWD/benchmark.h
+
+include($$PWD/../../Common/Common.pri)
+include($$PWD/../TradingCatCommon.pri)
@@ -0,0 +1,10 @@
+TEMPLATE = subdirs
+
+SUBDIRS += \
+    binaryformat \
+    jsonwriter \
+    jsonreader \
+    numberformat \
+    reactor \
+    requestparser \
+    dispatch
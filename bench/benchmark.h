@@ -0,0 +1,138 @@
+#pragma once
+
+//STL
+#include <algorithm>
+#include <memory>
+
+//Qt
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QRandomGenerator>
+#include <QString>
+#include <QTextStream>
+
+//My
+#include "TradingCatCommon/detector.h"
+#include "TradingCatCommon/kline.h"
+#include "TradingCatCommon/stockexchange.h"
+
+namespace TradingCatCommon::Bench
+{
+
+/*!
+    Выполняет функцию заданное количество раз и выводит среднее время одного вызова.
+        Перед измерением выполняется разогрев на десятой части итераций
+    @param name - название измерения
+    @param iterations - количество вызовов
+    @param function - измеряемая функция. Результат функции накапливается, чтобы компилятор не удалил вызов
+    @return среднее время одного вызова (нсек)
+*/
+template <typename TFunction>
+double measure(const QString& name, qint64 iterations, TFunction&& function)
+{
+    Q_ASSERT(iterations > 0);
+
+    static volatile qint64 sink = 0;
+
+    const auto warmup = std::max<qint64>(iterations / 10, 1);
+    for (qint64 i = 0; i < warmup; ++i)
+    {
+        sink = sink + static_cast<qint64>(function());
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    for (qint64 i = 0; i < iterations; ++i)
+    {
+        sink = sink + static_cast<qint64>(function());
+    }
+
+    const auto result = static_cast<double>(timer.nsecsElapsed()) / static_cast<double>(iterations);
+
+    QTextStream(stdout) << QString("%1 %2 ns/op").arg(name, -56).arg(result, 12, 'f', 0) << Qt::endl;
+
+    return result;
+}
+
+/*!
+    Выводит отношение времени базового варианта ко времени нового
+    @param name - название сравнения
+    @param base - время базового варианта (нсек)
+    @param value - время нового варианта (нсек)
+*/
+inline void printSpeedup(const QString& name, double base, double value)
+{
+    QTextStream(stdout) << QString("%1 x%2").arg(name, -56).arg(value > 0.0 ? base / value : 0.0, 0, 'f', 2) << Qt::endl;
+}
+
+/*!
+    Выводит размер данных
+    @param name - название данных
+    @param size - размер (байт)
+*/
+inline void printSize(const QString& name, qsizetype size)
+{
+    QTextStream(stdout) << QString("%1 %2 bytes").arg(name, -56).arg(size, 12) << Qt::endl;
+}
+
+/*!
+    Генерирует список свечей одной серии. Значения воспроизводимы между запусками
+    @param klineId - ИД свечи
+    @param count - количество свечей
+    @return список свечей в порядке возрастания времени закрытия
+*/
+inline TradingCatCommon::PKLinesList makeKLines(const TradingCatCommon::KLineID& klineId, qsizetype count)
+{
+    QRandomGenerator random(static_cast<quint32>(qHash(klineId.symbol.name)));
+
+    auto result = std::make_shared<TradingCatCommon::KLinesList>();
+
+    const auto interval = static_cast<qint64>(klineId.type);
+    auto closeTime = (QDateTime::currentMSecsSinceEpoch() / interval) * interval - count * interval;
+    auto price = 100.0f + static_cast<float>(random.bounded(1000.0));
+
+    for (qsizetype i = 0; i < count; ++i)
+    {
+        auto kline = std::make_shared<TradingCatCommon::KLine>();
+        kline->id = klineId;
+        kline->openTime = closeTime;
+        kline->closeTime = closeTime + interval;
+        kline->open = price;
+        kline->close = price * (1.0f + static_cast<float>(random.bounded(0.02) - 0.01));
+        kline->high = std::max(kline->open, kline->close) * (1.0f + static_cast<float>(random.bounded(0.005)));
+        kline->low = std::min(kline->open, kline->close) * (1.0f - static_cast<float>(random.bounded(0.005)));
+        kline->volume = static_cast<float>(random.bounded(100000.0));
+        kline->quoteAssetVolume = kline->volume * kline->close;
+
+        result->emplace_back(std::move(kline));
+
+        price = result->back()->close;
+        closeTime += interval;
+    }
+
+    return result;
+}
+
+/*!
+    Генерирует данные сработки детектора с историей и историей обзора
+    @param stockExchangeId - ИД биржи
+    @param symbol - символ
+    @param count - количество свечей в каждой истории
+    @return данные сработки
+*/
+inline TradingCatCommon::Detector::PKLineDetectData makeDetect(const TradingCatCommon::StockExchangeID& stockExchangeId, const QString& symbol, qsizetype count)
+{
+    auto result = std::make_shared<TradingCatCommon::Detector::KLineDetectData>();
+    result->stockExchangeId = stockExchangeId;
+    result->filterActivate = TradingCatCommon::Filter::FilterType::DELTA;
+    result->history = makeKLines(TradingCatCommon::KLineID(symbol, TradingCatCommon::KLineType::MIN1), count);
+    result->reviewHistory = makeKLines(TradingCatCommon::KLineID(symbol, TradingCatCommon::KLineType::MIN5), count);
+    result->delta = 3.14159f;
+    result->volume = 123456.78f;
+    result->msg = QString("Delta: %1 Volume: %2").arg(result->delta).arg(result->volume);
+
+    return result;
+}
+
+} // namespace TradingCatCommon::Bench
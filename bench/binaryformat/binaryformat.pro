@@ -0,0 +1,6 @@
+TARGET = binaryformat
+
+include($$PWD/../bench.pri)
+
+SOURCES += \
+    main.cpp
@@ -0,0 +1,123 @@
+///////////////////////////////////////////////////////////////////////////////
+///     Бенчмарк двоичного формата пакетов: размер, кодирование и разбор
+///         KLinesArrayJson и DetectAnswer в сравнении с JSON через QJsonDocument
+///
+
+//Qt
+#include <QCoreApplication>
+#include <QDataStream>
+#include <QJsonDocument>
+
+//My
+#include "TradingCatCommon/appserverprotocol.h"
+#include "TradingCatCommon/transmitdata.h"
+
+#include "benchmark.h"
+
+using namespace TradingCatCommon;
+
+static const qsizetype KLINES_COUNT = 300;  ///< Количество свечей в списке и в каждой истории сработки
+static const qsizetype DETECT_COUNT = 10;   ///< Количество сработок в ответе
+static const qint64 ITERATIONS = 1000;
+
+static QJsonValue documentValue(const QJsonDocument& doc)
+{
+    return doc.isArray() ? QJsonValue(doc.array()) : QJsonValue(doc.object());
+}
+
+template <class TData>
+static QByteArray toJsonData(const TData& data)
+{
+    return QJsonDocument(data.toJson()).toJson(QJsonDocument::Compact);
+}
+
+template <class TData>
+static QByteArray toBinaryData(const TData& data)
+{
+    QByteArray payload;
+
+    {
+        QDataStream stream(&payload, QIODevice::WriteOnly);
+        initBinaryStream(stream);
+
+        data.toBinary(stream);
+    }
+
+    return makeBinaryPackage(payload);
+}
+
+template <class TData>
+static TData fromBinaryData(const QByteArray& data)
+{
+    const auto payload = readBinaryPackage(data);
+
+    QDataStream stream(payload);
+    initBinaryStream(stream);
+
+    return TData(stream);
+}
+
+template <class TData>
+static void run(const QString& name, const TData& data)
+{
+    const auto json = toJsonData(data);
+    const auto binary = toBinaryData(data);
+
+    //Разбор должен выполняться без ошибок, иначе измерения не имеют смысла
+    const TData jsonResult(documentValue(QJsonDocument::fromJson(json)));
+    const auto binaryResult = fromBinaryData<TData>(binary);
+    if (jsonResult.isError() || binaryResult.isError())
+    {
+        qFatal("%s: parse error: %s%s", qPrintable(name), qPrintable(jsonResult.errorString()), qPrintable(binaryResult.errorString()));
+    }
+
+    Bench::printSize(name + " JSON size", json.size());
+    Bench::printSize(name + " binary size", binary.size());
+
+    const auto jsonEncode = Bench::measure(name + " encode JSON", ITERATIONS,
+        [&data]()
+        {
+            return toJsonData(data).size();
+        });
+
+    const auto binaryEncode = Bench::measure(name + " encode binary", ITERATIONS,
+        [&data]()
+        {
+            return toBinaryData(data).size();
+        });
+
+    Bench::printSpeedup(name + " encode speedup", jsonEncode, binaryEncode);
+
+    const auto jsonDecode = Bench::measure(name + " decode JSON", ITERATIONS,
+        [&json]()
+        {
+            return TData(documentValue(QJsonDocument::fromJson(json))).isError();
+        });
+
+    const auto binaryDecode = Bench::measure(name + " decode binary", ITERATIONS,
+        [&binary]()
+        {
+            return fromBinaryData<TData>(binary).isError();
+        });
+
+    Bench::printSpeedup(name + " decode speedup", jsonDecode, binaryDecode);
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+
+    const StockExchangeID stockExchangeId("BINANCE");
+
+    run("KLinesArrayJson", KLinesArrayJson(Bench::makeKLines(KLineID(Symbol("BTCUSDT"), KLineType::MIN1), KLINES_COUNT)));
+
+    Detector::KLinesDetectedList klinesDetectedList;
+    for (qsizetype i = 0; i < DETECT_COUNT; ++i)
+    {
+        klinesDetectedList.detected.emplace_back(Bench::makeDetect(stockExchangeId, QString("SYMBOL%1USDT").arg(i), KLINES_COUNT));
+    }
+
+    run("DetectAnswer", DetectAnswer(klinesDetectedList, QString()));
+
+    return 0;
+}
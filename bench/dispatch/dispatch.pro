@@ -0,0 +1,7 @@
+TARGET = dispatch
+
+include($$PWD/../bench.pri)
+include($$PWD/../server.pri)
+
+SOURCES += \
+    main.cpp
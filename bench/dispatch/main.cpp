@@ -0,0 +1,104 @@
+///////////////////////////////////////////////////////////////////////////////
+///     Микробенчмарк выбора обработчика запроса: таблица маршрутов сервера
+///         (SocketThread::findRoute()) в сравнении с прежней цепочкой сравнений, в которой
+///         для получения пути каждый раз создается объект запроса
+///
+
+//STL
+#include <optional>
+
+//Qt
+#include <QCoreApplication>
+#include <QUrl>
+
+//My
+#include "TradingCatCommon/appserverprotocol.h"
+#include "TradingCatCommon/socketthread.h"
+
+#include "benchmark.h"
+
+using namespace TradingCatCommon;
+
+static const qint64 ITERATIONS = 1000000;
+
+/*!
+    Прежний выбор обработчика (SocketThread::parseResource() до перехода на таблицу маршрутов): путь
+        сравнивается с путями вновь созданных объектов запросов в порядке добавления маршрутов в таблицу
+    @param path - путь запроса
+    @return номер маршрута или std::nullopt если маршрут не найден
+*/
+static std::optional<size_t> legacyRoute(const QString& path)
+{
+    if (path == ServerStatusQuery().path())
+    {
+        return 0;
+    }
+    else if (path == StockExchangesQuery().path())
+    {
+        return 1;
+    }
+    else if (path == KLinesListQuery().path())
+    {
+        return 2;
+    }
+    else if (path == KLineNewQuery().path())
+    {
+        return 3;
+    }
+    else if (path == KLineHistoryQuery().path())
+    {
+        return 4;
+    }
+
+    return std::nullopt;
+}
+
+/*!
+    Выбор обработчика по таблице маршрутов сервера. Номер маршрута в метриках совпадает с порядком добавления в таблицу
+    @param path - путь запроса
+    @return номер маршрута или std::nullopt если маршрут не найден
+*/
+static std::optional<size_t> tableRoute(const QString& path)
+{
+    const auto route = SocketThread::findRoute(path);
+    if (route == nullptr)
+    {
+        return std::nullopt;
+    }
+
+    return route->metricsRoute;
+}
+
+static void run(const QString& name, const QUrl& resource)
+{
+    if (legacyRoute(resource.path()) != tableRoute(resource.path()))
+    {
+        qFatal("%s: routes differ", qPrintable(name));
+    }
+
+    //Путь извлекается из ресурса при каждом запросе, как в SocketThread
+    const auto legacyTime = Bench::measure(name + " if-else chain", ITERATIONS,
+        [&resource]()
+        {
+            return legacyRoute(resource.path()).value_or(100);
+        });
+
+    const auto tableTime = Bench::measure(name + " routing table", ITERATIONS,
+        [&resource]()
+        {
+            return tableRoute(resource.path()).value_or(100);
+        });
+
+    Bench::printSpeedup(name + " speedup", legacyTime, tableTime);
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+
+    run("First route", QUrl(ServerStatusQuery().path()));
+    run("Last route", QUrl(KLineHistoryQuery().path()));
+    run("Unknown route", QUrl("/data/unknown?param=1"));
+
+    return 0;
+}
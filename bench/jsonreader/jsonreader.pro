@@ -0,0 +1,6 @@
+TARGET = jsonreader
+
+include($$PWD/../bench.pri)
+
+SOURCES += \
+    main.cpp
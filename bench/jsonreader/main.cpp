@@ -0,0 +1,120 @@
+///////////////////////////////////////////////////////////////////////////////
+///     Бенчмарк потокового разбора JSON: JsonReader в сравнении с разбором
+///         через QJsonDocument для KLinesArrayJson и DetectAnswer
+///
+
+//Qt
+#include <QCoreApplication>
+#include <QJsonDocument>
+
+//My
+#include "TradingCatCommon/appserverprotocol.h"
+#include "TradingCatCommon/jsonreader.h"
+#include "TradingCatCommon/jsonwriter.h"
+#include "TradingCatCommon/transmitdata.h"
+
+#include "benchmark.h"
+
+using namespace TradingCatCommon;
+
+static const qsizetype KLINES_COUNT = 300;  ///< Количество свечей в списке и в каждой истории сработки
+static const qsizetype DETECT_COUNT = 10;   ///< Количество сработок в ответе
+static const qint64 ITERATIONS = 1000;
+
+template <class TData>
+static TData fromDocument(const QByteArray& json)
+{
+    const auto doc = QJsonDocument::fromJson(json);
+
+    return TData(doc.isArray() ? QJsonValue(doc.array()) : QJsonValue(doc.object()));
+}
+
+template <class TData>
+static TData fromReader(const QByteArray& json)
+{
+    JsonReader reader(json);
+
+    TData result(reader);
+    reader.end();
+
+    return result;
+}
+
+template <class TData>
+static void run(const QString& name, const TData& data)
+{
+    QByteArray json;
+
+    {
+        JsonWriter writer(json);
+        data.writeJson(writer);
+    }
+
+    //Оба способа должны разбирать данные без ошибок, иначе измерения не имеют смысла
+    const auto documentResult = fromDocument<TData>(json);
+    const auto readerResult = fromReader<TData>(json);
+    if (documentResult.isError() || readerResult.isError())
+    {
+        qFatal("%s: parse error: %s%s", qPrintable(name), qPrintable(documentResult.errorString()), qPrintable(readerResult.errorString()));
+    }
+
+    Bench::printSize(name + " JSON size", json.size());
+
+    const auto documentTime = Bench::measure(name + " QJsonDocument", ITERATIONS,
+        [&json]()
+        {
+            return fromDocument<TData>(json).isError();
+        });
+
+    const auto readerTime = Bench::measure(name + " JsonReader", ITERATIONS,
+        [&json]()
+        {
+            return fromReader<TData>(json).isError();
+        });
+
+    Bench::printSpeedup(name + " speedup", documentTime, readerTime);
+
+    QTextStream(stdout) << QString("%1 %2 MB/s").arg(name + " JsonReader throughput", -56)
+                               .arg(static_cast<double>(json.size()) * 1000.0 / readerTime, 12, 'f', 1)
+                        << Qt::endl;
+}
+
+/*!
+    Проверяет разбор пакетов с "Data":null. Пакет с ошибкой должен сохранять статус,
+        успешный пакет - сообщать об отсутствии данных
+*/
+static void checkNullData()
+{
+    const Package<KLinesArrayJson> errorPackage(QByteArray(R"({"Data":null,"Status":{"Code":404,"Msg":"Not found"}})"));
+    if (errorPackage.isError() || errorPackage.status().code() != StatusAnswer::ErrorCode::NOT_FOUND || errorPackage.status().message() != "Not found")
+    {
+        qFatal("Null data error package: %s", qPrintable(errorPackage.errorString()));
+    }
+
+    const Package<KLinesArrayJson> okPackage(QByteArray(R"({"Data":null,"Status":{"Code":200}})"));
+    if (okPackage.errorString() != "Root/Data cannot be empty")
+    {
+        qFatal("Null data OK package: %s", qPrintable(okPackage.errorString()));
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+
+    checkNullData();
+
+    const StockExchangeID stockExchangeId("BINANCE");
+
+    run("KLinesArrayJson", KLinesArrayJson(Bench::makeKLines(KLineID(Symbol("BTCUSDT"), KLineType::MIN1), KLINES_COUNT)));
+
+    Detector::KLinesDetectedList klinesDetectedList;
+    for (qsizetype i = 0; i < DETECT_COUNT; ++i)
+    {
+        klinesDetectedList.detected.emplace_back(Bench::makeDetect(stockExchangeId, QString("SYMBOL%1USDT").arg(i), KLINES_COUNT));
+    }
+
+    run("DetectAnswer", DetectAnswer(klinesDetectedList, QString()));
+
+    return 0;
+}
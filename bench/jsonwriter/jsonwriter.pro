@@ -0,0 +1,6 @@
+TARGET = jsonwriter
+
+include($$PWD/../bench.pri)
+
+SOURCES += \
+    main.cpp
@@ -0,0 +1,91 @@
+///////////////////////////////////////////////////////////////////////////////
+///     Бенчмарк потоковой записи JSON: JsonWriter в переиспользуемый буфер
+///         в сравнении с построением QJsonDocument для KLinesArrayJson и DetectAnswer
+///
+
+//Qt
+#include <QCoreApplication>
+#include <QJsonDocument>
+
+//My
+#include "TradingCatCommon/appserverprotocol.h"
+#include "TradingCatCommon/jsonwriter.h"
+#include "TradingCatCommon/transmitdata.h"
+
+#include "benchmark.h"
+
+using namespace TradingCatCommon;
+
+static const qsizetype KLINES_COUNT = 300;  ///< Количество свечей в списке и в каждой истории сработки
+static const qsizetype DETECT_COUNT = 10;   ///< Количество сработок в ответе
+static const qint64 ITERATIONS = 1000;
+
+template <class TData>
+static QByteArray toDocumentJson(const TData& data)
+{
+    return QJsonDocument(data.toJson()).toJson(QJsonDocument::Compact);
+}
+
+template <class TData>
+static void toWriterJson(const TData& data, QByteArray& buffer)
+{
+    //Буфер очищается без освобождения памяти, как в обработчике запросов сервера
+    buffer.resize(0);
+
+    JsonWriter writer(buffer);
+    data.writeJson(writer);
+}
+
+template <class TData>
+static void run(const QString& name, const TData& data)
+{
+    QByteArray buffer;
+
+    //Числа float JsonWriter записывает в кратчайшем виде, поэтому результат сравнивается после разбора, а не побайтно
+    toWriterJson(data, buffer);
+    const auto document = toDocumentJson(data);
+    const auto writerDoc = QJsonDocument::fromJson(buffer);
+    const TData writerResult(writerDoc.isArray() ? QJsonValue(writerDoc.array()) : QJsonValue(writerDoc.object()));
+    if (writerDoc.isNull() || writerResult.isError())
+    {
+        qFatal("%s: JsonWriter output cannot be parsed: %s", qPrintable(name), qPrintable(writerResult.errorString()));
+    }
+
+    Bench::printSize(name + " QJsonDocument size", document.size());
+    Bench::printSize(name + " JsonWriter size", buffer.size());
+
+    const auto documentTime = Bench::measure(name + " QJsonDocument", ITERATIONS,
+        [&data]()
+        {
+            return toDocumentJson(data).size();
+        });
+
+    const auto writerTime = Bench::measure(name + " JsonWriter", ITERATIONS,
+        [&data, &buffer]()
+        {
+            toWriterJson(data, buffer);
+
+            return buffer.size();
+        });
+
+    Bench::printSpeedup(name + " speedup", documentTime, writerTime);
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+
+    const StockExchangeID stockExchangeId("BINANCE");
+
+    run("KLinesArrayJson", KLinesArrayJson(Bench::makeKLines(KLineID(Symbol("BTCUSDT"), KLineType::MIN1), KLINES_COUNT)));
+
+    Detector::KLinesDetectedList klinesDetectedList;
+    for (qsizetype i = 0; i < DETECT_COUNT; ++i)
+    {
+        klinesDetectedList.detected.emplace_back(Bench::makeDetect(stockExchangeId, QString("SYMBOL%1USDT").arg(i), KLINES_COUNT));
+    }
+
+    run("DetectAnswer", DetectAnswer(klinesDetectedList, QString()));
+
+    return 0;
+}
@@ -0,0 +1,168 @@
+///////////////////////////////////////////////////////////////////////////////
+///     Микробенчмарк форматирования и разбора чисел: функции numberformat.h
+///         в сравнении с форматированием Qt
+///
+
+//STL
+#include <vector>
+
+//Qt
+#include <QCoreApplication>
+#include <QLocale>
+#include <QRandomGenerator>
+
+//My
+#include "TradingCatCommon/numberformat.h"
+
+#include "benchmark.h"
+
+using namespace TradingCatCommon;
+
+static const qsizetype VALUES_COUNT = 4096; ///< Количество чисел в наборе. Степень 2, индекс берется по маске
+static const qint64 ITERATIONS = 1000000;
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+
+    QRandomGenerator random(1);
+
+    //Цены и объемы свечей, время в мсек Epoch
+    std::vector<float> floatValues(VALUES_COUNT);
+    std::vector<double> doubleValues(VALUES_COUNT);
+    std::vector<qint64> intValues(VALUES_COUNT);
+    for (qsizetype i = 0; i < VALUES_COUNT; ++i)
+    {
+        floatValues[i] = static_cast<float>(random.bounded(100000.0));
+        doubleValues[i] = random.bounded(100000.0);
+        intValues[i] = 1700000000000 + static_cast<qint64>(random.bounded(100000000));
+    }
+
+    std::vector<QByteArray> doubleStrings(VALUES_COUNT);
+    std::vector<QByteArray> intStrings(VALUES_COUNT);
+    for (qsizetype i = 0; i < VALUES_COUNT; ++i)
+    {
+        appendNumber(doubleStrings[i], doubleValues[i]);
+        appendNumber(intStrings[i], intValues[i]);
+    }
+
+    QByteArray buffer;
+    qsizetype index = 0;
+    const auto next = [&index]()
+    {
+        return index++ & (VALUES_COUNT - 1);
+    };
+
+    //float: JSON writer и двоичный/текстовый вывод
+    {
+        const auto qtTime = Bench::measure("float QByteArray::number(shortest)", ITERATIONS,
+            [&]()
+            {
+                return QByteArray::number(static_cast<double>(floatValues[next()]), 'g', QLocale::FloatingPointShortest).size();
+            });
+
+        const auto charsTime = Bench::measure("float appendNumber", ITERATIONS,
+            [&]()
+            {
+                buffer.resize(0);
+                appendNumber(buffer, floatValues[next()]);
+
+                return buffer.size();
+            });
+
+        Bench::printSpeedup("float speedup", qtTime, charsTime);
+    }
+
+    //double
+    {
+        const auto qtTime = Bench::measure("double QByteArray::number(shortest)", ITERATIONS,
+            [&]()
+            {
+                return QByteArray::number(doubleValues[next()], 'g', QLocale::FloatingPointShortest).size();
+            });
+
+        const auto charsTime = Bench::measure("double appendNumber", ITERATIONS,
+            [&]()
+            {
+                buffer.resize(0);
+                appendNumber(buffer, doubleValues[next()]);
+
+                return buffer.size();
+            });
+
+        Bench::printSpeedup("double speedup", qtTime, charsTime);
+    }
+
+    //qint64
+    {
+        const auto qtTime = Bench::measure("qint64 QByteArray::number", ITERATIONS,
+            [&]()
+            {
+                return QByteArray::number(intValues[next()]).size();
+            });
+
+        const auto charsTime = Bench::measure("qint64 appendNumber", ITERATIONS,
+            [&]()
+            {
+                buffer.resize(0);
+                appendNumber(buffer, intValues[next()]);
+
+                return buffer.size();
+            });
+
+        Bench::printSpeedup("qint64 speedup", qtTime, charsTime);
+    }
+
+    //Сообщения детектора
+    {
+        const auto qtTime = Bench::measure("message QString::arg(float)", ITERATIONS,
+            [&]()
+            {
+                return QString("Delta: %1").arg(floatValues[next()]).size();
+            });
+
+        const auto charsTime = Bench::measure("message generalNumberToString(float)", ITERATIONS,
+            [&]()
+            {
+                return QString("Delta: %1").arg(generalNumberToString(floatValues[next()])).size();
+            });
+
+        Bench::printSpeedup("message speedup", qtTime, charsTime);
+    }
+
+    //Разбор double
+    {
+        const auto qtTime = Bench::measure("parse double QByteArray::toDouble", ITERATIONS,
+            [&]()
+            {
+                return static_cast<qsizetype>(doubleStrings[next()].toDouble());
+            });
+
+        const auto charsTime = Bench::measure("parse double parseDouble", ITERATIONS,
+            [&]()
+            {
+                return static_cast<qsizetype>(parseDouble(doubleStrings[next()]).value_or(0.0));
+            });
+
+        Bench::printSpeedup("parse double speedup", qtTime, charsTime);
+    }
+
+    //Разбор qint64
+    {
+        const auto qtTime = Bench::measure("parse qint64 QByteArray::toLongLong", ITERATIONS,
+            [&]()
+            {
+                return static_cast<qsizetype>(intStrings[next()].toLongLong());
+            });
+
+        const auto charsTime = Bench::measure("parse qint64 parseInt64", ITERATIONS,
+            [&]()
+            {
+                return static_cast<qsizetype>(parseInt64(intStrings[next()]).value_or(0));
+            });
+
+        Bench::printSpeedup("parse qint64 speedup", qtTime, charsTime);
+    }
+
+    return 0;
+}
@@ -0,0 +1,6 @@
+TARGET = numberformat
+
+include($$PWD/../bench.pri)
+
+SOURCES += \
+    main.cpp
@@ -0,0 +1,351 @@
+///////////////////////////////////////////////////////////////////////////////
+///     Нагрузочный бенчмарк реакторов HttpServer: сервер запускается в этом же процессе,
+///         генератор нагрузки держит заданное количество постоянных соединений и отправляет
+///         по каждому следующий запрос сразу после получения ответа. Выводятся запросы/с и
+///         перцентили задержки
+///
+
+//STL
+#include <algorithm>
+#include <limits>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+//Qt
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QThread>
+#include <QtNetwork/QTcpSocket>
+
+//My
+#include "TradingCatCommon/appserverprotocol.h"
+#include "TradingCatCommon/httpserver.h"
+#include "TradingCatCommon/tradingdata.h"
+
+#include "benchmark.h"
+
+using namespace TradingCatCommon;
+
+///////////////////////////////////////////////////////////////////////////////
+///     The LoadClient class - генератор нагрузки одного потока
+///
+class LoadClient final
+    : public QObject
+{
+    Q_OBJECT
+
+public:
+    LoadClient(quint16 port, quint32 connections, qint64 duration, const QByteArray& request)
+        : _port(port)
+        , _connections(connections)
+        , _duration(duration)
+        , _request(request)
+    {
+    }
+
+    const std::vector<qint64>& latencies() const noexcept
+    {
+        return _latencies;
+    }
+
+    quint64 errors() const noexcept
+    {
+        return _errors;
+    }
+
+public slots:
+    void start()
+    {
+        _timer.start();
+
+        for (quint32 i = 0; i < _connections; ++i)
+        {
+            connectSocket();
+        }
+    }
+
+signals:
+    void finished();
+
+private slots:
+    void connected()
+    {
+        send(_sockets.at(qobject_cast<QTcpSocket*>(sender())));
+    }
+
+    void readyRead()
+    {
+        auto& connection = _sockets.at(qobject_cast<QTcpSocket*>(sender()));
+        connection.buffer += connection.socket->readAll();
+
+        while (true)
+        {
+            const auto headEnd = connection.buffer.indexOf("\r\n\r\n");
+            if (headEnd == -1)
+            {
+                return;
+            }
+
+            //Ответы сервера на эти запросы всегда содержат Content-Length
+            qsizetype contentLength = 0;
+            const auto lines = connection.buffer.left(headEnd).split('\n');
+            for (const auto& line: lines)
+            {
+                const auto pos = line.indexOf(':');
+                if (pos != -1 && line.left(pos).trimmed().toLower() == "content-length")
+                {
+                    contentLength = line.mid(pos + 1).trimmed().toLongLong();
+                }
+            }
+
+            const auto size = headEnd + 4 + contentLength;
+            if (connection.buffer.size() < size)
+            {
+                return;
+            }
+
+            if (!lines.front().contains(" 200 "))
+            {
+                ++_errors;
+            }
+
+            _latencies.push_back(_timer.nsecsElapsed() - connection.sendTime);
+            connection.buffer.remove(0, size);
+
+            //После окончания измерения соединение закрывается и может быть уже удалено
+            if (!send(connection))
+            {
+                return;
+            }
+        }
+    }
+
+    void disconnected()
+    {
+        close(qobject_cast<QTcpSocket*>(sender()));
+    }
+
+    void errorOccurred(QAbstractSocket::SocketError socketError)
+    {
+        Q_UNUSED(socketError);
+
+        //Ошибка подключения не сопровождается сигналом disconnected()
+        auto socket = qobject_cast<QTcpSocket*>(sender());
+        if (socket->state() == QAbstractSocket::UnconnectedState)
+        {
+            close(socket);
+        }
+    }
+
+private:
+    struct Connection
+    {
+        QTcpSocket* socket = nullptr;
+        QByteArray buffer;      ///< Принятая часть ответа
+        qint64 sendTime = 0;    ///< Время отправки запроса (нсек от начала измерения)
+    };
+
+    void close(QTcpSocket* socket)
+    {
+        if (_sockets.erase(socket) == 0)
+        {
+            return;
+        }
+
+        socket->disconnect(this);
+        socket->deleteLater();
+
+        //Сервер закрыл соединение до окончания измерения - открываем новое
+        if (_timer.elapsed() < _duration)
+        {
+            ++_errors;
+            connectSocket();
+
+            return;
+        }
+
+        if (_sockets.empty())
+        {
+            emit finished();
+        }
+    }
+
+    void connectSocket()
+    {
+        auto socket = new QTcpSocket(this);
+
+        connect(socket, SIGNAL(connected()), SLOT(connected()));
+        connect(socket, SIGNAL(readyRead()), SLOT(readyRead()));
+        connect(socket, SIGNAL(disconnected()), SLOT(disconnected()));
+        connect(socket, SIGNAL(errorOccurred(QAbstractSocket::SocketError)), SLOT(errorOccurred(QAbstractSocket::SocketError)));
+
+        _sockets.emplace(socket, Connection{socket, {}, 0});
+
+        socket->connectToHost(QHostAddress::LocalHost, _port);
+    }
+
+    bool send(Connection& connection)
+    {
+        if (_timer.elapsed() >= _duration)
+        {
+            connection.socket->disconnectFromHost();
+
+            return false;
+        }
+
+        connection.sendTime = _timer.nsecsElapsed();
+        connection.socket->write(_request);
+
+        return true;
+    }
+
+private:
+    const quint16 _port = 0;
+    const quint32 _connections = 0;
+    const qint64 _duration = 0;     ///< Длительность измерения (мсек)
+    const QByteArray _request;
+
+    QElapsedTimer _timer;
+    std::unordered_map<QTcpSocket*, Connection> _sockets;
+    std::vector<qint64> _latencies; ///< Задержки ответов (нсек)
+    quint64 _errors = 0;
+
+};
+
+static qint64 percentile(const std::vector<qint64>& sorted, double value)
+{
+    if (sorted.empty())
+    {
+        return 0;
+    }
+
+    const auto index = std::min(static_cast<size_t>(value * static_cast<double>(sorted.size())), sorted.size() - 1);
+
+    return sorted[index];
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    parser.addOption({"port", "Server port", "port", "18080"});
+    parser.addOption({"reactors", "Server reactor count. 0 - one per core", "count", "0"});
+    parser.addOption({"threads", "Load generator thread count", "count", "4"});
+    parser.addOption({"connections", "Total keep-alive connection count", "count", "1000"});
+    parser.addOption({"duration", "Measurement duration (s)", "seconds", "10"});
+    parser.addOption({"path", "Request path", "path", ServerStatusQuery().path()});
+    parser.process(a);
+
+    const auto port = static_cast<quint16>(parser.value("port").toUInt());
+    const auto threads = std::max(parser.value("threads").toUInt(), 1u);
+    const auto connections = std::max(parser.value("connections").toUInt(), threads);
+    const auto duration = static_cast<qint64>(parser.value("duration").toUInt()) * 1000;
+
+    HTTPServerConfig serverConfig;
+    serverConfig.port = port;
+    serverConfig.threadCount = parser.value("reactors").toUInt();
+    serverConfig.maxUsers = static_cast<quint64>(connections) * 2;
+    serverConfig.keepAliveMaxRequests = std::numeric_limits<quint32>::max();
+    serverConfig.name = "ReactorBenchmark";
+    serverConfig.admission.isEnabled = false; //Вся нагрузка идет с одного адреса
+
+    TradingData tradingData(StockExchangesIDList{StockExchangeID("BINANCE")});
+    HttpServer server(serverConfig, tradingData);
+
+    QObject::connect(&server, &HttpServer::errorOccurred,
+        [](Common::EXIT_CODE errorCode, const QString& errorString)
+        {
+            Q_UNUSED(errorCode);
+
+            qFatal("Server error: %s", qPrintable(errorString));
+        });
+
+    const auto request = QString("GET %1 HTTP/1.1\r\nHost: 127.0.0.1:%2\r\nConnection: keep-alive\r\n\r\n")
+                             .arg(parser.value("path"))
+                             .arg(port)
+                             .toUtf8();
+
+    std::vector<std::unique_ptr<QThread>> clientThreads;
+    std::vector<std::unique_ptr<LoadClient>> clients;
+    quint32 finishedCount = 0;
+    QElapsedTimer totalTimer;
+
+    const auto report = [&]()
+    {
+        const auto elapsed = static_cast<double>(totalTimer.nsecsElapsed()) / 1e9;
+
+        std::vector<qint64> latencies;
+        quint64 errors = 0;
+        for (auto& thread: clientThreads)
+        {
+            thread->quit();
+            thread->wait();
+        }
+        for (const auto& client: clients)
+        {
+            latencies.insert(latencies.end(), client->latencies().begin(), client->latencies().end());
+            errors += client->errors();
+        }
+
+        std::sort(latencies.begin(), latencies.end());
+
+        QTextStream(stdout) << QString("Reactors: %1, load threads: %2, connections: %3, path: %4")
+                                   .arg(serverConfig.threadCount == 0 ? QThread::idealThreadCount() : serverConfig.threadCount)
+                                   .arg(threads)
+                                   .arg(connections)
+                                   .arg(parser.value("path"))
+                            << Qt::endl;
+        QTextStream(stdout) << QString("%1 %2").arg("Requests", -56).arg(latencies.size(), 12) << Qt::endl;
+        QTextStream(stdout) << QString("%1 %2").arg("Errors", -56).arg(errors, 12) << Qt::endl;
+        QTextStream(stdout) << QString("%1 %2 req/s").arg("Throughput", -56).arg(static_cast<double>(latencies.size()) / elapsed, 12, 'f', 0) << Qt::endl;
+        QTextStream(stdout) << QString("%1 %2 us").arg("Latency p50", -56).arg(percentile(latencies, 0.50) / 1000, 12) << Qt::endl;
+        QTextStream(stdout) << QString("%1 %2 us").arg("Latency p99", -56).arg(percentile(latencies, 0.99) / 1000, 12) << Qt::endl;
+        QTextStream(stdout) << QString("%1 %2 us").arg("Latency max", -56).arg(latencies.empty() ? 0 : latencies.back() / 1000, 12) << Qt::endl;
+
+        server.stop();
+
+        QCoreApplication::quit();
+    };
+
+    //Нагрузка начинается когда все реакторы слушают порт
+    QObject::connect(&server, &HttpServer::started, &a,
+        [&]()
+        {
+            totalTimer.start();
+
+            for (quint32 i = 0; i < threads; ++i)
+            {
+                //Соединения распределяются по потокам поровну, остаток получают первые потоки
+                const auto threadConnections = connections / threads + (i < connections % threads ? 1 : 0);
+
+                auto thread = std::make_unique<QThread>();
+                auto client = std::make_unique<LoadClient>(port, threadConnections, duration, request);
+                client->moveToThread(thread.get());
+
+                QObject::connect(thread.get(), SIGNAL(started()), client.get(), SLOT(start()));
+                QObject::connect(client.get(), &LoadClient::finished, &a,
+                    [&]()
+                    {
+                        if (++finishedCount == threads)
+                        {
+                            report();
+                        }
+                    }, Qt::QueuedConnection);
+
+                thread->start();
+
+                clientThreads.emplace_back(std::move(thread));
+                clients.emplace_back(std::move(client));
+            }
+        });
+
+    server.start();
+
+    return a.exec();
+}
+
+#include "main.moc"
@@ -0,0 +1,7 @@
+TARGET = reactor
+
+include($$PWD/../bench.pri)
+include($$PWD/../server.pri)
+
+SOURCES += \
+    main.cpp
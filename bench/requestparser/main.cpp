@@ -0,0 +1,201 @@
+///////////////////////////////////////////////////////////////////////////////
+///     Бенчмарк разбора HTTP запросов: инкрементальный HTTPRequest в сравнении
+///         с прежним разбором через QTextStream, который повторяется здесь как эталон.
+///         Запрос подается целиком и частями, как при медленном клиенте
+///
+
+//STL
+#include <vector>
+
+//Qt
+#include <QCoreApplication>
+#include <QMap>
+#include <QTextStream>
+
+//My
+#include "TradingCatCommon/httprequest.h"
+
+#include "benchmark.h"
+
+using namespace TradingCatCommon;
+
+static const qint64 ITERATIONS = 200000;
+static const qsizetype SMALL_CHUNK_SIZE = 16;   ///< Размер части запроса при поступлении небольшими пакетами (байт)
+
+///////////////////////////////////////////////////////////////////////////////
+///     The LegacyRequest class - прежний разбор запроса: данные накапливаются в буфере,
+///         при каждом поступлении буфер просматривается с начала, заголовок разбирается
+///         через QTextStream в QMap строк
+///
+class LegacyRequest final
+{
+public:
+    void add(const QByteArray& data)
+    {
+        _body += data;
+
+        if (_headerParsed || !_body.contains("\r\n\r\n"))
+        {
+            return;
+        }
+
+        QTextStream requestStr(_body);
+        requestStr.setAutoDetectUnicode(true);
+
+        QString tmp;
+        requestStr >> tmp;
+        if (tmp != "GET" && tmp != "POST")
+        {
+            _errorCode = 405;
+
+            return;
+        }
+
+        requestStr >> tmp;
+        tmp.remove(0, 1);
+        _resurce = tmp;
+
+        requestStr >> tmp;
+        if (tmp != "HTTP/1.1")
+        {
+            _errorCode = 505;
+
+            return;
+        }
+
+        requestStr.readLine();
+
+        while (!requestStr.atEnd())
+        {
+            QString key = requestStr.readLine();
+            if (key.isEmpty())
+            {
+                break;
+            }
+
+            const auto pos = key.indexOf(":");
+            const auto value = key.mid(pos + 2);
+            key.remove(pos, key.length() - pos);
+
+            _header.insert(key, value);
+        }
+
+        _body = requestStr.readAll().toUtf8();
+        _headerParsed = true;
+    }
+
+    bool isComplite() const noexcept
+    {
+        return _headerParsed;
+    }
+
+    QString header(const QString& key) const
+    {
+        return _header.value(key);
+    }
+
+    const QUrl& resurce() const noexcept
+    {
+        return _resurce;
+    }
+
+private:
+    QByteArray _body;
+    QMap<QString, QString> _header;
+    QUrl _resurce;
+    uint _errorCode = 0;
+    bool _headerParsed = false;
+
+};
+
+/*!
+    Делит запрос на части заданного размера
+    @param request - запрос
+    @param chunkSize - размер части (байт)
+    @return список частей
+*/
+static std::vector<QByteArray> split(const QByteArray& request, qsizetype chunkSize)
+{
+    std::vector<QByteArray> result;
+    for (qsizetype pos = 0; pos < request.size(); pos += chunkSize)
+    {
+        result.emplace_back(request.mid(pos, chunkSize));
+    }
+
+    return result;
+}
+
+static void run(const QString& name, const QByteArray& request, const std::vector<QByteArray>& chunks)
+{
+    //Оба разбора должны принимать запрос, иначе измерения не имеют смысла
+    {
+        HTTPRequest httpRequest;
+        LegacyRequest legacyRequest;
+        for (const auto& chunk: chunks)
+        {
+            httpRequest.add(chunk);
+            legacyRequest.add(chunk);
+        }
+
+        if (httpRequest.isError() || !httpRequest.isComplite() || !legacyRequest.isComplite())
+        {
+            qFatal("%s: request is not parsed", qPrintable(name));
+        }
+    }
+
+    const auto legacyTime = Bench::measure(name + " QTextStream", ITERATIONS,
+        [&chunks]()
+        {
+            LegacyRequest legacyRequest;
+            for (const auto& chunk: chunks)
+            {
+                legacyRequest.add(chunk);
+            }
+
+            return legacyRequest.resurce().path().size() + legacyRequest.header("Accept-Encoding").size();
+        });
+
+    const auto requestTime = Bench::measure(name + " HTTPRequest", ITERATIONS,
+        [&chunks]()
+        {
+            HTTPRequest httpRequest;
+            for (const auto& chunk: chunks)
+            {
+                httpRequest.add(chunk);
+            }
+
+            return httpRequest.resurce().path().size() + static_cast<qsizetype>(httpRequest.acceptEncoding());
+        });
+
+    Bench::printSpeedup(name + " speedup", legacyTime, requestTime);
+
+    QTextStream(stdout) << QString("%1 %2 req/s").arg(name + " HTTPRequest throughput", -56).arg(1e9 / requestTime, 12, 'f', 0) << Qt::endl;
+    QTextStream(stdout) << QString("%1 %2 MB/s").arg(name + " HTTPRequest throughput", -56)
+                               .arg(static_cast<double>(request.size()) * 1000.0 / requestTime, 12, 'f', 1)
+                        << Qt::endl;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+
+    //Типичный запрос клиента: новые свечи с курсором и набором заголовков браузера/клиента
+    const QByteArray request =
+        "GET /data/klines/new?types=1m,5m&lastGetId=1234567890&maxCount=1000 HTTP/1.1\r\n"
+        "Host: 127.0.0.1:8080\r\n"
+        "User-Agent: TradingCatClient/1.0\r\n"
+        "Accept: application/x-tradingcat, application/json;q=0.9\r\n"
+        "Accept-Encoding: gzip, deflate\r\n"
+        "Accept-Language: ru-RU,ru;q=0.9,en-US;q=0.8\r\n"
+        "Connection: keep-alive\r\n"
+        "Cache-Control: no-cache\r\n"
+        "If-None-Match: \"5d41402abc4b2a76b9719d911017c592\"\r\n"
+        "\r\n";
+
+    Bench::printSize("Request size", request.size());
+
+    run("Whole request", request, {request});
+    run(QString("%1 byte chunks").arg(SMALL_CHUNK_SIZE), request, split(request, SMALL_CHUNK_SIZE));
+
+    return 0;
+}
@@ -0,0 +1,16 @@
+#Серверная часть TradingCatCommon, которая не входит в TradingCatCommon.pri
+HEADERS += \
+    $$PWD/../Headers/TradingCatCommon/httpanswer.h \
+    $$PWD/../Headers/TradingCatCommon/httpreactor.h \
+    $$PWD/../Headers/TradingCatCommon/httprequest.h \
+    $$PWD/../Headers/TradingCatCommon/httpserver.h \
+    $$PWD/../Headers/TradingCatCommon/socketthread.h \
+    $$PWD/../Headers/TradingCatCommon/thread.h
+
+SOURCES += \
+    $$PWD/../Src/httpanswer.cpp \
+    $$PWD/../Src/httpreactor.cpp \
+    $$PWD/../Src/httprequest.cpp \
+    $$PWD/../Src/httpserver.cpp \
+    $$PWD/../Src/socketthread.cpp \
+    $$PWD/../Src/thread.cpp